@@ -47,6 +47,7 @@
 #define IDC_NOTIF_LOCATION              9106
 #define IDC_GOTO_LOCATION               9107
 #define IDC_MAP_ISLAND                  10001
+#define IDC_MAP_NOISE                   10002
 #define IDC_WATER_PERCENT               10003
 #define IDC_WATER_LABEL                 10004
 #define IDC_FOREST_PERCENT              10005
@@ -5,6 +5,7 @@
 #include "animtab.h"
 #include "sim.h"
 #include "tiles.h"
+#include "planes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,48 +36,46 @@ void AnimateTiles(void) {
         return;
     }
 
-    /* Scan the entire map for tiles with the ANIMBIT set */
+    /* Visit only the tiles with the ANIMBIT set */
     for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
+        for (x = PlaneNextBit(PLANE_ANIM, y, 0, WORLD_X); x >= 0;
+             x = PlaneNextBit(PLANE_ANIM, y, x + 1, WORLD_X)) {
             tilevalue = Map[y][x];
 
-            /* Only process tiles with the animation bit set */
-            if (tilevalue & ANIMBIT) {
-                tileflags = tilevalue & MASKBITS; /* Save the flags */
-                tilevalue &= LOMASK;              /* Extract base tile value */
-
-                /* Debug animation (once every 100 frames) */
-                if (debugCount == 0) {
-                    /* Check for known animation types to debug them */
-                    if (tilevalue >= TELEBASE && tilevalue <= TELELAST) {
-                        char debugMsg[256];
-                        wsprintf(debugMsg, "ANIMATION: Industrial smoke at (%d,%d) frame %d\n", 
-                                 x, y, tilevalue);
-                        OutputDebugString(debugMsg);
-                    } else if (tilevalue == NUCLEAR_SWIRL) {
-                        char debugMsg[256];
-                        wsprintf(debugMsg, "ANIMATION: Nuclear reactor at (%d,%d)\n", x, y);
-                        OutputDebugString(debugMsg);
-                    } else if (tilevalue >= RADAR0 && tilevalue <= RADAR7) {
-                        char debugMsg[256];
-                        wsprintf(debugMsg, "ANIMATION: Airport radar animation at (%d,%d)\n", x, y);
-                        OutputDebugString(debugMsg);
-                    } else if (tilevalue == FOOTBALLGAME1 || tilevalue == FOOTBALLGAME2) {
-                        char debugMsg[256];
-                        wsprintf(debugMsg, "ANIMATION: Stadium game at (%d,%d)\n", x, y);
-                        OutputDebugString(debugMsg);
-                    }
+            tileflags = tilevalue & MASKBITS; /* Save the flags */
+            tilevalue &= LOMASK;              /* Extract base tile value */
+
+            /* Debug animation (once every 100 frames) */
+            if (debugCount == 0) {
+                /* Check for known animation types to debug them */
+                if (tilevalue >= TELEBASE && tilevalue <= TELELAST) {
+                    char debugMsg[256];
+                    wsprintf(debugMsg, "ANIMATION: Industrial smoke at (%d,%d) frame %d\n", 
+                             x, y, tilevalue);
+                    OutputDebugString(debugMsg);
+                } else if (tilevalue == NUCLEAR_SWIRL) {
+                    char debugMsg[256];
+                    wsprintf(debugMsg, "ANIMATION: Nuclear reactor at (%d,%d)\n", x, y);
+                    OutputDebugString(debugMsg);
+                } else if (tilevalue >= RADAR0 && tilevalue <= RADAR7) {
+                    char debugMsg[256];
+                    wsprintf(debugMsg, "ANIMATION: Airport radar animation at (%d,%d)\n", x, y);
+                    OutputDebugString(debugMsg);
+                } else if (tilevalue == FOOTBALLGAME1 || tilevalue == FOOTBALLGAME2) {
+                    char debugMsg[256];
+                    wsprintf(debugMsg, "ANIMATION: Stadium game at (%d,%d)\n", x, y);
+                    OutputDebugString(debugMsg);
                 }
+            }
 
-                /* Look up the next animation frame */
-                tilevalue = aniTile[tilevalue];
+            /* Look up the next animation frame */
+            tilevalue = aniTile[tilevalue];
 
-                /* Reapply the flags */
-                tilevalue |= tileflags;
+            /* Reapply the flags */
+            tilevalue |= tileflags;
 
-                /* Update the map with the new tile */
-                setMapTile(x, y, tilevalue, 0, TILE_SET_REPLACE, "AnimateTiles-frame");
-            }
+            /* Update the map with the new tile */
+            setMapTile(x, y, tilevalue, 0, TILE_SET_REPLACE, "AnimateTiles-frame");
         }
     }
     
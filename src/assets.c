@@ -3,6 +3,7 @@
 #include "resource.h"
 #include "sim.h"
 #include "assets.h"
+#include "journal.h"
 
 extern int loadCity(char *filename);
 extern int loadFile(char *filename);
@@ -135,6 +136,7 @@ int loadCityFromResource(int resourceId, char* cityName) {
     }
     
     if (loadCity(tempFileName)) {
+        DiscardJournal();
         DeleteFile(tempFileName);
         if (cityName) {
             strcpy(cityName, tempFileName);
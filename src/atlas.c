@@ -0,0 +1,341 @@
+/* atlas.c - Packed tileset and sprite atlas for WiNTown
+ * The cache file is a header, the palette the pixels index, the frame
+ * index and then the pixels, top row first. The header carries the write
+ * time of the executable that built it, so a rebuilt game with changed
+ * resources packs its atlases again instead of trusting old ones.
+ */
+
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atlas.h"
+#include "gdifix.h"
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+#define ATLAS_MAGIC "WNTA"
+#define ATLAS_VERSION 1
+#define ATLAS_MAX_FRAMES (ATLAS_TYPES * ATLAS_FRAMES)
+
+typedef struct {
+    char magic[4];
+    DWORD version;
+    FILETIME stamp;   /* Write time of the executable */
+    DWORD width;
+    DWORD height;
+    DWORD tileRows;
+    DWORD frames;
+    DWORD pixels;     /* Offset of the pixels in the file */
+} AtlasHeader;
+
+typedef struct {
+    short type;
+    short frame;
+    short x, y, w, h;
+} AtlasFrame;
+
+/* The current atlas's frames, by type and frame, or -1 */
+static short FrameAt[ATLAS_TYPES][ATLAS_FRAMES];
+static AtlasFrame Frames[ATLAS_MAX_FRAMES];
+static int FrameCount = 0;
+
+/* Palette and pixels both come after the header and frame index */
+static DWORD PixelOffset(DWORD frames) {
+    DWORD offset;
+
+    offset = sizeof(AtlasHeader) + 256 * sizeof(RGBQUAD) + frames * sizeof(AtlasFrame);
+    return (offset + 3) & ~3;
+}
+
+static void ExecutableStamp(FILETIME *stamp) {
+    char exePath[MAX_PATH];
+    WIN32_FIND_DATA fd;
+    HANDLE hFind;
+
+    ZeroMemory(stamp, sizeof(FILETIME));
+    GetModuleFileName(NULL, exePath, MAX_PATH);
+    hFind = FindFirstFile(exePath, &fd);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        *stamp = fd.ftLastWriteTime;
+        FindClose(hFind);
+    }
+}
+
+static void IndexFrames(void) {
+    int i;
+
+    memset(FrameAt, 0xff, sizeof(FrameAt));
+    for (i = 0; i < FrameCount; i++) {
+        FrameAt[Frames[i].type][Frames[i].frame] = (short)i;
+    }
+}
+
+/* Whether every frame names a sprite and lies in the sprite rows of a
+   width by height atlas */
+static int ValidFrames(const AtlasFrame *frames, DWORD count, DWORD width, DWORD height) {
+    DWORD i;
+
+    for (i = 0; i < count; i++) {
+        if (frames[i].type < 0 || frames[i].type >= ATLAS_TYPES || frames[i].frame < 0 ||
+            frames[i].frame >= ATLAS_FRAMES || frames[i].x < 0 || frames[i].y < ATLAS_TILE_ROWS ||
+            frames[i].w <= 0 || frames[i].h <= 0 || (DWORD)(frames[i].x + frames[i].w) > width ||
+            (DWORD)(frames[i].y + frames[i].h) > height) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void FreeAtlas(void) {
+    FrameCount = 0;
+    memset(FrameAt, 0xff, sizeof(FrameAt));
+}
+
+int GetAtlasFrame(int type, int frame, int *x, int *y) {
+    int i;
+
+    if (type < 0 || type >= ATLAS_TYPES || frame < 0 || frame >= ATLAS_FRAMES || !FrameCount) {
+        return 0;
+    }
+    i = FrameAt[type][frame];
+    if (i < 0) {
+        return 0;
+    }
+    *x = Frames[i].x;
+    *y = Frames[i].y;
+    return 1;
+}
+
+/* An 8-bit top-down DIB section of the atlas size with the given colours */
+static HBITMAP CreateAtlasBitmap(int width, int height, const RGBQUAD *colours, void **bits) {
+    BITMAPINFO *bmi;
+    HBITMAP hbm;
+    HDC hdc;
+
+    bmi = (BITMAPINFO *)malloc(sizeof(BITMAPINFOHEADER) + 256 * sizeof(RGBQUAD));
+    if (!bmi) {
+        return NULL;
+    }
+    ZeroMemory(bmi, sizeof(BITMAPINFOHEADER));
+    bmi->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi->bmiHeader.biWidth = width;
+    bmi->bmiHeader.biHeight = -height;
+    bmi->bmiHeader.biPlanes = 1;
+    bmi->bmiHeader.biBitCount = 8;
+    bmi->bmiHeader.biCompression = BI_RGB;
+    bmi->bmiHeader.biClrUsed = 256;
+    memcpy(bmi->bmiColors, colours, 256 * sizeof(RGBQUAD));
+
+    hdc = GetDC(NULL);
+    hbm = CreateDIBSection(hdc, bmi, DIB_RGB_COLORS, bits, NULL, 0);
+    ReleaseDC(NULL, hdc);
+    free(bmi);
+    return hbm;
+}
+
+static int PaletteColours(HPALETTE hPalette, RGBQUAD *colours) {
+    PALETTEENTRY entries[256];
+    int i;
+
+    ZeroMemory(entries, sizeof(entries));
+    if (!hPalette || !GetPaletteEntries(hPalette, 0, 256, entries)) {
+        return 0;
+    }
+    for (i = 0; i < 256; i++) {
+        colours[i].rgbRed = entries[i].peRed;
+        colours[i].rgbGreen = entries[i].peGreen;
+        colours[i].rgbBlue = entries[i].peBlue;
+        colours[i].rgbReserved = 0;
+    }
+    return 1;
+}
+
+HBITMAP LoadAtlas(const char *path, HPALETTE hPalette) {
+    HANDLE hFile, hMapping;
+    const BYTE *view;
+    const AtlasHeader *header;
+    RGBQUAD colours[256];
+    FILETIME stamp;
+    HBITMAP hbm;
+    DWORD size;
+    void *bits;
+
+    hFile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    size = GetFileSize(hFile, NULL);
+    hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (!hMapping) {
+        return NULL;
+    }
+    view = (const BYTE *)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (!view) {
+        return NULL;
+    }
+
+    hbm = NULL;
+    header = (const AtlasHeader *)view;
+    ExecutableStamp(&stamp);
+    if (size < PixelOffset(0) || memcmp(header->magic, ATLAS_MAGIC, 4) != 0 ||
+        header->version != ATLAS_VERSION || header->width != ATLAS_WIDTH ||
+        header->tileRows != ATLAS_TILE_ROWS || header->height < ATLAS_TILE_ROWS ||
+        header->height > 4 * ATLAS_TILE_ROWS || header->frames > ATLAS_MAX_FRAMES ||
+        header->pixels != PixelOffset(header->frames) ||
+        size < header->pixels + header->width * header->height) {
+        addDebugLog("Atlas %s is not a valid atlas", path);
+    } else if (!ValidFrames((const AtlasFrame *)(view + sizeof(AtlasHeader) + sizeof(colours)),
+                            header->frames, header->width, header->height)) {
+        addDebugLog("Atlas %s has a sprite frame outside the atlas", path);
+    } else if (CompareFileTime(&header->stamp, &stamp) != 0) {
+        addDebugLog("Atlas %s was built by another executable", path);
+    } else if (!PaletteColours(hPalette, colours) ||
+               memcmp(colours, view + sizeof(AtlasHeader), sizeof(colours)) != 0) {
+        addDebugLog("Atlas %s was built for another palette", path);
+    } else {
+        hbm = CreateAtlasBitmap(header->width, header->height, colours, &bits);
+        if (hbm) {
+            memcpy(bits, view + header->pixels, header->width * header->height);
+            if (!validateTilesetFormat(hbm)) {
+                DeleteObject(hbm);
+                hbm = NULL;
+            }
+        }
+        if (hbm) {
+            FrameCount = header->frames;
+            memcpy(Frames, view + sizeof(AtlasHeader) + sizeof(colours),
+                   FrameCount * sizeof(AtlasFrame));
+            IndexFrames();
+            addDebugLog("Atlas %s loaded: %dx%d, %d sprite frames", path, header->width,
+                        header->height, FrameCount);
+        }
+    }
+
+    UnmapViewOfFile((LPVOID)view);
+    return hbm;
+}
+
+static int WriteAtlas(const char *path, int height, const RGBQUAD *colours, const void *bits) {
+    AtlasHeader header;
+    HANDLE hFile;
+    DWORD written, total;
+    BYTE pad[4];
+
+    ZeroMemory(&header, sizeof(header));
+    memcpy(header.magic, ATLAS_MAGIC, 4);
+    header.version = ATLAS_VERSION;
+    ExecutableStamp(&header.stamp);
+    header.width = ATLAS_WIDTH;
+    header.height = height;
+    header.tileRows = ATLAS_TILE_ROWS;
+    header.frames = FrameCount;
+    header.pixels = PixelOffset(FrameCount);
+
+    hFile = CreateFile(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    ZeroMemory(pad, sizeof(pad));
+    total = 0;
+    WriteFile(hFile, &header, sizeof(header), &written, NULL);
+    total += written;
+    WriteFile(hFile, colours, 256 * sizeof(RGBQUAD), &written, NULL);
+    total += written;
+    WriteFile(hFile, Frames, FrameCount * sizeof(AtlasFrame), &written, NULL);
+    total += written;
+    WriteFile(hFile, pad, header.pixels - total, &written, NULL);
+    total += written;
+    WriteFile(hFile, bits, ATLAS_WIDTH * height, &written, NULL);
+    total += written;
+    CloseHandle(hFile);
+
+    if (total != header.pixels + ATLAS_WIDTH * height) {
+        DeleteFile(path);
+        return 0;
+    }
+    return 1;
+}
+
+HBITMAP BuildAtlas(const char *path, HBITMAP hbmTileset, HBITMAP sprites[][ATLAS_FRAMES],
+                   HPALETTE hPalette) {
+    RGBQUAD colours[256];
+    HDC hdcAtlas, hdcSrc;
+    HBITMAP hbm, hbmOldAtlas, hbmOldSrc;
+    BITMAP bm;
+    void *bits;
+    int type, frame, i, x, y, shelf;
+
+    if (!validateTilesetFormat(hbmTileset) || !PaletteColours(hPalette, colours)) {
+        return NULL;
+    }
+
+    /* Shelves of sprite frames below the tiles, in load order */
+    FrameCount = 0;
+    x = 0;
+    y = ATLAS_TILE_ROWS;
+    shelf = 0;
+    for (type = 0; type < ATLAS_TYPES; type++) {
+        for (frame = 0; frame < ATLAS_FRAMES; frame++) {
+            if (!sprites[type][frame] || !GetObject(sprites[type][frame], sizeof(BITMAP), &bm) ||
+                bm.bmWidth > ATLAS_WIDTH) {
+                continue;
+            }
+            if (x + bm.bmWidth > ATLAS_WIDTH) {
+                x = 0;
+                y += shelf;
+                shelf = 0;
+            }
+            Frames[FrameCount].type = (short)type;
+            Frames[FrameCount].frame = (short)frame;
+            Frames[FrameCount].x = (short)x;
+            Frames[FrameCount].y = (short)y;
+            Frames[FrameCount].w = (short)bm.bmWidth;
+            Frames[FrameCount].h = (short)bm.bmHeight;
+            FrameCount++;
+            x += bm.bmWidth;
+            if (bm.bmHeight > shelf) {
+                shelf = bm.bmHeight;
+            }
+        }
+    }
+
+    hbm = CreateAtlasBitmap(ATLAS_WIDTH, y + shelf, colours, &bits);
+    if (!hbm) {
+        FreeAtlas();
+        return NULL;
+    }
+    memset(bits, 0, ATLAS_WIDTH * (y + shelf));
+
+    /* Blitting into the DIB maps every colour onto the palette once */
+    hdcAtlas = CreateCompatibleDC(NULL);
+    hdcSrc = CreateCompatibleDC(NULL);
+    SelectPalette(hdcAtlas, hPalette, FALSE);
+    SelectPalette(hdcSrc, hPalette, FALSE);
+    hbmOldAtlas = SelectObject(hdcAtlas, hbm);
+
+    hbmOldSrc = SelectObject(hdcSrc, hbmTileset);
+    BitBlt(hdcAtlas, 0, 0, ATLAS_WIDTH, ATLAS_TILE_ROWS, hdcSrc, 0, 0, SRCCOPY);
+    for (i = 0; i < FrameCount; i++) {
+        SelectObject(hdcSrc, sprites[Frames[i].type][Frames[i].frame]);
+        BitBlt(hdcAtlas, Frames[i].x, Frames[i].y, Frames[i].w, Frames[i].h, hdcSrc, 0, 0,
+               SRCCOPY);
+    }
+    SelectObject(hdcSrc, hbmOldSrc);
+    SelectObject(hdcAtlas, hbmOldAtlas);
+    DeleteDC(hdcSrc);
+    DeleteDC(hdcAtlas);
+    GdiFlush();
+
+    IndexFrames();
+    if (WriteAtlas(path, y + shelf, colours, bits)) {
+        addDebugLog("Atlas %s built: %dx%d, %d sprite frames", path, ATLAS_WIDTH, y + shelf,
+                    FrameCount);
+    } else {
+        addDebugLog("Atlas %s built but could not be written", path);
+    }
+    return hbm;
+}
@@ -0,0 +1,37 @@
+/* atlas.h - Packed tileset and sprite atlas for WiNTown
+ * An atlas is one 8-bit bitmap in the game palette with the tileset in
+ * its top rows and every sprite frame packed in shelves below. It is
+ * built the first time a tileset is used and written to a cache file,
+ * which later runs map and copy straight into a DIB section with no
+ * decoding or palette conversion.
+ */
+
+#ifndef _ATLAS_H
+#define _ATLAS_H
+
+#include <windows.h>
+
+/* Atlas width, and the rows the tileset takes at its top */
+#define ATLAS_WIDTH 512
+#define ATLAS_TILE_ROWS 480
+
+/* Sprite types and frames an atlas can index, as in hbmSprites */
+#define ATLAS_TYPES 9
+#define ATLAS_FRAMES 16
+
+/* Load the atlas cached at path - returns NULL if there is none, or it
+   was built by another executable or for another palette */
+HBITMAP LoadAtlas(const char *path, HPALETTE hPalette);
+
+/* Pack a tileset and sprite frames into an atlas, write it to path and
+   return it - NULL if the tileset is not a valid one */
+HBITMAP BuildAtlas(const char *path, HBITMAP hbmTileset, HBITMAP sprites[][ATLAS_FRAMES],
+                   HPALETTE hPalette);
+
+/* Where a sprite frame lies in the current atlas - returns 0 if not in it */
+int GetAtlasFrame(int type, int frame, int *x, int *y);
+
+/* Forget the current atlas's frames, as when a plain tileset is loaded */
+void FreeAtlas(void);
+
+#endif /* _ATLAS_H */
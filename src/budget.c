@@ -124,119 +124,186 @@ void Spend(QUAD amount) {
     }
 }
 
-/* Auto-budget processing */
+/* Budget policy state */
+static int BudgetPolicy = BUDGET_POLICY_INTERACTIVE;
+static BudgetPolicyProc BudgetCallback = NULL;
+static void *BudgetCallbackData = NULL;
+static QUAD BudgetReserve = 0;
+
+/* Order services are funded in when money runs short */
+static const int BudgetPriority[BUDGET_TYPES] = {BUDGET_TYPE_ROAD, BUDGET_TYPE_FIRE,
+                                                 BUDGET_TYPE_POLICE};
+
+/* Select how allocations are decided */
+void SetBudgetPolicy(int policy) {
+    if (policy < BUDGET_POLICY_INTERACTIVE || policy > BUDGET_POLICY_CALLBACK) {
+        return;
+    }
+    BudgetPolicy = policy;
+    addDebugLog("Budget policy set to %d", policy);
+}
+
+int GetBudgetPolicy(void) {
+    return BudgetPolicy;
+}
+
+/* Install the allocator used by BUDGET_POLICY_CALLBACK */
+void SetBudgetPolicyCallback(BudgetPolicyProc proc, void *userData) {
+    BudgetCallback = proc;
+    BudgetCallbackData = userData;
+}
+
+/* Treasury balance BUDGET_POLICY_RESERVE will not spend below */
+void SetBudgetReserve(QUAD reserve) {
+    BudgetReserve = reserve < 0 ? 0 : reserve;
+}
+
+/* Fund services in priority order until the money runs out */
+static void AllocatePriority(BudgetRequest *req, QUAD available) {
+    int i, type;
+
+    for (i = 0; i < BUDGET_TYPES; i++) {
+        type = BudgetPriority[i];
+        if (available >= req->request[type]) {
+            req->spend[type] = req->request[type];
+        } else {
+            req->spend[type] = available > 0 ? available : 0;
+        }
+        available -= req->spend[type];
+    }
+}
+
+/* Scale every service by the same fraction of its request */
+static void AllocateProportional(BudgetRequest *req, QUAD available) {
+    QUAD total;
+    int type;
+
+    total = req->request[BUDGET_TYPE_ROAD] + req->request[BUDGET_TYPE_POLICE] +
+            req->request[BUDGET_TYPE_FIRE];
+    for (type = 0; type < BUDGET_TYPES; type++) {
+        if (available >= total) {
+            req->spend[type] = req->request[type];
+        } else if (available > 0 && total > 0) {
+            req->spend[type] = (QUAD)(((float)req->request[type] * (float)available) / (float)total);
+        } else {
+            req->spend[type] = 0;
+        }
+    }
+}
+
+/* Keep a callback's answer within the requests and the money available */
+static void ClampAllocation(BudgetRequest *req) {
+    QUAD total;
+    int type;
+
+    total = 0;
+    for (type = 0; type < BUDGET_TYPES; type++) {
+        if (req->spend[type] < 0) {
+            req->spend[type] = 0;
+        } else if (req->spend[type] > req->request[type]) {
+            req->spend[type] = req->request[type];
+        }
+        total += req->spend[type];
+    }
+    if (total > req->available) {
+        addDebugLog("Budget callback overspent ($%d of $%d) - using priority order", (int)total,
+                    (int)req->available);
+        AllocatePriority(req, req->available);
+    }
+}
+
+/* Ask the player for new percentages - the modal dialog of the original game.
+ * Returns 0 when there is no window to ask with. */
+static int AskBudgetDialog(BudgetRequest *req) {
+    extern HWND hwndMain;
+    int result;
+
+    if (!hwndMain) {
+        return 0;
+    }
+
+    /* If insufficient funds during auto-budget, disable auto-budget */
+    if (AutoBudget && req->available < req->total) {
+        AutoBudget = 0;
+        /* Show enhanced notification dialog */
+        ShowNotification(NOTIF_BUDGET_DEFICIT);
+        addGameLog("BUDGET CRISIS: Insufficient funds - Auto-budget disabled");
+    }
+
+    /* Show budget window and wait for user input */
+    result = ShowBudgetWindowAndWait(hwndMain);
+
+    /* If user cancelled, re-enable auto-budget as fallback */
+    if (result == IDCANCEL) {
+        AutoBudget = 1;
+        addGameLog("Budget cancelled - Auto-budget re-enabled");
+    }
+    return 1;
+}
+
+/* Fill in the requested amounts from the funding percentages */
+static void FillBudgetRequest(BudgetRequest *req) {
+    req->fund[BUDGET_TYPE_ROAD] = RoadFund;
+    req->fund[BUDGET_TYPE_POLICE] = PoliceFund;
+    req->fund[BUDGET_TYPE_FIRE] = FireFund;
+    req->request[BUDGET_TYPE_ROAD] = (QUAD)(((float)RoadFund) * RoadPercent);
+    req->request[BUDGET_TYPE_POLICE] = (QUAD)(((float)PoliceFund) * PolicePercent);
+    req->request[BUDGET_TYPE_FIRE] = (QUAD)(((float)FireFund) * FirePercent);
+    req->total = req->request[BUDGET_TYPE_ROAD] + req->request[BUDGET_TYPE_POLICE] +
+                 req->request[BUDGET_TYPE_FIRE];
+    req->available = TaxFund + TotalFunds;
+    req->spend[BUDGET_TYPE_ROAD] = 0;
+    req->spend[BUDGET_TYPE_POLICE] = 0;
+    req->spend[BUDGET_TYPE_FIRE] = 0;
+}
+
+/* Budget processing - the policy decides spending, percentages are left as requested */
 void DoBudget(void) {
+    BudgetRequest req;
     QUAD total;
-    QUAD yumDuckets;
     QUAD fireInt;
     QUAD policeInt;
     QUAD roadInt;
-    int fromMenu = 0;  /* Called from budget cycle, not menu */
 
-    /* Calculate desired allocation based on percentages */
-    fireInt = (QUAD)(((float)FireFund) * FirePercent);
-    policeInt = (QUAD)(((float)PoliceFund) * PolicePercent);
-    roadInt = (QUAD)(((float)RoadFund) * RoadPercent);
+    FillBudgetRequest(&req);
 
-    total = fireInt + policeInt + roadInt;
-    yumDuckets = TaxFund + TotalFunds;
+    switch (BudgetPolicy) {
+    case BUDGET_POLICY_PROPORTIONAL:
+        AllocateProportional(&req, req.available);
+        break;
 
-    /* Check if budget window should be shown */
-    if (!AutoBudget || (yumDuckets < total && !fromMenu)) {
-        extern HWND hwndMain;
-        int result;
-        
-        /* If insufficient funds during auto-budget, disable auto-budget */
-        if (AutoBudget && yumDuckets < total) {
-            AutoBudget = 0;
-            /* Show enhanced notification dialog */
-            ShowNotification(NOTIF_BUDGET_DEFICIT);
-            addGameLog("BUDGET CRISIS: Insufficient funds - Auto-budget disabled");
-        }
-        
-        /* Show budget window and wait for user input */
-        result = ShowBudgetWindowAndWait(hwndMain);
-        
-        /* If user cancelled, re-enable auto-budget as fallback */
-        if (result == IDCANCEL) {
-            AutoBudget = 1;
-            addGameLog("Budget cancelled - Auto-budget re-enabled");
-        }
-        
-        /* Recalculate with new values after user input */
-        fireInt = (QUAD)(((float)FireFund) * FirePercent);
-        policeInt = (QUAD)(((float)PoliceFund) * PolicePercent);
-        roadInt = (QUAD)(((float)RoadFund) * RoadPercent);
-        total = fireInt + policeInt + roadInt;
-        yumDuckets = TaxFund + TotalFunds;
-    }
+    case BUDGET_POLICY_PRIORITY:
+        AllocatePriority(&req, req.available);
+        break;
 
-    /* If we have enough money for full funding */
-    if (yumDuckets >= total) {
-        FireSpend = fireInt;
-        PoliceSpend = policeInt;
-        RoadSpend = roadInt;
-    }
-    /* If we don't have enough money, allocate in priority order */
-    else if (total > 0) {
-        /* Try to fund roads first */
-        if (yumDuckets > roadInt) {
-            RoadSpend = roadInt;
-            yumDuckets -= roadInt;
-
-            /* Then try to fund fire protection */
-            if (yumDuckets > fireInt) {
-                FireSpend = fireInt;
-                yumDuckets -= fireInt;
-
-                /* Finally fund police if money remains */
-                if (yumDuckets > policeInt) {
-                    PoliceSpend = policeInt;
-                    yumDuckets -= policeInt;
-                } else {
-                    /* Partial police funding */
-                    PoliceSpend = yumDuckets;
-                    if (yumDuckets > 0 && PoliceFund > 0) {
-                        PolicePercent = ((float)yumDuckets) / ((float)PoliceFund);
-                    } else {
-                        PolicePercent = 0.0f;
-                    }
-                }
-            } else {
-                /* Partial fire funding */
-                FireSpend = yumDuckets;
-                PoliceSpend = 0;
-                PolicePercent = 0.0f;
-                if (yumDuckets > 0 && FireFund > 0) {
-                    FirePercent = ((float)yumDuckets) / ((float)FireFund);
-                } else {
-                    FirePercent = 0.0f;
-                }
-            }
+    case BUDGET_POLICY_RESERVE:
+        AllocateProportional(&req, req.available - BudgetReserve);
+        break;
+
+    case BUDGET_POLICY_CALLBACK:
+        if (BudgetCallback) {
+            BudgetCallback(&req, BudgetCallbackData);
+            ClampAllocation(&req);
         } else {
-            /* Partial road funding */
-            RoadSpend = yumDuckets;
-            if (yumDuckets > 0 && RoadFund > 0) {
-                RoadPercent = ((float)yumDuckets) / ((float)RoadFund);
-            } else {
-                RoadPercent = 0.0f;
-            }
-
-            FireSpend = 0;
-            PoliceSpend = 0;
-            FirePercent = 0.0f;
-            PolicePercent = 0.0f;
+            AllocatePriority(&req, req.available);
         }
-    } else {
-        /* No required funding */
-        FireSpend = 0;
-        PoliceSpend = 0;
-        RoadSpend = 0;
-        FirePercent = 1.0f;
-        PolicePercent = 1.0f;
-        RoadPercent = 1.0f;
+        break;
+
+    case BUDGET_POLICY_INTERACTIVE:
+    default:
+        /* Check if budget window should be shown */
+        if ((!AutoBudget || req.available < req.total) && AskBudgetDialog(&req)) {
+            /* Recalculate with new values after user input */
+            FillBudgetRequest(&req);
+        }
+        AllocatePriority(&req, req.available);
+        break;
     }
 
+    FireSpend = req.spend[BUDGET_TYPE_FIRE];
+    PoliceSpend = req.spend[BUDGET_TYPE_POLICE];
+    RoadSpend = req.spend[BUDGET_TYPE_ROAD];
+
     /* Calculate effective rates */
     fireInt = FireFund > 0 ? FireSpend * 100 / FireFund : 100;
     policeInt = PoliceFund > 0 ? PoliceSpend * 100 / PoliceFund : 100;
@@ -0,0 +1,158 @@
+/* census.c - Incremental tile census for WiNTown
+ * Every map write goes through setMapTile(), so the counts can follow the
+ * old/new tile of each change instead of rescanning the map. The map starts
+ * out as all dirt with every count at zero, which keeps them in step from
+ * the first write onward.
+ */
+
+#include "sim.h"
+#include "census.h"
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Counter a tile contributes to, or NULL if it is not counted */
+static int *CensusCounter(int tile) {
+    int base;
+
+    base = tile & LOMASK;
+
+    if (!(tile & ZONEBIT)) {
+        if (base >= ROADBASE && base <= LASTROAD) {
+            return &RoadTotal;
+        }
+        if (base >= RAILBASE && base <= LASTRAIL) {
+            return &RailTotal;
+        }
+        return (int *)0;
+    }
+
+    /* Zone centers */
+    switch (base) {
+    case HOSPITAL:
+        return &HospPop;
+    case CHURCH:
+        return (int *)0;
+    case PORT:
+        return &PortPop;
+    case AIRPORT:
+        return &APortPop;
+    case POWERPLANT:
+        return &CoalPop;
+    case FIRESTATION:
+        return &FirePop;
+    case POLICESTATION:
+        return &PolicePop;
+    case STADIUM:
+    case FULLSTADIUM:
+        return &StadiumPop;
+    case NUCLEAR:
+        return &NuclearPop;
+    }
+
+    if (base >= RESBASE && base < COMBASE) {
+        return &ResZPop;
+    }
+    if (base >= COMBASE && base < INDBASE) {
+        return &ComZPop;
+    }
+    if (base >= INDBASE && base < PORTBASE) {
+        return &IndZPop;
+    }
+    return (int *)0;
+}
+
+/* Called by setMapTile() for every tile change */
+void CensusTileChanged(int oldTile, int newTile) {
+    int *oldCounter;
+    int *newCounter;
+
+    oldCounter = CensusCounter(oldTile);
+    newCounter = CensusCounter(newTile);
+
+    if (oldCounter == newCounter) {
+        return;
+    }
+    if (oldCounter) {
+        (*oldCounter)--;
+    }
+    if (newCounter) {
+        (*newCounter)++;
+    }
+}
+
+/* Zero every count this module owns */
+static void ClearCensusTiles(void) {
+    RoadTotal = 0;
+    RailTotal = 0;
+    FirePop = 0;
+    PolicePop = 0;
+    StadiumPop = 0;
+    PortPop = 0;
+    APortPop = 0;
+    NuclearPop = 0;
+    CoalPop = 0;
+    HospPop = 0;
+    ResZPop = 0;
+    ComZPop = 0;
+    IndZPop = 0;
+}
+
+/* Recount everything from the map */
+void RecountCensusTiles(void) {
+    int x, y;
+    int *counter;
+
+    ClearCensusTiles();
+
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            counter = CensusCounter(Map[y][x]);
+            if (counter) {
+                (*counter)++;
+            }
+        }
+    }
+}
+
+#ifdef CENSUS_DEBUG
+/* Compare the running counts with a full recount, returns mismatches */
+int VerifyCensusTiles(void) {
+    int saved[13];
+    int *counts[13];
+    static const char *names[13] = {"Road",    "Rail",    "Fire",    "Police", "Stadium",
+                                    "Port",    "Airport", "Nuclear", "Coal",   "Hospital",
+                                    "ResZone", "ComZone", "IndZone"};
+    int i, errors;
+
+    counts[0] = &RoadTotal;
+    counts[1] = &RailTotal;
+    counts[2] = &FirePop;
+    counts[3] = &PolicePop;
+    counts[4] = &StadiumPop;
+    counts[5] = &PortPop;
+    counts[6] = &APortPop;
+    counts[7] = &NuclearPop;
+    counts[8] = &CoalPop;
+    counts[9] = &HospPop;
+    counts[10] = &ResZPop;
+    counts[11] = &ComZPop;
+    counts[12] = &IndZPop;
+
+    for (i = 0; i < 13; i++) {
+        saved[i] = *counts[i];
+    }
+
+    RecountCensusTiles();
+
+    errors = 0;
+    for (i = 0; i < 13; i++) {
+        if (saved[i] != *counts[i]) {
+            addDebugLog("CENSUS MISMATCH: %s running=%d recount=%d", names[i], saved[i],
+                        *counts[i]);
+            errors++;
+        }
+    }
+    return errors;
+}
+#endif
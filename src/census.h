@@ -0,0 +1,19 @@
+/* census.h - Incremental tile census for WiNTown
+ * Road, rail, zone and special building counts kept current from setMapTile()
+ */
+
+#ifndef _CENSUS_H
+#define _CENSUS_H
+
+/* Called by setMapTile() for every tile change */
+void CensusTileChanged(int oldTile, int newTile);
+
+/* Recount everything from the map */
+void RecountCensusTiles(void);
+
+#ifdef CENSUS_DEBUG
+/* Compare the running counts with a full recount, returns mismatches */
+int VerifyCensusTiles(void);
+#endif
+
+#endif /* _CENSUS_H */
@@ -4,6 +4,7 @@
 
 #include "charts.h"
 #include "sim.h"
+#include "profile.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -517,6 +518,7 @@ LRESULT CALLBACK ChartWndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPa
             RECT clientRect;
             
             hdc = BeginPaint(hwnd, &ps);
+            PROFILE_BEGIN("ChartPaint");
             
             /* Get actual window size */
             GetClientRect(hwnd, &clientRect);
@@ -535,6 +537,7 @@ LRESULT CALLBACK ChartWndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPa
                 FillRect(hdc, &clientRect, GetStockObject(WHITE_BRUSH)); 
                 TextOut(hdc, 10, 10, "Chart system initializing...", 27);
             }
+            PROFILE_END("ChartPaint");
             EndPaint(hwnd, &ps);
             return 0;
         }
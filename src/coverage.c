@@ -0,0 +1,238 @@
+/* coverage.c - Police and fire station coverage for WiNTown
+ * Each station seeds its footprint with a strength taken from funding,
+ * power and road access. Coverage then spreads outward losing a fixed
+ * amount per step, keeping the strongest station at every tile. A bucket
+ * queue ordered by coverage value visits each tile once, so the whole map
+ * costs one pass no matter how many stations there are.
+ */
+
+#include "sim.h"
+#include "coverage.h"
+#include <string.h>
+
+#define COVERAGE_NIL 0xffff
+#define COVERAGE_LEVELS 256
+
+/* Station the coverage spreads from */
+typedef struct {
+    short x, y;
+    Byte strength;
+} CoverageSource;
+
+int CoverageRoadMode = 0;
+
+Byte PoliceCoverage[WORLD_Y][WORLD_X];
+Byte FireCoverage[WORLD_Y][WORLD_X];
+
+static CoverageSource Sources[COVERAGE_TYPES][COVERAGE_MAX_SOURCES];
+static int SourceCount[COVERAGE_TYPES];
+
+/* Bucket queue - one doubly linked list of packed tile indices per level */
+static unsigned short BucketHead[COVERAGE_LEVELS];
+static unsigned short BucketNext[WORLD_X * WORLD_Y];
+static unsigned short BucketPrev[WORLD_X * WORLD_Y];
+static Byte BucketQueued[WORLD_X * WORLD_Y];
+
+/* 8-way neighbour offsets, orthogonal on even entries */
+static const short CoverageDx[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const short CoverageDy[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+/* Station zone tile for each coverage type */
+static const short CoverageStation[COVERAGE_TYPES] = {POLICESTATION, FIRESTATION};
+
+static Byte (*CoverageMap(int type))[WORLD_X] {
+    return type == COVERAGE_FIRE ? FireCoverage : PoliceCoverage;
+}
+
+static int IsCoverageRoad(int tile) {
+    tile &= LOMASK;
+    return tile >= ROADBASE && tile <= LASTROAD;
+}
+
+/* Coverage lost moving from one tile to its neighbour in direction dir */
+static int CoverageStepCost(int x, int y, int tx, int ty, int dir) {
+    int cost;
+
+    cost = (dir & 1) ? COVERAGE_DIAG_STEP : COVERAGE_STEP;
+    if (!CoverageRoadMode) {
+        return cost;
+    }
+
+    /* Roads only join orthogonally */
+    if (!(dir & 1) && IsCoverageRoad(Map[y][x]) && IsCoverageRoad(Map[ty][tx])) {
+        return COVERAGE_ROAD_STEP;
+    }
+    return cost * COVERAGE_OFFROAD_MULT;
+}
+
+static void BucketUnlink(int index, int level) {
+    unsigned short next, prev;
+
+    next = BucketNext[index];
+    prev = BucketPrev[index];
+    if (prev == COVERAGE_NIL) {
+        BucketHead[level] = next;
+    } else {
+        BucketNext[prev] = next;
+    }
+    if (next != COVERAGE_NIL) {
+        BucketPrev[next] = prev;
+    }
+    BucketQueued[index] = 0;
+}
+
+/* Raise a tile to a new coverage level, moving it to that bucket */
+static void BucketRaise(Byte cov[WORLD_Y][WORLD_X], int x, int y, int level) {
+    int index;
+
+    index = y * WORLD_X + x;
+    if (BucketQueued[index]) {
+        BucketUnlink(index, cov[y][x]);
+    }
+
+    cov[y][x] = (Byte)level;
+    BucketPrev[index] = COVERAGE_NIL;
+    BucketNext[index] = BucketHead[level];
+    if (BucketHead[level] != COVERAGE_NIL) {
+        BucketPrev[BucketHead[level]] = (unsigned short)index;
+    }
+    BucketHead[level] = (unsigned short)index;
+    BucketQueued[index] = 1;
+}
+
+/* Register or refresh a station - called from the zone scan */
+void SetCoverageSource(int type, int x, int y, int effect) {
+    CoverageSource *src;
+    int i, strength;
+
+    if (type < 0 || type >= COVERAGE_TYPES || !BOUNDS_CHECK(x, y)) {
+        return;
+    }
+
+    /* Station effect is the funded percentage from DoBudget(), coverage 0-250 */
+    strength = (effect * 250) / 100;
+    if (strength > 250) {
+        strength = 250;
+    }
+    if (strength < 0) {
+        strength = 0;
+    }
+
+    for (i = 0; i < SourceCount[type]; i++) {
+        src = &Sources[type][i];
+        if (src->x == x && src->y == y) {
+            src->strength = (Byte)strength;
+            return;
+        }
+    }
+
+    if (SourceCount[type] < COVERAGE_MAX_SOURCES) {
+        src = &Sources[type][SourceCount[type]++];
+        src->x = (short)x;
+        src->y = (short)y;
+        src->strength = (Byte)strength;
+    }
+}
+
+/* Forget all stations and coverage */
+void ResetCoverage(void) {
+    SourceCount[COVERAGE_POLICE] = 0;
+    SourceCount[COVERAGE_FIRE] = 0;
+    memset(PoliceCoverage, 0, sizeof(PoliceCoverage));
+    memset(FireCoverage, 0, sizeof(FireCoverage));
+}
+
+/* Average each 4x4 block into a quarter-size map */
+static void CoverageToQuarter(Byte cov[WORLD_Y][WORLD_X], Byte quarter[WORLD_Y / 4][WORLD_X / 4]) {
+    static int rowSum[WORLD_X / 4];
+    int x, y;
+
+    for (y = 0; y < WORLD_Y; y++) {
+        if ((y & 3) == 0) {
+            memset(rowSum, 0, sizeof(rowSum));
+        }
+        for (x = 0; x < WORLD_X; x++) {
+            rowSum[x >> 2] += cov[y][x];
+        }
+        if ((y & 3) == 3) {
+            for (x = 0; x < WORLD_X / 4; x++) {
+                quarter[y >> 2][x] = (Byte)(rowSum[x] >> 4);
+            }
+        }
+    }
+}
+
+/* Rebuild a coverage map and its quarter-size summary */
+void BuildCoverage(int type) {
+    Byte(*cov)[WORLD_X];
+    CoverageSource *src;
+    int i, level, index, x, y, dir, tx, ty, value, dx, dy;
+
+    if (type < 0 || type >= COVERAGE_TYPES) {
+        return;
+    }
+
+    cov = CoverageMap(type);
+    memset(cov, 0, sizeof(PoliceCoverage));
+    memset(BucketQueued, 0, sizeof(BucketQueued));
+    for (level = 0; level < COVERAGE_LEVELS; level++) {
+        BucketHead[level] = COVERAGE_NIL;
+    }
+
+    /* Drop stations that have been destroyed, seed the rest over their footprint */
+    i = 0;
+    while (i < SourceCount[type]) {
+        src = &Sources[type][i];
+        if (!(Map[src->y][src->x] & ZONEBIT) ||
+            (Map[src->y][src->x] & LOMASK) != CoverageStation[type]) {
+            *src = Sources[type][--SourceCount[type]];
+            continue;
+        }
+        for (dy = -1; dy <= 1; dy++) {
+            for (dx = -1; dx <= 1; dx++) {
+                tx = src->x + dx;
+                ty = src->y + dy;
+                if (BOUNDS_CHECK(tx, ty) && src->strength > cov[ty][tx]) {
+                    BucketRaise(cov, tx, ty, src->strength);
+                }
+            }
+        }
+        i++;
+    }
+
+    /* Highest level first - a tile is final once its bucket comes up */
+    for (level = COVERAGE_LEVELS - 1; level > 0; level--) {
+        while (BucketHead[level] != COVERAGE_NIL) {
+            index = BucketHead[level];
+            BucketUnlink(index, level);
+            x = index % WORLD_X;
+            y = index / WORLD_X;
+
+            for (dir = 0; dir < 8; dir++) {
+                tx = x + CoverageDx[dir];
+                ty = y + CoverageDy[dir];
+                if (!BOUNDS_CHECK(tx, ty)) {
+                    continue;
+                }
+                value = level - CoverageStepCost(x, y, tx, ty, dir);
+                if (value > cov[ty][tx]) {
+                    BucketRaise(cov, tx, ty, value);
+                }
+            }
+        }
+    }
+
+    if (type == COVERAGE_FIRE) {
+        CoverageToQuarter(cov, FireStMap);
+    } else {
+        CoverageToQuarter(cov, PoliceMap);
+    }
+}
+
+/* Coverage at a tile, 0 when outside the map */
+int GetCoverage(int type, int x, int y) {
+    if (type < 0 || type >= COVERAGE_TYPES || !BOUNDS_CHECK(x, y)) {
+        return 0;
+    }
+    return CoverageMap(type)[y][x];
+}
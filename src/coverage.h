@@ -0,0 +1,39 @@
+/* coverage.h - Police and fire station coverage for WiNTown
+ * Full resolution coverage from all stations in one bucket-queue pass
+ */
+
+#ifndef _COVERAGE_H
+#define _COVERAGE_H
+
+/* Coverage types */
+#define COVERAGE_POLICE 0
+#define COVERAGE_FIRE   1
+#define COVERAGE_TYPES  2
+
+/* Station limit per type */
+#define COVERAGE_MAX_SOURCES 256
+
+/* Coverage lost per tile stepped, orthogonal and diagonal */
+#define COVERAGE_STEP       16
+#define COVERAGE_DIAG_STEP  22
+
+/* Road distance mode - cheap along roads, expensive across country */
+#define COVERAGE_ROAD_STEP  6
+#define COVERAGE_OFFROAD_MULT 2
+
+/* Measure distance along the road network instead of straight line */
+extern int CoverageRoadMode;
+
+/* Full resolution coverage maps (0 = none) */
+extern Byte PoliceCoverage[WORLD_Y][WORLD_X];
+extern Byte FireCoverage[WORLD_Y][WORLD_X];
+
+/* Station registration - effect is the funded percentage, 100 for full strength */
+void SetCoverageSource(int type, int x, int y, int effect);
+void ResetCoverage(void);
+
+/* Rebuild a coverage map and its quarter-size summary */
+void BuildCoverage(int type);
+int GetCoverage(int type, int x, int y);
+
+#endif /* _COVERAGE_H */
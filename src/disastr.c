@@ -6,6 +6,7 @@
 #include "tiles.h"
 #include "notify.h"
 #include "sprite.h"
+#include "water.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <windows.h>
@@ -19,6 +20,7 @@ extern int SimRandom(int range);
 
 /* External variables */
 extern HWND hwndMain;
+extern int disastersDisabled;
 extern short Map[WORLD_Y][WORLD_X];
 
 /* Common movement direction arrays */
@@ -201,6 +203,7 @@ void spreadFire(void) {
 /* Create a monster (Godzilla-like) disaster */
 void makeMonster(void) {
     int x, y;
+    int shoreCount;
     SimSprite *monster;
 
     /* Log the monster disaster */
@@ -208,8 +211,11 @@ void makeMonster(void) {
     addGameLog("Monster is destroying everything in its path!");
     addDebugLog("Monster disaster starting - creating animated sprite");
 
-    /* Find a good starting position (preferably at edge of map) */
-    if (SimRandom(2) == 0) {
+    /* Rise out of the water if there is any, otherwise walk in from an edge */
+    shoreCount = GetShoreCount();
+    if (shoreCount > 0) {
+        GetShoreTile(SimRandom(shoreCount), &x, &y);
+    } else if (SimRandom(2) == 0) {
         /* Start from left or right edge */
         x = (SimRandom(2) == 0) ? 0 : (WORLD_X - 1);
         y = SimRandom(WORLD_Y);
@@ -237,85 +243,212 @@ void makeMonster(void) {
     InvalidateRect(hwndMain, NULL, FALSE);
 }
 
+/* Flood engine
+ * A flood keeps a frontier queue of flooded tiles that still have dry
+ * neighbours. DoFlood() runs once per simulation cycle of 16 ticks. It
+ * expands a limited number of them while the water is rising, then drains
+ * the oldest flooded tiles back to dirt (or rubble where something was
+ * built) a few at a time. */
+#define FLOOD_MAP_TILES (WORLD_X * WORLD_Y)
+#define FLOOD_BUILT_FLAG 0x4000 /* Recede to rubble instead of dirt */
+#define FLOOD_INDEX_MASK 0x3fff
+
+/* Tiles the water may take over: bare dirt or anything bulldozable and burnable */
+#define FLOODABLE(t) ((t) == DIRT || (((t) & BULLBIT) && ((t) & BURNBIT)))
+
+/* Tunables - tiles per cycle and cycles of rising water */
+int FloodSpreadBudget = 24;
+int FloodRecedeBudget = 8;
+int FloodRiseCycles = 16;
+int FloodMaxTiles = 400;
+
+/* Frontier queue (ring buffer of packed y * WORLD_X + x indices) */
+static unsigned short FloodFront[FLOOD_MAP_TILES];
+static int FloodFrontHead = 0;
+static int FloodFrontCount = 0;
+
+/* Every tile this flood has covered, oldest first, for recession */
+static unsigned short FloodTiles[FLOOD_MAP_TILES];
+static int FloodTilesHead = 0;
+static int FloodTilesCount = 0;
+
+static int FloodRiseTimer = 0; /* Cycles of rising water left */
+static int FloodTotal = 0;     /* Tiles flooded by the current flood */
+
+/* Clear all flood state (new city, scenario or load) */
+void ResetFlood(void) {
+    FloodFrontHead = 0;
+    FloodFrontCount = 0;
+    FloodTilesHead = 0;
+    FloodTilesCount = 0;
+    FloodRiseTimer = 0;
+    FloodTotal = 0;
+}
+
+/* Number of tiles currently under flood water */
+int GetFloodTileCount(void) {
+    return FloodTilesCount;
+}
+
+/* Put a single tile under water and queue it for spreading and recession */
+static int FloodTile(int x, int y, char *caller) {
+    unsigned short index;
+
+    if (FloodTilesCount >= FLOOD_MAP_TILES || FloodFrontCount >= FLOOD_MAP_TILES) {
+        return 0;
+    }
+
+    index = (unsigned short)(y * WORLD_X + x);
+    if (Map[y][x] != DIRT) {
+        index |= FLOOD_BUILT_FLAG;
+    }
+
+    setMapTile(x, y, FLOOD + SimRandom(4), 0, TILE_SET_REPLACE, caller);
+
+    FloodFront[(FloodFrontHead + FloodFrontCount) % FLOOD_MAP_TILES] = index;
+    FloodFrontCount++;
+    FloodTiles[(FloodTilesHead + FloodTilesCount) % FLOOD_MAP_TILES] = index;
+    FloodTilesCount++;
+    FloodTotal++;
+    return 1;
+}
+
+/* Expand up to FloodSpreadBudget frontier tiles by one step */
+static void SpreadFlood(void) {
+    int budget, dir, x, y, tx, ty;
+    int blocked;
+    unsigned short index;
+
+    budget = FloodSpreadBudget;
+    while (budget > 0 && FloodFrontCount > 0 && FloodTotal < FloodMaxTiles) {
+        index = FloodFront[FloodFrontHead];
+        FloodFrontHead = (FloodFrontHead + 1) % FLOOD_MAP_TILES;
+        FloodFrontCount--;
+        budget--;
+
+        x = (index & FLOOD_INDEX_MASK) % WORLD_X;
+        y = (index & FLOOD_INDEX_MASK) / WORLD_X;
+
+        /* Tile was drained or rebuilt since it was queued */
+        if ((Map[y][x] & LOMASK) < FLOOD || (Map[y][x] & LOMASK) > LASTFLOOD) {
+            continue;
+        }
+
+        /* Water does not take every neighbour at once, so requeue the tile
+         * while it still has dry floodable neighbours */
+        blocked = 0;
+        for (dir = 0; dir < 4; dir++) {
+            tx = x + xDelta[dir];
+            ty = y + yDelta[dir];
+            if (!BOUNDS_CHECK(tx, ty) || !FLOODABLE(Map[ty][tx])) {
+                continue;
+            }
+            if (SimRandom(4) == 0 || FloodTotal >= FloodMaxTiles) {
+                blocked = 1;
+                continue;
+            }
+            FloodTile(tx, ty, "SpreadFlood");
+        }
+
+        if (blocked && FloodFrontCount < FLOOD_MAP_TILES) {
+            FloodFront[(FloodFrontHead + FloodFrontCount) % FLOOD_MAP_TILES] = index;
+            FloodFrontCount++;
+        }
+    }
+}
+
+/* Drain up to FloodRecedeBudget of the oldest flooded tiles */
+static void RecedeFlood(void) {
+    int budget, x, y;
+    short tileValue;
+    unsigned short index;
+
+    budget = FloodRecedeBudget;
+    while (budget > 0 && FloodTilesCount > 0) {
+        index = FloodTiles[FloodTilesHead];
+        FloodTilesHead = (FloodTilesHead + 1) % FLOOD_MAP_TILES;
+        FloodTilesCount--;
+
+        x = (index & FLOOD_INDEX_MASK) % WORLD_X;
+        y = (index & FLOOD_INDEX_MASK) / WORLD_X;
+
+        /* Only drain tiles that are still under water */
+        tileValue = Map[y][x] & LOMASK;
+        if (tileValue < FLOOD || tileValue > LASTFLOOD) {
+            continue;
+        }
+
+        if (index & FLOOD_BUILT_FLAG) {
+            setMapTile(x, y, RUBBLE + SimRandom(4), BULLBIT, TILE_SET_REPLACE, "RecedeFlood-rubble");
+        } else {
+            setMapTile(x, y, DIRT, 0, TILE_SET_REPLACE, "RecedeFlood-dirt");
+        }
+        budget--;
+    }
+
+    if (FloodTilesCount == 0) {
+        FloodTotal = 0;
+    }
+}
+
+/* Advance the flood by one cycle - called from the simulation loop */
+void DoFlood(void) {
+    if (FloodTilesCount == 0) {
+        return;
+    }
+
+    if (FloodRiseTimer > 0 && !disastersDisabled) {
+        FloodRiseTimer--;
+        SpreadFlood();
+        return;
+    }
+
+    /* Water has stopped rising */
+    FloodFrontCount = 0;
+    RecedeFlood();
+}
+
 /* Create a flood disaster */
 void makeFlood(void) {
-    int x, y, xx, yy, tx, ty;
-    int waterFound = 0;
-    int attempts = 0;
-    int t, i, j;
-    short tileValue;
+    int x, y, tx, ty, i;
+    int shoreCount;
 
     /* Log the flood disaster */
     addGameLog("DISASTER: Flooding has been reported!");
     addGameLog("Water levels are rising in low-lying areas!");
     addDebugLog("Flood disaster starting from water edge");
 
-    /* Try to find water edge to start flood, with a reasonable attempt limit */
-    while (!waterFound && attempts < 300) {
-        /* Generate random coordinates within world bounds */
-        x = SimRandom(WORLD_X);
-        y = SimRandom(WORLD_Y);
+    /* Start at a floodable shoreline tile from the water index */
+    shoreCount = GetShoreCount();
+    for (i = 0; i < 16 && shoreCount > 0; i++) {
+        GetShoreTile(SimRandom(shoreCount), &x, &y);
+        if (FLOODABLE(Map[y][x])) {
+            break;
+        }
+    }
+    if (shoreCount == 0 || i == 16) {
+        addDebugLog("Flood: no floodable shoreline on this map");
+        return;
+    }
 
-        /* Validate coordinates */
-        if (BOUNDS_CHECK(x, y)) {
-            tileValue = Map[y][x] & LOMASK;
-
-            /* Look for river/water tiles */
-            if (tileValue > 4 && tileValue < 21) {
-                /* Check all four adjacent tiles */
-                for (t = 0; t < 4; t++) {
-                    xx = x + xDelta[t];
-                    yy = y + yDelta[t];
-
-                    /* Check if adjacent tile is in bounds and floodable */
-                    if (BOUNDS_CHECK(xx, yy)) {
-                        if (Map[yy][xx] == DIRT ||
-                            ((Map[yy][xx] & BULLBIT) && (Map[yy][xx] & BURNBIT))) {
-
-                            /* Create initial flood tile */
-                            setMapTile(xx, yy, FLOOD, 0, TILE_SET_REPLACE, "makeFlood-initial");
-                            waterFound = 1;
-
-                            /* Show enhanced notification dialog */
-                            ShowNotificationAt(NOTIF_FLOODING, xx, yy);
-
-                            /* Start spreading the flood - limit to 100 iterations */
-                            for (i = 0; i < 100; i++) {
-                                /* Check adjacent tiles */
-                                for (j = 0; j < 4; j++) {
-                                    tx = xx + xDelta[j];
-                                    ty = yy + yDelta[j];
-
-                                    /* Only flood tiles that are in bounds and floodable */
-                                    if (BOUNDS_CHECK(tx, ty)) {
-                                        if (Map[ty][tx] == DIRT ||
-                                            ((Map[ty][tx] & BULLBIT) && (Map[ty][tx] & BURNBIT))) {
-                                            setMapTile(tx, ty, FLOOD, 0, TILE_SET_REPLACE, "makeFlood-adjacent");
-                                        }
-                                    }
-                                }
-
-                                /* Also try a random position near the original water source */
-                                tx = x + SimRandom(10) - 5;
-                                ty = y + SimRandom(10) - 5;
-
-                                if (BOUNDS_CHECK(tx, ty)) {
-                                    if (Map[ty][tx] == DIRT ||
-                                        ((Map[ty][tx] & BULLBIT) && (Map[ty][tx] & BURNBIT))) {
-                                        setMapTile(tx, ty, FLOOD, 0, TILE_SET_REPLACE, "makeFlood-random");
-                                    }
-                                }
-                            }
-
-                            break;
-                        }
-                    }
-                }
-            }
+    FloodTotal = 0;
+    FloodTile(x, y, "makeFlood-initial");
+
+    /* Flood the neighbouring shore as well for a wider front */
+    for (i = 0; i < 4; i++) {
+        tx = x + xDelta[i];
+        ty = y + yDelta[i];
+        if (BOUNDS_CHECK(tx, ty) && FLOODABLE(Map[ty][tx])) {
+            FloodTile(tx, ty, "makeFlood-initial");
         }
-        attempts++;
     }
 
+    FloodRiseTimer = FloodRiseCycles;
+    addDebugLog("Flood: %d shoreline tiles, starting at %d,%d", shoreCount, x, y);
+
+    /* Show enhanced notification dialog */
+    ShowNotificationAt(NOTIF_FLOODING, x, y);
+
     /* Force redraw */
     InvalidateRect(hwndMain, NULL, FALSE);
 }
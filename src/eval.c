@@ -35,9 +35,6 @@ static short ProblemOrder[4];       /* Top 4 problems, in order */
 static long deltaCityPop;           /* Population change */
 static QUAD CityAssValue;           /* City assessed value */
 static short AverageCityScore;      /* Average score over time */
-static int HospPop;                 /* Hospital population count */
-static int NuclearPop;              /* Nuclear plant count */
-static int CoalPop;                 /* Coal plant count */
 
 /* Function prototypes */
 static void GetAssValue(void);
@@ -262,20 +259,11 @@ static void VoteProblems(void) {
 /* Calculate average traffic */
 static int AverageTrf(void) {
     QUAD TrfTotal;
-    int x, y, count;
+    int count;
 
-    TrfTotal = 0;
-    count = 1; /* Start at 1 to avoid division by zero */
-
-    /* Sum up traffic in developed areas */
-    for (x = 0; x < WORLD_X / 2; x++) {
-        for (y = 0; y < WORLD_Y / 2; y++) {
-            if (LandValueMem[y][x]) {
-                TrfTotal += TrfDensity[y][x];
-                count++;
-            }
-        }
-    }
+    /* Traffic in developed areas, summed by CalcTrafficAverage() */
+    TrfTotal = DevTrfTotal;
+    count = DevTrfCount + 1; /* Start at 1 to avoid division by zero */
 
     /* Calculate average with scaling */
     TrafficAverage = (int)((TrfTotal / count) * 2.4);
@@ -587,36 +575,6 @@ void CityEvaluation(void) {
     EvalValid = 1;
 }
 
-/* Count the number of each special building type */
-void CountSpecialTiles(void) {
-    int x, y;
-    short tile;
-
-    /* Reset counters */
-    HospPop = 0;
-    CoalPop = 0;
-    NuclearPop = 0;
-
-    /* Scan the map for special tiles */
-    for (x = 0; x < WORLD_X; x++) {
-        for (y = 0; y < WORLD_Y; y++) {
-            tile = Map[y][x] & LOMASK;
-
-            /* Check for zone centers */
-            if (Map[y][x] & ZONEBIT) {
-                /* Check tile types */
-                if (tile == HOSPITAL) {
-                    HospPop++;
-                } else if (tile == POWERPLANT) {
-                    CoalPop++;
-                } else if (tile == NUCLEAR) {
-                    NuclearPop++;
-                }
-            }
-        }
-    }
-}
-
 /* Get problem description by index */
 const char *GetProblemText(int problemIndex) {
     switch (problemIndex) {
@@ -0,0 +1,176 @@
+/* events.c - Simulation event bus for WiNTown
+ * A single-producer, single-consumer ring: the simulation only advances
+ * the tail and the dispatcher only advances the head, so neither side
+ * takes a lock or waits on the other. Repeats of the same event at the
+ * same location are merged on the producer side before they reach the
+ * ring, and the merged count travels with the next report that gets
+ * through.
+ */
+
+#include "sim.h"
+#include "events.h"
+#include <windows.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Recently published events, for merging repeats */
+#define EVENT_RECENT 32
+
+typedef struct {
+    int type;
+    int x, y;
+    int cycle;   /* CityTime the last report went out */
+    int merged;  /* Repeats swallowed since then */
+} RecentEvent;
+
+typedef struct {
+    SimEventProc proc;
+    void *userData;
+} EventSubscriber;
+
+static SimEvent EventRing[EVENT_QUEUE_SIZE];
+static volatile LONG EventHead = 0; /* Next event to dispatch - consumer owned */
+static volatile LONG EventTail = 0; /* Next free slot - producer owned */
+
+static RecentEvent RecentEvents[EVENT_RECENT];
+static int RecentCount = 0;
+static int RecentNext = 0;
+
+static EventSubscriber Subscribers[EVENT_MAX_SUBSCRIBERS];
+static int SubscriberCount = 0;
+
+static long DroppedEvents = 0;
+static long CoalescedEvents = 0;
+static long ReportedDrops = 0;
+
+/* Publish an event. Returns 1 if queued, 0 if merged or dropped. */
+int PublishEvent(int type, int severity, int x, int y) {
+    RecentEvent *recent;
+    SimEvent *event;
+    LONG tail;
+    int i, count;
+
+    /* Merge with a recent report of the same event */
+    recent = NULL;
+    for (i = 0; i < RecentCount; i++) {
+        if (RecentEvents[i].type == type && RecentEvents[i].x == x && RecentEvents[i].y == y) {
+            recent = &RecentEvents[i];
+            break;
+        }
+    }
+
+    if (recent && CityTime >= recent->cycle && CityTime - recent->cycle < EVENT_COALESCE_TIME) {
+        recent->merged++;
+        CoalescedEvents++;
+        return 0;
+    }
+
+    count = 1;
+    if (recent) {
+        count += recent->merged;
+    } else {
+        /* Take a free entry, or recycle the oldest */
+        if (RecentCount < EVENT_RECENT) {
+            recent = &RecentEvents[RecentCount++];
+        } else {
+            recent = &RecentEvents[RecentNext];
+            RecentNext = (RecentNext + 1) % EVENT_RECENT;
+            /* Its swallowed repeats will never be reported now */
+            DroppedEvents += recent->merged;
+        }
+        recent->type = type;
+        recent->x = x;
+        recent->y = y;
+    }
+    recent->cycle = CityTime;
+
+    tail = EventTail;
+    if (tail - EventHead >= EVENT_QUEUE_SIZE) {
+        /* Nobody is draining the queue - keep the older events, and let
+           the next report that gets through carry this one's count */
+        recent->merged = count;
+        DroppedEvents++;
+        return 0;
+    }
+    recent->merged = 0;
+
+    event = &EventRing[tail % EVENT_QUEUE_SIZE];
+    event->type = type;
+    event->severity = severity;
+    event->x = x;
+    event->y = y;
+    event->cycle = CityTime;
+    event->count = count;
+
+    /* Make the record visible before the new tail */
+    InterlockedExchange((LONG *)&EventTail, tail + 1);
+    return 1;
+}
+
+/* Forget pending and recent events - call while nothing is dispatching */
+void ResetEvents(void) {
+    EventHead = EventTail;
+    RecentCount = 0;
+    RecentNext = 0;
+    DroppedEvents = 0;
+    CoalescedEvents = 0;
+    ReportedDrops = 0;
+}
+
+/* Add a subscriber. Returns 0 if the table is full. */
+int SubscribeEvents(SimEventProc proc, void *userData) {
+    if (!proc || SubscriberCount >= EVENT_MAX_SUBSCRIBERS) {
+        return 0;
+    }
+    Subscribers[SubscriberCount].proc = proc;
+    Subscribers[SubscriberCount].userData = userData;
+    SubscriberCount++;
+    return 1;
+}
+
+void UnsubscribeEvents(SimEventProc proc, void *userData) {
+    int i;
+
+    for (i = 0; i < SubscriberCount; i++) {
+        if (Subscribers[i].proc == proc && Subscribers[i].userData == userData) {
+            Subscribers[i] = Subscribers[--SubscriberCount];
+            return;
+        }
+    }
+}
+
+/* Hand every pending event to the subscribers. Returns the number delivered. */
+int DispatchEvents(void) {
+    SimEvent event;
+    LONG head;
+    int i, delivered;
+
+    delivered = 0;
+    head = EventHead;
+    while (head != EventTail) {
+        /* Copy out first so a subscriber may publish or block safely */
+        event = EventRing[head % EVENT_QUEUE_SIZE];
+        head++;
+        InterlockedExchange((LONG *)&EventHead, head);
+
+        for (i = 0; i < SubscriberCount; i++) {
+            Subscribers[i].proc(&event, Subscribers[i].userData);
+        }
+        delivered++;
+    }
+
+    if (DroppedEvents != ReportedDrops) {
+        addDebugLog("Event queue overflowed, %ld events dropped so far", DroppedEvents);
+        ReportedDrops = DroppedEvents;
+    }
+    return delivered;
+}
+
+long GetDroppedEventCount(void) {
+    return DroppedEvents;
+}
+
+long GetCoalescedEventCount(void) {
+    return CoalescedEvents;
+}
@@ -0,0 +1,42 @@
+/* events.h - Simulation event bus for WiNTown
+ * The simulation publishes structured event records; the UI, the game log
+ * and headless drivers read them back through subscribers.
+ */
+
+#ifndef _EVENTS_H
+#define _EVENTS_H
+
+/* Pending events the queue can hold before new ones are dropped */
+#define EVENT_QUEUE_SIZE 64
+
+/* Repeats of an event at the same spot within this many CityTime ticks are merged */
+#define EVENT_COALESCE_TIME 48
+
+/* Subscriber limit */
+#define EVENT_MAX_SUBSCRIBERS 8
+
+/* One simulation event */
+typedef struct {
+    int type;      /* NOTIF_* id from notify.h */
+    int severity;  /* NotificationType of the event */
+    int x, y;      /* Map location, -1 when the event has none */
+    int cycle;     /* CityTime when it was published */
+    int count;     /* Reports merged into this one, including itself */
+} SimEvent;
+
+typedef void (*SimEventProc)(const SimEvent *event, void *userData);
+
+/* Producer side - simulation */
+int PublishEvent(int type, int severity, int x, int y);
+void ResetEvents(void);
+
+/* Consumer side - UI thread or batch driver */
+int SubscribeEvents(SimEventProc proc, void *userData);
+void UnsubscribeEvents(SimEventProc proc, void *userData);
+int DispatchEvents(void);
+
+/* Statistics */
+long GetDroppedEventCount(void);
+long GetCoalescedEventCount(void);
+
+#endif /* _EVENTS_H */
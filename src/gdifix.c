@@ -218,8 +218,9 @@ int validateTilesetFormat(HBITMAP hBitmap) {
         return 0;
     }
     
-    /* Check dimensions - tilesets must be 512x480 */
-    if (bm.bmWidth != 512 || bm.bmHeight != 480) {
+    /* Check dimensions - tilesets must be 512x480, and an atlas keeps its
+       sprite frames in the rows below the tiles */
+    if (bm.bmWidth != 512 || bm.bmHeight < 480) {
         return 0;
     }
     
@@ -0,0 +1,165 @@
+/* hashdiff.c - Compare two WiNTown state hash logs
+ * Console tool: finds the first simulation pass where two runs of the
+ * same city part, and which subsystems differ there.
+ *
+ * Usage: hashdiff [-a] first.log second.log
+ *   -a  list every differing pass, not just the first
+ *
+ * Exit status is 0 when the runs match, 1 when they differ, 2 on error.
+ */
+
+#include "statehash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HASHDIFF_LINE 512
+
+typedef struct {
+    FILE *f;
+    const char *path;
+    char names[STATEHASH_PARTS][32];
+} HashLog;
+
+static int OpenLog(HashLog *log, const char *path) {
+    char line[HASHDIFF_LINE];
+    char *tok;
+    int i;
+
+    log->path = path;
+    for (i = 0; i < STATEHASH_PARTS; i++) {
+        sprintf(log->names[i], "part%d", i);
+    }
+
+    log->f = fopen(path, "r");
+    if (!log->f) {
+        fprintf(stderr, "hashdiff: cannot open %s\n", path);
+        return 0;
+    }
+    if (!fgets(line, sizeof(line), log->f) ||
+        strncmp(line, STATEHASH_LOG_HEADER, strlen(STATEHASH_LOG_HEADER)) != 0) {
+        fprintf(stderr, "hashdiff: %s is not a state hash log\n", path);
+        fclose(log->f);
+        return 0;
+    }
+
+    /* Column names - "# serial citytime total name..." */
+    if (fgets(line, sizeof(line), log->f) && line[0] == '#') {
+        tok = strtok(line + 1, " \t\r\n");
+        for (i = -3; tok && i < STATEHASH_PARTS; i++) {
+            if (i >= 0) {
+                strncpy(log->names[i], tok, sizeof(log->names[i]) - 1);
+                log->names[i][sizeof(log->names[i]) - 1] = '\0';
+            }
+            tok = strtok(NULL, " \t\r\n");
+        }
+    }
+    return 1;
+}
+
+/* Read the next pass - returns 0 at end of log */
+static int ReadPass(HashLog *log, StateHash *hash) {
+    char line[HASHDIFF_LINE];
+    char *p, *end;
+    int i;
+
+    while (fgets(line, sizeof(line), log->f)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        p = line;
+        hash->serial = strtol(p, &end, 10);
+        p = end;
+        hash->cityTime = strtol(p, &end, 10);
+        p = end;
+        hash->total = strtoul(p, &end, 16);
+        for (i = 0; i < STATEHASH_PARTS; i++) {
+            p = end;
+            hash->part[i] = strtoul(p, &end, 16);
+        }
+        if (end == p) {
+            fprintf(stderr, "hashdiff: %s: bad line for pass %ld\n", log->path, hash->serial);
+            return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static void ReportPass(HashLog *a, StateHash *ha, StateHash *hb) {
+    int i;
+
+    printf("pass %ld (CityTime %ld / %ld):", ha->serial, ha->cityTime, hb->cityTime);
+    if (ha->cityTime != hb->cityTime) {
+        printf(" time");
+    }
+    for (i = 0; i < STATEHASH_PARTS; i++) {
+        if (ha->part[i] != hb->part[i]) {
+            printf(" %s", a->names[i]);
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    HashLog a, b;
+    StateHash ha, hb;
+    int listAll, argi, moreA, moreB;
+    long passes, differing;
+
+    listAll = 0;
+    argi = 1;
+    if (argi < argc && strcmp(argv[argi], "-a") == 0) {
+        listAll = 1;
+        argi++;
+    }
+    if (argc - argi != 2) {
+        fprintf(stderr, "usage: hashdiff [-a] first.log second.log\n");
+        return 2;
+    }
+
+    if (!OpenLog(&a, argv[argi])) {
+        return 2;
+    }
+    if (!OpenLog(&b, argv[argi + 1])) {
+        fclose(a.f);
+        return 2;
+    }
+
+    passes = 0;
+    differing = 0;
+    for (;;) {
+        moreA = ReadPass(&a, &ha);
+        moreB = ReadPass(&b, &hb);
+        if (!moreA || !moreB) {
+            break;
+        }
+        passes++;
+
+        if (ha.total == hb.total && ha.cityTime == hb.cityTime) {
+            continue;
+        }
+        if (differing == 0) {
+            printf("Runs part at ");
+        }
+        differing++;
+        ReportPass(&a, &ha, &hb);
+        if (!listAll) {
+            break;
+        }
+    }
+
+    if (differing == 0) {
+        if (moreA != moreB) {
+            printf("Runs match for %ld passes, then %s ends\n", passes, moreA ? b.path : a.path);
+        } else {
+            printf("Runs match for all %ld passes\n", passes);
+        }
+    } else if (listAll) {
+        printf("%ld of %ld passes differ\n", differing, passes);
+    }
+
+    fclose(a.f);
+    fclose(b.f);
+    return differing ? 1 : 0;
+}
@@ -0,0 +1,570 @@
+/* journal.c - Tile change journal for WiNTown
+ * Map changes are marked in a dirty bitmap as they happen. At the end of
+ * each frame the dirty tiles are written in map order as a varint gap
+ * and the final tile value, so a tile that changes many times in a frame
+ * costs three bytes or so once. Finished frames are handed to a writer
+ * thread that appends them to the file; while it is busy the simulation
+ * keeps batching into its own buffer and never waits on the disk. The
+ * build uses the single-threaded CRT, so the writer only makes Win32 file
+ * calls on a handle, and stdio stays on the simulation's thread.
+ *
+ * File layout, all little-endian:
+ *   header:  magic, version, checkpoint map checksum, checkpoint CityTime
+ *   cycle:   kind, serial, CityTime, Fcycle, TotalFunds, random state,
+ *            random draws, tile count, tile count x {gap varint, tile}
+ *
+ * A player's tool shows up as the tiles and funds it changed, so the
+ * cycle records alone reproduce the city. Journals from earlier builds
+ * also hold tool records (kind, tool, x, y, result), which are skipped.
+ * A journal that does not match its city is renamed aside, never
+ * overwritten, so it can still be looked at by hand.
+ */
+
+#include "sim.h"
+#include "tiles.h"
+#include "journal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <io.h>
+#include <windows.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+extern void addGameLog(const char *format, ...);
+
+#define JOURNAL_TILES (WORLD_X * WORLD_Y)
+#define JOURNAL_WORDS ((JOURNAL_TILES + 31) / 32)
+
+/* Initial buffer size - grows as needed */
+#define JOURNAL_BUFFER_SIZE 16384
+
+typedef struct {
+    unsigned char *data;
+    long len;
+    long size;
+} JournalBuffer;
+
+int JournalEnabled = 0;
+int JournalActive = 0;
+
+static HANDLE journalFile = INVALID_HANDLE_VALUE;
+static char journalPath[MAX_PATH];
+
+/* Simulation side batch, and the one the writer thread owns while pending */
+static JournalBuffer fillBuf;
+static JournalBuffer writeBuf;
+static volatile LONG writePending = 0;
+static volatile LONG writerQuit = 0;
+static HANDLE writerThread = NULL;
+static HANDLE writerEvent = NULL;
+
+/* Tiles changed this frame */
+static unsigned long dirtyBits[JOURNAL_WORDS];
+static int dirtyCount = 0;
+static QUAD fundsAtCycle = 0;
+
+static long cycleSerial = 0;
+static unsigned long drawsAtCycle = 0;
+
+/* Map checksum of the city file as last loaded */
+static unsigned long checkpointChecksum = 0;
+
+/* One record's tiles, held until the record is known to be complete */
+static short replayIndex[JOURNAL_TILES];
+static unsigned short replayTile[JOURNAL_TILES];
+
+/* FNV-1a over the map - ties a journal to the city file it follows */
+static unsigned long MapChecksum(void) {
+    unsigned long hash = 2166136261UL;
+    int x, y;
+
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            hash = ((hash ^ (Map[y][x] & 0xFF)) * 16777619UL) & 0xFFFFFFFFUL;
+            hash = ((hash ^ ((Map[y][x] >> 8) & 0xFF)) * 16777619UL) & 0xFFFFFFFFUL;
+        }
+    }
+    return hash;
+}
+
+/* Journal file name for a city file */
+static void JournalPathFor(const char *cityFile, char *path) {
+    char *dot;
+    char *slash;
+
+    strncpy(path, cityFile, MAX_PATH - 5);
+    path[MAX_PATH - 5] = '\0';
+    dot = strrchr(path, '.');
+    slash = strrchr(path, '\\');
+    if (dot && (!slash || dot > slash)) {
+        *dot = '\0';
+    }
+    strcat(path, JOURNAL_EXT);
+}
+
+/* Buffer output */
+static int ReserveBuffer(JournalBuffer *buf, long bytes) {
+    unsigned char *data;
+    long size;
+
+    if (buf->len + bytes <= buf->size) {
+        return 1;
+    }
+    size = buf->size ? buf->size : JOURNAL_BUFFER_SIZE;
+    while (size < buf->len + bytes) {
+        size *= 2;
+    }
+    data = (unsigned char *)realloc(buf->data, size);
+    if (!data) {
+        return 0;
+    }
+    buf->data = data;
+    buf->size = size;
+    return 1;
+}
+
+static void PutByte(JournalBuffer *buf, int value) {
+    buf->data[buf->len++] = (unsigned char)value;
+}
+
+static void PutShort(JournalBuffer *buf, int value) {
+    PutByte(buf, value & 0xFF);
+    PutByte(buf, (value >> 8) & 0xFF);
+}
+
+static void PutLong(JournalBuffer *buf, unsigned long value) {
+    PutShort(buf, (int)(value & 0xFFFF));
+    PutShort(buf, (int)((value >> 16) & 0xFFFF));
+}
+
+static void PutVarint(JournalBuffer *buf, unsigned int value) {
+    while (value >= 0x80) {
+        PutByte(buf, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    PutByte(buf, value);
+}
+
+/* File input - return 0 at end of file */
+static int GetByte(FILE *f, int *value) {
+    int c = fgetc(f);
+    if (c == EOF) {
+        return 0;
+    }
+    *value = c;
+    return 1;
+}
+
+static int GetShort(FILE *f, int *value) {
+    int lo, hi;
+    if (!GetByte(f, &lo) || !GetByte(f, &hi)) {
+        return 0;
+    }
+    *value = lo | (hi << 8);
+    return 1;
+}
+
+static int GetLong(FILE *f, unsigned long *value) {
+    int lo, hi;
+    if (!GetShort(f, &lo) || !GetShort(f, &hi)) {
+        return 0;
+    }
+    *value = (unsigned long)lo | ((unsigned long)hi << 16);
+    return 1;
+}
+
+static int GetVarint(FILE *f, unsigned int *value) {
+    int c, shift;
+
+    *value = 0;
+    for (shift = 0; shift < 28; shift += 7) {
+        if (!GetByte(f, &c)) {
+            return 0;
+        }
+        *value |= (unsigned int)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void WriteBuffer(JournalBuffer *buf) {
+    DWORD written;
+
+    if (buf->len > 0) {
+        WriteFile(journalFile, buf->data, (DWORD)buf->len, &written, NULL);
+        buf->len = 0;
+    }
+}
+
+/* Writer thread - appends each batch it is handed */
+static DWORD WINAPI JournalWriter(LPVOID param) {
+    for (;;) {
+        WaitForSingleObject(writerEvent, INFINITE);
+        if (writePending) {
+            WriteBuffer(&writeBuf);
+            InterlockedExchange((LONG *)&writePending, 0);
+        }
+        if (writerQuit) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/* Give the batch to the writer, unless it is still busy with the last one */
+static void HandOffBatch(void) {
+    JournalBuffer swap;
+
+    if (fillBuf.len == 0) {
+        return;
+    }
+    if (!writerThread) {
+        WriteBuffer(&fillBuf);
+        return;
+    }
+    if (writePending) {
+        return;
+    }
+
+    swap = writeBuf;
+    writeBuf = fillBuf;
+    fillBuf = swap;
+    fillBuf.len = 0;
+
+    InterlockedExchange((LONG *)&writePending, 1);
+    SetEvent(writerEvent);
+}
+
+/* Read a journal, applying it to the map if asked. Stops after lastSerial
+ * or at the first incomplete record. Returns cycle records read. */
+static long ReadJournal(FILE *f, long lastSerial, int apply, long *goodEnd, long *serialOut) {
+    unsigned long serial, cityTime, funds, rngState, draws;
+    unsigned int gap;
+    int kind, fcycle, count, tile, i, idx, value;
+    long cycles;
+
+    cycles = 0;
+    *goodEnd = ftell(f);
+    *serialOut = 0;
+
+    while (GetByte(f, &kind)) {
+        if (kind == JNL_REC_TOOL) {
+            /* Written by earlier builds - its tiles are in the cycle records */
+            for (i = 0; i < 4; i++) {
+                if (!GetShort(f, &value)) {
+                    return cycles;
+                }
+            }
+            *goodEnd = ftell(f);
+            continue;
+        }
+        if (kind != JNL_REC_CYCLE) {
+            break;
+        }
+
+        if (!GetLong(f, &serial) || !GetLong(f, &cityTime) || !GetShort(f, &fcycle) ||
+            !GetLong(f, &funds) || !GetLong(f, &rngState) || !GetLong(f, &draws) ||
+            !GetShort(f, &count)) {
+            break;
+        }
+        if (lastSerial >= 0 && (long)serial > lastSerial) {
+            break;
+        }
+
+        /* Read the whole record before applying any of it */
+        if (count > JOURNAL_TILES) {
+            break;
+        }
+        idx = -1;
+        for (i = 0; i < count; i++) {
+            if (!GetVarint(f, &gap) || !GetShort(f, &tile)) {
+                return cycles;
+            }
+            idx += (int)gap;
+            if (gap == 0 || idx >= JOURNAL_TILES) {
+                return cycles;
+            }
+            replayIndex[i] = (short)idx;
+            replayTile[i] = (unsigned short)tile;
+        }
+
+        if (apply) {
+            for (i = 0; i < count; i++) {
+                setMapTile(replayIndex[i] % WORLD_X, replayIndex[i] / WORLD_X, replayTile[i], 0,
+                           TILE_SET_REPLACE, "ReplayJournal");
+            }
+            CityTime = (int)cityTime;
+            Fcycle = fcycle & 1023;
+            TotalFunds = (QUAD)(long)funds;
+            SetSimRandomState(rngState);
+        }
+        *goodEnd = ftell(f);
+        *serialOut = (long)serial;
+        cycles++;
+    }
+    return cycles;
+}
+
+/* Open a journal and check it belongs to the city as loaded */
+static FILE *OpenJournalFile(const char *path, const char *mode, unsigned long checksum) {
+    FILE *f;
+    unsigned long magic, version, mapHash, cityTime;
+
+    f = fopen(path, mode);
+    if (!f) {
+        return NULL;
+    }
+    if (!GetLong(f, &magic) || !GetLong(f, &version) || !GetLong(f, &mapHash) ||
+        !GetLong(f, &cityTime) || magic != JOURNAL_MAGIC || version != JOURNAL_VERSION) {
+        fclose(f);
+        return NULL;
+    }
+    if (mapHash != checksum) {
+        addDebugLog("Journal %s does not match the saved city, ignoring it", path);
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+int OpenJournal(const char *cityFile, int truncate) {
+    JournalBuffer header;
+    char asidePath[MAX_PATH + 4];
+    long goodEnd, serial;
+    DWORD threadId;
+    FILE *f;
+
+    CloseJournal();
+    JournalPathFor(cityFile, journalPath);
+
+    journalFile = INVALID_HANDLE_VALUE;
+    cycleSerial = 0;
+    if (!truncate) {
+        /* Keep what is there, minus any record cut short by a crash.
+         * The map may have been replayed by now, so match against the
+         * city file as it was loaded. */
+        f = OpenJournalFile(journalPath, "rb", checkpointChecksum);
+        if (f) {
+            ReadJournal(f, -1, 0, &goodEnd, &serial);
+            fclose(f);
+            journalFile = CreateFile(journalPath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (journalFile == INVALID_HANDLE_VALUE) {
+                addGameLog("ERROR: Cannot append to journal %s", journalPath);
+                return 0;
+            }
+            SetFilePointer(journalFile, goodEnd, NULL, FILE_BEGIN);
+            SetEndOfFile(journalFile);
+            cycleSerial = serial;
+        }
+    }
+
+    if (journalFile == INVALID_HANDLE_VALUE && !truncate && _access(journalPath, 0) == 0) {
+        /* Keep a journal we could not verify out of the way */
+        strcpy(asidePath, journalPath);
+        strcat(asidePath, ".bad");
+        remove(asidePath);
+        if (rename(journalPath, asidePath) != 0) {
+            addGameLog("ERROR: Journal %s does not match the city and cannot be moved aside", journalPath);
+            return 0;
+        }
+        addGameLog("Journal did not match the city, kept as %s", asidePath);
+    }
+
+    if (journalFile == INVALID_HANDLE_VALUE) {
+        journalFile = CreateFile(journalPath, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL, NULL);
+        if (journalFile == INVALID_HANDLE_VALUE) {
+            addGameLog("ERROR: Cannot create journal %s", journalPath);
+            return 0;
+        }
+        header.data = NULL;
+        header.len = 0;
+        header.size = 0;
+        if (!ReserveBuffer(&header, 16)) {
+            CloseHandle(journalFile);
+            journalFile = INVALID_HANDLE_VALUE;
+            return 0;
+        }
+        PutLong(&header, JOURNAL_MAGIC);
+        PutLong(&header, JOURNAL_VERSION);
+        /* A fresh journal follows the city as saved - just now if
+         * truncating, otherwise as it was loaded */
+        if (truncate) {
+            checkpointChecksum = MapChecksum();
+        }
+        PutLong(&header, checkpointChecksum);
+        PutLong(&header, (unsigned long)CityTime);
+        WriteBuffer(&header);
+        free(header.data);
+    }
+
+    memset(dirtyBits, 0, sizeof(dirtyBits));
+    dirtyCount = 0;
+    fundsAtCycle = TotalFunds;
+    drawsAtCycle = SimRandomDraws;
+    fillBuf.len = 0;
+    writeBuf.len = 0;
+
+    /* Fall back to writing from the simulation if the thread won't start */
+    writePending = 0;
+    writerQuit = 0;
+    writerEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    writerThread = NULL;
+    if (writerEvent) {
+        writerThread = CreateThread(NULL, 0, JournalWriter, NULL, 0, &threadId);
+    }
+
+    JournalActive = 1;
+    addDebugLog("Journal opened: %s (%ld earlier frames)", journalPath, cycleSerial);
+    return 1;
+}
+
+void CloseJournal(void) {
+    if (!JournalActive) {
+        return;
+    }
+
+    /* Finish the frame in progress, then let the writer drain */
+    JournalEndCycle();
+    JournalActive = 0;
+
+    if (writerThread) {
+        InterlockedExchange((LONG *)&writerQuit, 1);
+        SetEvent(writerEvent);
+        WaitForSingleObject(writerThread, INFINITE);
+        CloseHandle(writerThread);
+        writerThread = NULL;
+    }
+    if (writerEvent) {
+        CloseHandle(writerEvent);
+        writerEvent = NULL;
+    }
+
+    WriteBuffer(&writeBuf);
+    WriteBuffer(&fillBuf);
+    CloseHandle(journalFile);
+    journalFile = INVALID_HANDLE_VALUE;
+
+    addDebugLog("Journal closed after %ld frames", cycleSerial);
+}
+
+/* A new checkpoint was saved - start its journal, or drop the old one */
+void JournalCitySaved(const char *cityFile) {
+    char path[MAX_PATH];
+
+    if (JournalEnabled) {
+        OpenJournal(cityFile, 1);
+        return;
+    }
+    CloseJournal();
+    JournalPathFor(cityFile, path);
+    remove(path);
+}
+
+/* Stop journalling and delete the journal - its city file is going away */
+void DiscardJournal(void) {
+    if (!JournalActive) {
+        return;
+    }
+    CloseJournal();
+    remove(journalPath);
+}
+
+/* Mark a changed tile - called from tiles.c */
+void JournalTileChanged(int x, int y) {
+    int idx = y * WORLD_X + x;
+    unsigned long bit = 1UL << (idx & 31);
+
+    if (!(dirtyBits[idx >> 5] & bit)) {
+        dirtyBits[idx >> 5] |= bit;
+        dirtyCount++;
+    }
+}
+
+/* The city was just read from its file - remember the map as saved */
+void JournalCityLoaded(void) {
+    checkpointChecksum = MapChecksum();
+}
+
+/* Close the current frame's record and hand it on */
+void JournalEndCycle(void) {
+    unsigned long bits;
+    int word, idx, last;
+
+    if (!JournalActive) {
+        return;
+    }
+    if (dirtyCount == 0 && TotalFunds == fundsAtCycle && SimRandomDraws == drawsAtCycle) {
+        return;
+    }
+
+    /* Header plus at most three bytes of gap and two of tile each */
+    if (!ReserveBuffer(&fillBuf, 27 + (long)dirtyCount * 5)) {
+        addGameLog("ERROR: Out of memory for the journal, journalling stopped");
+        JournalActive = 0;
+        return;
+    }
+
+    cycleSerial++;
+    PutByte(&fillBuf, JNL_REC_CYCLE);
+    PutLong(&fillBuf, (unsigned long)cycleSerial);
+    PutLong(&fillBuf, (unsigned long)CityTime);
+    PutShort(&fillBuf, Fcycle);
+    PutLong(&fillBuf, (unsigned long)TotalFunds);
+    PutLong(&fillBuf, GetSimRandomState());
+    PutLong(&fillBuf, SimRandomDraws - drawsAtCycle);
+    PutShort(&fillBuf, dirtyCount);
+
+    last = -1;
+    for (word = 0; word < JOURNAL_WORDS; word++) {
+        bits = dirtyBits[word];
+        if (!bits) {
+            continue;
+        }
+        dirtyBits[word] = 0;
+        idx = word << 5;
+        while (bits) {
+            if (bits & 1) {
+                PutVarint(&fillBuf, (unsigned int)(idx - last));
+                PutShort(&fillBuf, (unsigned short)Map[idx / WORLD_X][idx % WORLD_X]);
+                last = idx;
+            }
+            bits >>= 1;
+            idx++;
+        }
+    }
+
+    dirtyCount = 0;
+    fundsAtCycle = TotalFunds;
+    drawsAtCycle = SimRandomDraws;
+
+    HandOffBatch();
+}
+
+long ReplayJournal(const char *cityFile, long lastSerial) {
+    char path[MAX_PATH];
+    FILE *f;
+    long cycles, goodEnd, serial;
+
+    if (JournalActive) {
+        return -1;
+    }
+
+    JournalPathFor(cityFile, path);
+    f = OpenJournalFile(path, "rb", checkpointChecksum);
+    if (!f) {
+        return 0;
+    }
+
+    cycles = ReadJournal(f, lastSerial, 1, &goodEnd, &serial);
+    fclose(f);
+
+    if (cycles > 0) {
+        addDebugLog("Journal replayed %ld frames from %s", cycles, path);
+    }
+    return cycles;
+}
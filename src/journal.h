@@ -0,0 +1,44 @@
+/* journal.h - Tile change journal for WiNTown
+ * Keeps a .jnl file beside the saved .cty holding every map change made
+ * since that save, one record per simulation frame. Loading the city
+ * replays the journal, so a crash costs at most the last frame.
+ */
+
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+#define JOURNAL_EXT     ".jnl"
+#define JOURNAL_MAGIC   0x4E4A5457L /* "WTJN" */
+#define JOURNAL_VERSION 1
+
+/* Record kinds */
+#define JNL_REC_CYCLE 1 /* Frame state and the tiles it changed */
+#define JNL_REC_TOOL  2 /* Tool applied by the player - earlier builds only */
+
+/* Journal the city from its next save - player setting */
+extern int JournalEnabled;
+
+/* A journal file is open and recording */
+extern int JournalActive;
+
+/* Start journalling against a saved city. truncate discards the old
+ * journal; otherwise records are added after the last complete one,
+ * which ReplayJournal must already have applied. */
+int OpenJournal(const char *cityFile, int truncate);
+void CloseJournal(void);
+void DiscardJournal(void);
+void JournalCitySaved(const char *cityFile);
+
+/* Recording hooks */
+void JournalTileChanged(int x, int y);
+void JournalEndCycle(void);
+
+/* Call as soon as a city is read from disk, before anything else changes
+ * the map - the journal is matched against the map as it was saved */
+void JournalCityLoaded(void);
+
+/* Bring a just-loaded city forward through its journal, stopping after
+ * record lastSerial (-1 for all). Returns frames applied, -1 on error. */
+long ReplayJournal(const char *cityFile, long lastSerial);
+
+#endif /* _JOURNAL_H */
@@ -0,0 +1,145 @@
+/* lod.c - Level of detail for the zone scan in WiNTown
+ * Each block remembers how many full scans it has gone without a real
+ * change and the population its zones added on its last full scan. A
+ * coarse block is skipped on most passes and that population is added
+ * in its place, so the census stays whole while the zones sleep. Block
+ * rows take turns on the coarse passes so the skipped work is spread
+ * evenly. A coarse scan stands in for the passes since the block was
+ * last scanned, so zones run the periodic work whose tick fell on any of
+ * them. Power coming or going, fire and any edit are tile changes, so
+ * they promote the block at once.
+ */
+
+#include "sim.h"
+#include "lod.h"
+#include <string.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+typedef struct {
+    unsigned short quiet;  /* Full scans since the last real change */
+    int scanTime;          /* CityTime of the last scan plus one, 0 if none */
+    int resPop;            /* Census added by the block's last full scan */
+    int comPop;
+    int indPop;
+} LodBlock;
+
+static LodBlock Blocks[LOD_BLOCKS_Y][LOD_BLOCKS_X];
+static int LodEnabled = 0;
+static int FocusX1 = 0, FocusY1 = 0, FocusX2 = 0, FocusY2 = 0;
+
+void SetSimLod(int enabled) {
+    LodEnabled = enabled ? 1 : 0;
+    memset(Blocks, 0, sizeof(Blocks));
+    addDebugLog("Simulation LOD %s", LodEnabled ? "enabled" : "disabled");
+}
+
+int GetSimLod(void) {
+    return LodEnabled;
+}
+
+void SetSimFocus(int x, int y, int w, int h) {
+    FocusX1 = x;
+    FocusY1 = y;
+    FocusX2 = x + w;
+    FocusY2 = y + h;
+}
+
+/* Called by setMapTile() for every tile change */
+void LodTileChanged(int x, int y, int oldTile, int newTile) {
+    int oldLo, newLo;
+
+    if (!LodEnabled) {
+        return;
+    }
+
+    /* Animation frames and road traffic do not wake a block; power does */
+    oldLo = oldTile & LOMASK;
+    newLo = newTile & LOMASK;
+    if (!((oldTile ^ newTile) & POWERBIT)) {
+        if (oldLo == newLo || (oldTile & newTile & ANIMBIT)) {
+            return;
+        }
+        if (oldLo >= ROADBASE && oldLo <= LASTROAD && newLo >= ROADBASE && newLo <= LASTROAD) {
+            return;
+        }
+    }
+    Blocks[y / LOD_BLOCK_H][x / LOD_BLOCK_W].quiet = 0;
+}
+
+static int InFocus(int x1, int y1, int x2, int y2) {
+    return x1 < FocusX2 && x2 > FocusX1 && y1 < FocusY2 && y2 > FocusY1;
+}
+
+/* Scan a block, for every pass since its last scan */
+static void ScanBlock(LodBlock *b, int x1, int x2, int y1, int y2) {
+    int passes;
+
+    passes = b->scanTime ? CityTime + 1 - b->scanTime : 1;
+    if (passes < 1 || passes > LOD_COARSE_RATE) {
+        passes = 1;
+    }
+    SetZoneDuePasses(passes);
+    MapScan(x1, x2, y1, y2);
+    SetZoneDuePasses(1);
+    b->scanTime = CityTime + 1;
+}
+
+void LodMapScan(int slice) {
+    LodBlock *b;
+    int by, x1, x2, y1, y2;
+    int res, com, ind;
+
+    x1 = slice * LOD_BLOCK_W;
+    x2 = x1 + LOD_BLOCK_W;
+
+    if (!LodEnabled) {
+        MapScan(x1, x2, 0, WORLD_Y);
+        return;
+    }
+
+    for (by = 0; by < LOD_BLOCKS_Y; by++) {
+        b = &Blocks[by][slice];
+        y1 = by * LOD_BLOCK_H;
+        y2 = y1 + LOD_BLOCK_H;
+        if (y2 > WORLD_Y) {
+            y2 = WORLD_Y;
+        }
+
+        /* Coarse - stand in with the last census */
+        if (b->quiet >= LOD_QUIET_SCANS && !InFocus(x1, y1, x2, y2) &&
+            (CityTime + by) % LOD_COARSE_RATE != 0) {
+            ResPop += b->resPop;
+            ComPop += b->comPop;
+            IndPop += b->indPop;
+            continue;
+        }
+
+        res = ResPop;
+        com = ComPop;
+        ind = IndPop;
+        ScanBlock(b, x1, x2, y1, y2);
+        b->resPop = ResPop - res;
+        b->comPop = ComPop - com;
+        b->indPop = IndPop - ind;
+        if (b->quiet < LOD_QUIET_SCANS) {
+            b->quiet++;
+        }
+    }
+}
+
+int LodDetailBlocks(void) {
+    int bx, by, count;
+
+    count = 0;
+    for (by = 0; by < LOD_BLOCKS_Y; by++) {
+        for (bx = 0; bx < LOD_BLOCKS_X; bx++) {
+            if (Blocks[by][bx].quiet < LOD_QUIET_SCANS ||
+                InFocus(bx * LOD_BLOCK_W, by * LOD_BLOCK_H, (bx + 1) * LOD_BLOCK_W, (by + 1) * LOD_BLOCK_H)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,39 @@
+/* lod.h - Level of detail for the zone scan in WiNTown
+ * The map is cut into blocks, one column of them per slice of the 8-way
+ * map scan. Blocks outside the focus that have gone quiet are scanned
+ * only one pass in LOD_COARSE_RATE and add their last census on the
+ * others. Any real tile change in a block brings it back to full detail.
+ */
+
+#ifndef _LOD_H
+#define _LOD_H
+
+/* Blocks are a slice wide and LOD_BLOCK_H rows high */
+#define LOD_BLOCK_W      (WORLD_X / 8)
+#define LOD_BLOCK_H      10
+#define LOD_BLOCKS_X     8
+#define LOD_BLOCKS_Y     ((WORLD_Y + LOD_BLOCK_H - 1) / LOD_BLOCK_H)
+
+/* Full scans without a change before a block goes coarse */
+#define LOD_QUIET_SCANS  8
+
+/* A coarse block is scanned one pass in this many */
+#define LOD_COARSE_RATE  4
+
+/* Turn the reduced rate on or off - every block starts at full detail */
+void SetSimLod(int enabled);
+int GetSimLod(void);
+
+/* Tiles always kept at full detail, normally the visible part of the map */
+void SetSimFocus(int x, int y, int w, int h);
+
+/* Called by setMapTile() for every tile change */
+void LodTileChanged(int x, int y, int oldTile, int newTile);
+
+/* Scan slice (0-7) of the map, block by block */
+void LodMapScan(int slice);
+
+/* Blocks currently at full detail, for the debug log */
+int LodDetailBlocks(void);
+
+#endif /* _LOD_H */
@@ -10,6 +10,16 @@
 #include "notify.h"
 #include "newgame.h"
 #include "assets.h"
+#include "census.h"
+#include "events.h"
+#include "tiletrace.h"
+#include "journal.h"
+#include "statehash.h"
+#include "profile.h"
+#include "lod.h"
+#include "minimap.h"
+#include "overlay.h"
+#include "atlas.h"
 #include <commdlg.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -23,6 +33,7 @@
 #define IDM_FILE_SAVE 1003
 #define IDM_FILE_SAVE_AS 1004
 #define IDM_FILE_EXIT 1005
+#define IDM_FILE_JOURNAL 1006
 #define IDM_TILESET_BASE 2000
 #define IDM_TILESET_MAX 2100
 #define IDM_SIM_PAUSE 3001
@@ -51,6 +62,12 @@
 #define IDM_VIEW_CHARTSWINDOW 4106
 #define IDM_VIEW_TILE_DEBUG 4107
 #define IDM_VIEW_TEST_SAVELOAD 4108
+#define IDM_VIEW_TILE_TRACE 4109
+#define IDM_VIEW_HASH_LOG 4110
+#define IDM_VIEW_PROFILER 4111
+#define IDM_VIEW_DUMP_MINIMAP 4112
+#define IDM_VIEW_OVERLAY_BASE 4120 /* Plus the OVERLAY_ layer */
+#define IDM_VIEW_OVERLAY_SMOOTH 4130
 
 /* Spawn menu IDs */
 #define IDM_SPAWN_HELICOPTER 6001
@@ -78,6 +95,15 @@
 #define IDM_SETTINGS_LEVEL_HARD 8104
 #define IDM_SETTINGS_AUTO_BUDGET 8105
 #define IDM_SETTINGS_AUTO_BULLDOZE 8106
+#define IDM_SETTINGS_SIM_LOD 8107
+#define IDM_SETTINGS_POWER_FLOOD 8108
+#define IDM_SETTINGS_TRAFFIC_FLOW 8109
+#define IDM_SETTINGS_ZONE_SLEEP 8110
+#define IDM_SETTINGS_BUDGET_BASE 8120 /* Plus the BUDGET_POLICY_ allocator */
+#define IDM_SETTINGS_RESERVE_BASE 8123 /* Plus the BudgetReserveChoices index; follows the allocators */
+#define BUDGET_RESERVE_CHOICES 3
+#define IDM_SETTINGS_SPRITES_BASE 8130 /* Plus the SpriteLimitChoices index */
+#define SPRITE_LIMIT_CHOICES 4
 
 
 /* View menu IDs - Budget Window */
@@ -94,22 +120,6 @@
 #define EARTHQUAKE_TIMER_ID 5
 #define MINIMAP_SCALE 3 /* 3x3 pixels per tile */
 
-/* Minimap view modes */
-#define MINIMAP_MODE_ALL 0
-#define MINIMAP_MODE_RESIDENTIAL 1
-#define MINIMAP_MODE_COMMERCIAL 2
-#define MINIMAP_MODE_INDUSTRIAL 3
-#define MINIMAP_MODE_POWER 4
-#define MINIMAP_MODE_TRANSPORT 5
-#define MINIMAP_MODE_POPULATION 6
-#define MINIMAP_MODE_TRAFFIC 7
-#define MINIMAP_MODE_POLLUTION 8
-#define MINIMAP_MODE_CRIME 9
-#define MINIMAP_MODE_LANDVALUE 10
-#define MINIMAP_MODE_FIRE 11
-#define MINIMAP_MODE_POLICE 12
-#define MINIMAP_MODE_COUNT 13
-
 /* Info window definitions */
 #define INFO_WINDOW_CLASS "WiNTownInfoWindow"
 #define INFO_WINDOW_WIDTH 300
@@ -199,6 +209,11 @@ HWND hwndCharts = NULL; /* Charts window handle for data visualization */
 /* Minimap window variables */
 static int minimapMode = MINIMAP_MODE_ALL; /* Current minimap display mode */
 static BOOL minimapDragging = FALSE; /* Is user dragging on minimap */
+static HDC hdcMinimapBuffer = NULL; /* Back buffer, kept while the window lives */
+static HBITMAP hbmMinimapBuffer = NULL;
+static HBITMAP hbmMinimapOld = NULL;
+static int minimapBufferWidth = 0;
+static int minimapBufferHeight = 0;
 
 /* Tiles debug window variables */
 static BOOL tilesWindowVisible = FALSE; /* Track tiles window visibility */
@@ -253,8 +268,23 @@ static HMENU hToolMenu = NULL;
 static HMENU hSpawnMenu = NULL;
 static HMENU hDisasterMenu = NULL;
 static HMENU hSettingsMenu = NULL;
+static HMENU hOverlayMenu = NULL;
+static HMENU hBudgetPolicyMenu = NULL;
+static HMENU hSpriteLimitMenu = NULL;
+
+/* Treasury floors offered under Settings > Budget Policy */
+static const QUAD BudgetReserveChoices[BUDGET_RESERVE_CHOICES] = { 1000, 5000, 20000 };
+
+/* Sprite limits offered under Settings > Sprite Limit */
+static const int SpriteLimitChoices[SPRITE_LIMIT_CHOICES] = { DEFAULT_SPRITE_LIMIT, 256, 1024, MAX_SPRITES };
 static char currentTileset[MAX_PATH] = "classic";
 static int powerOverlayEnabled = 0; /* Power overlay display toggle */
+static HDC hdcOverlayFrame = NULL; /* 32-bit copy of the view the overlay is blended into */
+static HBITMAP hbmOverlayFrame = NULL;
+static HBITMAP hbmOverlayFrameOld = NULL;
+static OverlayPixel *overlayFrameBits = NULL;
+static int overlayFrameWidth = 0;
+static int overlayFrameHeight = 0;
 int disastersDisabled = 0; /* Cheat flag to disable disasters - global for other modules */
 
 /* Game settings - Global variables for speed, difficulty, and auto-settings */
@@ -419,6 +449,11 @@ LRESULT CALLBACK wndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK infoWndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK logWndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK minimapWndProc(HWND, UINT, WPARAM, LPARAM);
+static void invalidateMinimapChanges(void);
+static void freeOverlayFrame(void);
+static void freeSpriteBitmaps(void);
+static HBITMAP loadTilesetAtlas(const char *tilesetFile, int resourceId);
+static void blendMapOverlay(HDC hdc);
 LRESULT CALLBACK tilesWndProc(HWND, UINT, WPARAM, LPARAM);
 
 /* Log window helper functions */
@@ -1175,6 +1210,34 @@ LRESULT CALLBACK infoWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
+/* Release the minimap back buffer */
+static void freeMinimapBuffer(void) {
+    if (hdcMinimapBuffer) {
+        SelectObject(hdcMinimapBuffer, hbmMinimapOld);
+        DeleteObject(hbmMinimapBuffer);
+        DeleteDC(hdcMinimapBuffer);
+        hdcMinimapBuffer = NULL;
+        hbmMinimapBuffer = NULL;
+    }
+}
+
+/* Invalidate just the part of the minimap whose tiles changed */
+static void invalidateMinimapChanges(void) {
+    RECT r;
+    int x1, y1, x2, y2;
+
+    if (!hwndMinimap || !IsWindowVisible(hwndMinimap)) {
+        return;
+    }
+    if (MinimapTakeDirty(minimapMode, &x1, &y1, &x2, &y2)) {
+        r.left = x1 * MINIMAP_SCALE;
+        r.top = y1 * MINIMAP_SCALE;
+        r.right = x2 * MINIMAP_SCALE;
+        r.bottom = y2 * MINIMAP_SCALE;
+        InvalidateRect(hwndMinimap, &r, FALSE);
+    }
+}
+
 /* Minimap window procedure
  * Displays a miniature view of the entire city with various overlay modes
  * Allows panning the main view by clicking and dragging
@@ -1195,24 +1258,29 @@ LRESULT CALLBACK minimapWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
         PAINTSTRUCT ps;
         HDC hdc;
         HDC hdcMem;
-        HBITMAP hbmMem, hbmOld;
-        HBRUSH hBrush;
+        struct {
+            BITMAPINFOHEADER header;
+            RGBQUAD colours[MINIMAP_COLOURS];
+        } bmi;
+        const unsigned char *palette;
         int mapWidth, mapHeight, mapX, mapY;
-        int density, intensity, level, value, coverage;
-        int x, y;
-        short tileValue;
-        int tileType;
-        COLORREF color;
+        int i;
         int viewX, viewY, viewW, viewH;
-        int scaled;
         
         hdc = BeginPaint(hwnd, &ps);
+        PROFILE_BEGIN("MinimapPaint");
         GetClientRect(hwnd, &rect);
 
-        /* Create memory DC for double buffering */
-        hdcMem = CreateCompatibleDC(hdc);
-        hbmMem = CreateCompatibleBitmap(hdc, rect.right, rect.bottom);
-        hbmOld = SelectObject(hdcMem, hbmMem);
+        /* Double buffer, recreating the buffer only when the window is resized */
+        if (!hdcMinimapBuffer || rect.right != minimapBufferWidth || rect.bottom != minimapBufferHeight) {
+            freeMinimapBuffer();
+            hdcMinimapBuffer = CreateCompatibleDC(hdc);
+            hbmMinimapBuffer = CreateCompatibleBitmap(hdc, rect.right, rect.bottom);
+            hbmMinimapOld = SelectObject(hdcMinimapBuffer, hbmMinimapBuffer);
+            minimapBufferWidth = rect.right;
+            minimapBufferHeight = rect.bottom;
+        }
+        hdcMem = hdcMinimapBuffer;
 
         /* Fill background */
         FillRect(hdcMem, &rect, (HBRUSH)GetStockObject(BLACK_BRUSH));
@@ -1236,261 +1304,23 @@ LRESULT CALLBACK minimapWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
             DeleteObject(hTestPen);
         }
 
-        /* Draw the minimap based on current mode */
-        for (y = 0; y < WORLD_Y; y++) {
-            for (x = 0; x < WORLD_X; x++) {
-                tileValue = Map[y][x];
-                tileType = tileValue & LOMASK;
-                color = RGB(0, 0, 0); /* Default black */
-
-                switch (minimapMode) {
-                case MINIMAP_MODE_ALL:
-                    /* Show basic terrain and zones */
-                    if (tileType >= RESBASE && tileType < HOSPITAL) {
-                        color = RGB(0, 255, 0); /* Residential - green */
-                    } else if (tileType >= COMBASE && tileType < INDBASE) {
-                        color = RGB(0, 0, 255); /* Commercial - blue */
-                    } else if (tileType >= INDBASE && tileType < PORTBASE) {
-                        color = RGB(255, 255, 0); /* Industrial - yellow */
-                    } else if (tileType >= ROADBASE && tileType <= LASTROAD) {
-                        color = RGB(128, 128, 128); /* Roads - gray */
-                    } else if (tileType >= RAILBASE && tileType <= LASTRAIL) {
-                        color = RGB(192, 192, 192); /* Rails - light gray */
-                    } else if (tileType >= POWERBASE && tileType <= LASTPOWER) {
-                        color = RGB(255, 0, 0); /* Power lines - red */
-                    } else if (tileType >= RIVER && tileType <= LASTRIVEDGE) {
-                        color = RGB(0, 128, 255); /* Water - blue */
-                    } else if (tileType >= TREEBASE && tileType <= WOODS5) {
-                        color = RGB(0, 128, 0); /* Trees - dark green */
-                    } else if (tileType != 0) {
-                        /* Any other non-zero tile - show as dim white */
-                        color = RGB(64, 64, 64);
-                    }
-                    break;
-
-                case MINIMAP_MODE_RESIDENTIAL:
-                    if (tileType >= RESBASE && tileType < HOSPITAL) {
-                        density = calcResPop(tileType);
-                        if (density > 0) {
-                            intensity = min(255, density * 25);
-                            color = RGB(0, intensity, 0);
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_COMMERCIAL:
-                    if (tileType >= COMBASE && tileType < INDBASE) {
-                        density = calcComPop(tileType);
-                        if (density > 0) {
-                            intensity = min(255, density * 25);
-                            color = RGB(0, 0, intensity);
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_INDUSTRIAL:
-                    if (tileType >= INDBASE && tileType < PORTBASE) {
-                        density = calcIndPop(tileType);
-                        if (density > 0) {
-                            intensity = min(255, density * 25);
-                            color = RGB(intensity, intensity, 0);
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_POWER:
-                    if (tileValue & POWERBIT) {
-                        color = RGB(255, 255, 0); /* Powered - yellow */
-                    } else if (tileValue & CONDBIT) {
-                        color = RGB(128, 0, 0); /* Unpowered conductor - dark red */
-                    }
-                    break;
-
-                case MINIMAP_MODE_TRANSPORT:
-                    if (tileType >= ROADBASE && tileType <= LASTROAD) {
-                        color = RGB(255, 255, 255); /* Roads - white */
-                    } else if (tileType >= RAILBASE && tileType <= LASTRAIL) {
-                        color = RGB(192, 192, 192); /* Rails - light gray */
-                    }
-                    break;
-
-                case MINIMAP_MODE_POPULATION:
-                    /* PopDensity is half-size array, so check bounds and access correctly */
-                    if ((y/2) < (WORLD_Y/2) && (x/2) < (WORLD_X/2)) {
-                        density = PopDensity[y/2][x/2];
-                        if (density > 0) {
-                            intensity = min(255, density * 2);
-                            color = RGB(intensity, 0, intensity);
-                        }
-                        /* Debug: show any residential areas in faint color even if no density */
-                        else if (tileType >= RESBASE && tileType < HOSPITAL) {
-                            color = RGB(32, 0, 32); /* Very faint purple for residential with no density */
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_TRAFFIC:
-                    /* TrfDensity is half-size array, so check bounds and access correctly */
-                    if ((y/2) < (WORLD_Y/2) && (x/2) < (WORLD_X/2)) {
-                        density = TrfDensity[y/2][x/2];
-                        if (density > 0) {
-                            /* Use bright color gradient for traffic */
-                            if (density >= 120) {
-                                color = RGB(255, 0, 0);     /* Bright red for heavy traffic */
-                            } else if (density >= 80) {
-                                color = RGB(255, 128, 0);   /* Bright orange */
-                            } else if (density >= 40) {
-                                color = RGB(255, 255, 0);   /* Bright yellow */
-                            } else if (density >= 20) {
-                                color = RGB(128, 255, 0);   /* Yellow-green */
-                            } else {
-                                color = RGB(0, 255, 128);   /* Light green for low traffic */
-                            }
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_POLLUTION:
-                    /* PollutionMem is half-size array, so check bounds and access correctly */
-                    if ((y/2) < (WORLD_Y/2) && (x/2) < (WORLD_X/2)) {
-                        level = PollutionMem[y/2][x/2];
-                        if (level > 0) {
-                            /* Use bright color gradient for pollution */
-                            if (level >= 200) {
-                                color = RGB(255, 0, 0);     /* Bright red for high pollution */
-                            } else if (level >= 150) {
-                                color = RGB(255, 128, 0);   /* Bright orange */
-                            } else if (level >= 100) {
-                                color = RGB(255, 255, 0);   /* Bright yellow */
-                            } else if (level >= 50) {
-                                color = RGB(128, 255, 0);   /* Yellow-green */
-                            } else {
-                                color = RGB(0, 255, 128);   /* Light green for low pollution */
-                            }
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_CRIME:
-                    /* CrimeMem is half-size array, so check bounds and access correctly */
-                    if ((y/2) < (WORLD_Y/2) && (x/2) < (WORLD_X/2)) {
-                        level = CrimeMem[y/2][x/2];
-                        if (level > 0) {
-                            /* Use bright red gradient for crime */
-                            if (level >= 200) {
-                                color = RGB(255, 0, 0);     /* Bright red for high crime */
-                            } else if (level >= 150) {
-                                color = RGB(255, 64, 0);    /* Red-orange */
-                            } else if (level >= 100) {
-                                color = RGB(255, 128, 0);   /* Orange */
-                            } else if (level >= 50) {
-                                color = RGB(255, 192, 0);   /* Yellow-orange */
-                            } else {
-                                color = RGB(255, 255, 0);   /* Yellow for low crime */
-                            }
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_LANDVALUE:
-                    /* LandValueMem is half-size array, so check bounds and access correctly */
-                    if ((y/2) < (WORLD_Y/2) && (x/2) < (WORLD_X/2)) {
-                        value = LandValueMem[y/2][x/2];
-                        if (value > 0) {
-                            /* Use bright green gradient for land value */
-                            if (value >= 200) {
-                                color = RGB(0, 255, 0);     /* Bright green for high value */
-                            } else if (value >= 150) {
-                                color = RGB(64, 255, 64);   /* Light green */
-                            } else if (value >= 100) {
-                                color = RGB(128, 255, 128); /* Pale green */
-                            } else if (value >= 50) {
-                                color = RGB(192, 255, 192); /* Very pale green */
-                            } else {
-                                color = RGB(255, 255, 192); /* Pale yellow for low value */
-                            }
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_FIRE:
-                    /* FireRate is quarter-size array, so check bounds and access correctly */
-                    if ((x/4) < (WORLD_X/4) && (y/4) < (WORLD_Y/4)) {
-                        coverage = FireRate[y/4][x/4];
-                        if (coverage > 0) {
-                            /* Scale down short values for display - original starts with 1000 */
-                            int scaled = coverage / 4;  /* Scale down from short range */
-                            if (scaled > 255) scaled = 255;
-                            
-                            /* Use bright red gradient for fire coverage */
-                            if (scaled >= 200) {
-                                color = RGB(255, 0, 0);     /* Bright red for high coverage */
-                            } else if (scaled >= 150) {
-                                color = RGB(255, 64, 64);   /* Red-pink */
-                            } else if (scaled >= 100) {
-                                color = RGB(255, 128, 128); /* Light red */
-                            } else if (scaled >= 50) {
-                                color = RGB(255, 192, 192); /* Pink */
-                            } else {
-                                color = RGB(255, 224, 224); /* Very light pink */
-                            }
-                        }
-                    }
-                    break;
-
-                case MINIMAP_MODE_POLICE:
-                    /* PoliceMapEffect is quarter-size array, so check bounds and access correctly */
-                    if ((x/4) < (WORLD_X/4) && (y/4) < (WORLD_Y/4)) {
-                        coverage = PoliceMapEffect[y/4][x/4];
-                        if (coverage > 0) {
-                            /* Scale down short values for display - original starts with 1000 */
-                            scaled = coverage / 4;  /* Scale down from short range */
-                            if (scaled > 255) scaled = 255;
-                            
-                            /* Use bright blue gradient for police coverage */
-                            if (scaled >= 200) {
-                                color = RGB(0, 0, 255);     /* Bright blue for high coverage */
-                            } else if (scaled >= 150) {
-                                color = RGB(64, 64, 255);   /* Blue-violet */
-                            } else if (scaled >= 100) {
-                                color = RGB(128, 128, 255); /* Light blue */
-                            } else if (scaled >= 50) {
-                                color = RGB(192, 192, 255); /* Very light blue */
-                            } else {
-                                color = RGB(224, 224, 255); /* Faint blue */
-                            }
-                        }
-                    }
-                    break;
-                }
-
-                /* Draw the pixel */
-                if (color != RGB(0, 0, 0)) {
-                    RECT tileRect;
-                    tileRect.left = mapX + x * MINIMAP_SCALE;
-                    tileRect.top = mapY + y * MINIMAP_SCALE;
-                    tileRect.right = tileRect.left + MINIMAP_SCALE;
-                    tileRect.bottom = tileRect.top + MINIMAP_SCALE;
-                    
-                    hBrush = CreateSolidBrush(color);
-                    FillRect(hdcMem, &tileRect, hBrush);
-                    DeleteObject(hBrush);
-                }
-                
-                /* Always draw something for dirt/empty tiles in ALL mode */
-                if (minimapMode == MINIMAP_MODE_ALL && color == RGB(0, 0, 0)) {
-                    RECT tileRect;
-                    tileRect.left = mapX + x * MINIMAP_SCALE;
-                    tileRect.top = mapY + y * MINIMAP_SCALE;
-                    tileRect.right = tileRect.left + MINIMAP_SCALE;
-                    tileRect.bottom = tileRect.top + MINIMAP_SCALE;
-                    
-                    hBrush = CreateSolidBrush(RGB(32, 32, 32));
-                    FillRect(hdcMem, &tileRect, hBrush);
-                    DeleteObject(hBrush);
-                }
-            }
+        /* Stretch the mode's raster over the map, its palette as the colour table */
+        ZeroMemory(&bmi, sizeof(bmi));
+        bmi.header.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.header.biWidth = WORLD_X;
+        bmi.header.biHeight = -WORLD_Y; /* Negative for top-down DIB */
+        bmi.header.biPlanes = 1;
+        bmi.header.biBitCount = 8;
+        bmi.header.biCompression = BI_RGB;
+        bmi.header.biClrUsed = MINIMAP_COLOURS;
+        palette = MinimapPalette(minimapMode);
+        for (i = 0; i < MINIMAP_COLOURS; i++) {
+            bmi.colours[i].rgbRed = palette[i * 3];
+            bmi.colours[i].rgbGreen = palette[i * 3 + 1];
+            bmi.colours[i].rgbBlue = palette[i * 3 + 2];
         }
+        StretchDIBits(hdcMem, mapX, mapY, mapWidth, mapHeight, 0, 0, WORLD_X, WORLD_Y,
+                      MinimapRaster(minimapMode), (BITMAPINFO *)&bmi, DIB_RGB_COLORS, SRCCOPY);
 
         /* Draw viewport rectangle showing current view */
         if (hwndMain) {
@@ -1550,11 +1380,7 @@ LRESULT CALLBACK minimapWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
         /* Blit to screen */
         BitBlt(hdc, 0, 0, rect.right, rect.bottom, hdcMem, 0, 0, SRCCOPY);
 
-        /* Cleanup */
-        SelectObject(hdcMem, hbmOld);
-        DeleteObject(hbmMem);
-        DeleteDC(hdcMem);
-        
+        PROFILE_END("MinimapPaint");
         EndPaint(hwnd, &ps);
         return 0;
     }
@@ -1717,7 +1543,7 @@ LRESULT CALLBACK minimapWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
     case WM_TIMER:
         if (wParam == MINIMAP_TIMER_ID) {
             /* Periodic minimap refresh */
-            InvalidateRect(hwnd, NULL, FALSE);
+            invalidateMinimapChanges();
             return 0;
         }
         break;
@@ -1747,6 +1573,7 @@ LRESULT CALLBACK minimapWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
 
     case WM_DESTROY:
         KillTimer(hwnd, MINIMAP_TIMER_ID);
+        freeMinimapBuffer();
         hwndMinimap = NULL;
         return 0;
     }
@@ -2040,8 +1867,7 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         /* Initialize toolbar */
         CreateToolbar(hwnd, 0, 0, 108, 600);
 
-        /* Load sprite bitmaps */
-        loadSpriteBitmaps();
+        /* Sprite frames come with the tileset's atlas */
 
         /* Initial tileset check will be handled by populateTilesetMenu */
         /* Initialize simulation */
@@ -2082,6 +1908,19 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             saveCityAs();
             return 0;
 
+        case IDM_FILE_JOURNAL:
+            JournalEnabled = !JournalEnabled;
+            CheckMenuItem(hFileMenu, IDM_FILE_JOURNAL, MF_BYCOMMAND | (JournalEnabled ? MF_CHECKED : MF_UNCHECKED));
+            if (!JournalEnabled) {
+                CloseJournal();
+            } else if (cityFileName[0] != '\0') {
+                /* The journal needs a saved city to start from */
+                saveCity();
+            } else {
+                addGameLog("Journal will start when the city is saved");
+            }
+            return 0;
+
         case IDM_FILE_EXIT:
             PostMessage(hwnd, WM_CLOSE, 0, 0);
             return 0;
@@ -2218,6 +2057,13 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         }
             return 0;
 
+        case IDM_VIEW_OVERLAY_SMOOTH:
+            SetOverlaySmooth(!GetOverlaySmooth());
+            CheckMenuItem(hOverlayMenu, IDM_VIEW_OVERLAY_SMOOTH,
+                          MF_BYCOMMAND | (GetOverlaySmooth() ? MF_CHECKED : MF_UNCHECKED));
+            InvalidateRect(hwnd, NULL, FALSE);
+            return 0;
+
         case IDM_VIEW_MINIMAPWINDOW:
             if (hwndMinimap) {
                 HMENU hMenu = GetMenu(hwnd);
@@ -2309,10 +2155,70 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             }
             return 0;
 
+        case IDM_VIEW_TILE_TRACE:
+            {
+                HMENU hMenu = GetMenu(hwnd);
+                HMENU hViewMenu = GetSubMenu(hMenu, 6); /* View is the 7th menu (0-based index) */
+
+                if (tileTraceEnabled) {
+                    enableTileDebug(0);
+                    CheckMenuItem(hViewMenu, IDM_VIEW_TILE_TRACE, MF_BYCOMMAND | MF_UNCHECKED);
+                } else if (enableTileDebug(1)) {
+                    CheckMenuItem(hViewMenu, IDM_VIEW_TILE_TRACE, MF_BYCOMMAND | MF_CHECKED);
+                    addGameLog("Tile trace recording to %s", TRACE_FILE_NAME);
+                }
+            }
+            return 0;
+
+        case IDM_VIEW_HASH_LOG:
+            {
+                HMENU hMenu = GetMenu(hwnd);
+                HMENU hViewMenu = GetSubMenu(hMenu, 6); /* View is the 7th menu (0-based index) */
+
+                if (stateHashLogging) {
+                    StopStateHashLog();
+                    CheckMenuItem(hViewMenu, IDM_VIEW_HASH_LOG, MF_BYCOMMAND | MF_UNCHECKED);
+                } else if (StartStateHashLog(NULL)) {
+                    CheckMenuItem(hViewMenu, IDM_VIEW_HASH_LOG, MF_BYCOMMAND | MF_CHECKED);
+                    addGameLog("State hashes recording to %s", STATEHASH_LOG_NAME);
+                }
+            }
+            return 0;
+
+        case IDM_VIEW_PROFILER:
+            {
+                HMENU hMenu = GetMenu(hwnd);
+                HMENU hViewMenu = GetSubMenu(hMenu, 6); /* View is the 7th menu (0-based index) */
+
+                if (profileEnabled) {
+                    long events = StopProfile(NULL);
+                    CheckMenuItem(hViewMenu, IDM_VIEW_PROFILER, MF_BYCOMMAND | MF_UNCHECKED);
+                    addGameLog("Profile of %ld events written to %s", events, PROFILE_FILE_NAME);
+                } else if (StartProfile()) {
+                    CheckMenuItem(hViewMenu, IDM_VIEW_PROFILER, MF_BYCOMMAND | MF_CHECKED);
+                    addGameLog("Profiler recording - select again to write %s", PROFILE_FILE_NAME);
+                }
+            }
+            return 0;
+
         case IDM_VIEW_TEST_SAVELOAD:
             testSaveLoad();
             return 0;
 
+        case IDM_VIEW_DUMP_MINIMAP:
+            {
+                char ppmPath[MAX_PATH];
+
+                /* One pixel per tile in the minimap's current mode */
+                wsprintf(ppmPath, "%s\\minimap%d.ppm", progPathName, minimapMode);
+                if (MinimapWritePPM(minimapMode, ppmPath)) {
+                    addGameLog("Minimap written to %s", ppmPath);
+                } else {
+                    addGameLog("ERROR: Cannot write minimap to %s", ppmPath);
+                }
+            }
+            return 0;
+
         /* Tool menu items */
         case IDM_TOOL_BULLDOZER:
             SelectTool(bulldozerState);
@@ -2466,7 +2372,7 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     addGameLog("DEBUG: Helicopter frame=%d, dir=%d", sprite->frame, sprite->dir);
                 } else {
                     addGameLog("FAILED: Could not spawn helicopter");
-                    addGameLog("DEBUG: Max sprites=%d, current=%d", MAX_SPRITES, spriteCount);
+                    addGameLog("DEBUG: Sprite limit=%d, current=%d", SpriteLimit, spriteCount);
                 }
             }
             return 0;
@@ -2669,7 +2575,73 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             addGameLog("Auto-bulldoze %s", autoBulldoze ? "enabled" : "disabled");
             return 0;
 
+        case IDM_SETTINGS_SIM_LOD:
+            SetSimLod(!GetSimLod());
+            CheckMenuItem(hSettingsMenu, IDM_SETTINGS_SIM_LOD, GetSimLod() ? MF_CHECKED : MF_UNCHECKED);
+            addGameLog("Simulation LOD %s", GetSimLod() ? "enabled" : "disabled");
+            return 0;
+
+        case IDM_SETTINGS_POWER_FLOOD:
+            SetPowerEngine(GetPowerEngine() == POWER_ENGINE_FLOOD ? POWER_ENGINE_WALK : POWER_ENGINE_FLOOD);
+            addGameLog("Power scan: %s", GetPowerEngine() == POWER_ENGINE_FLOOD ? "flood fill" : "line walk");
+            CheckMenuItem(hSettingsMenu, IDM_SETTINGS_POWER_FLOOD, GetPowerEngine() == POWER_ENGINE_FLOOD ? MF_CHECKED : MF_UNCHECKED);
+            return 0;
+
+        case IDM_SETTINGS_TRAFFIC_FLOW:
+            SetTrafficEngine(GetTrafficEngine() == TRAFFIC_ENGINE_FLOW ? TRAFFIC_ENGINE_WALK : TRAFFIC_ENGINE_FLOW);
+            addGameLog("Traffic model: %s", GetTrafficEngine() == TRAFFIC_ENGINE_FLOW ? "batched flow" : "random walk");
+            CheckMenuItem(hSettingsMenu, IDM_SETTINGS_TRAFFIC_FLOW, GetTrafficEngine() == TRAFFIC_ENGINE_FLOW ? MF_CHECKED : MF_UNCHECKED);
+            return 0;
+
+        case IDM_SETTINGS_ZONE_SLEEP:
+            SetZoneSleep(!GetZoneSleep());
+            addGameLog("Zone sleep %s", GetZoneSleep() ? "enabled" : "disabled");
+            CheckMenuItem(hSettingsMenu, IDM_SETTINGS_ZONE_SLEEP, GetZoneSleep() ? MF_CHECKED : MF_UNCHECKED);
+            return 0;
+
         default:
+            if (LOWORD(wParam) >= IDM_VIEW_OVERLAY_BASE &&
+                LOWORD(wParam) < IDM_VIEW_OVERLAY_BASE + OVERLAY_COUNT) {
+                SetOverlayLayer(LOWORD(wParam) - IDM_VIEW_OVERLAY_BASE);
+                CHECK_MENU_RADIO_ITEM(hOverlayMenu, IDM_VIEW_OVERLAY_BASE,
+                                      IDM_VIEW_OVERLAY_BASE + OVERLAY_COUNT - 1, LOWORD(wParam),
+                                      MF_BYCOMMAND);
+                addGameLog("Map overlay: %s", GetOverlayName(GetOverlayLayer()));
+                InvalidateRect(hwnd, NULL, FALSE);
+                return 0;
+            }
+            if (LOWORD(wParam) >= IDM_SETTINGS_BUDGET_BASE &&
+                LOWORD(wParam) <= IDM_SETTINGS_BUDGET_BASE + BUDGET_POLICY_PRIORITY) {
+                SetBudgetPolicy(LOWORD(wParam) - IDM_SETTINGS_BUDGET_BASE);
+                CHECK_MENU_RADIO_ITEM(hBudgetPolicyMenu, IDM_SETTINGS_BUDGET_BASE,
+                                      IDM_SETTINGS_RESERVE_BASE + BUDGET_RESERVE_CHOICES - 1,
+                                      LOWORD(wParam), MF_BYCOMMAND);
+                addGameLog("Budget policy: %s",
+                           GetBudgetPolicy() == BUDGET_POLICY_PROPORTIONAL ? "proportional cuts" :
+                           GetBudgetPolicy() == BUDGET_POLICY_PRIORITY ? "priority order" :
+                           "ask each year");
+                return 0;
+            }
+            if (LOWORD(wParam) >= IDM_SETTINGS_RESERVE_BASE &&
+                LOWORD(wParam) < IDM_SETTINGS_RESERVE_BASE + BUDGET_RESERVE_CHOICES) {
+                SetBudgetReserve(BudgetReserveChoices[LOWORD(wParam) - IDM_SETTINGS_RESERVE_BASE]);
+                SetBudgetPolicy(BUDGET_POLICY_RESERVE);
+                CHECK_MENU_RADIO_ITEM(hBudgetPolicyMenu, IDM_SETTINGS_BUDGET_BASE,
+                                      IDM_SETTINGS_RESERVE_BASE + BUDGET_RESERVE_CHOICES - 1,
+                                      LOWORD(wParam), MF_BYCOMMAND);
+                addGameLog("Budget policy: keep $%d in reserve",
+                           (int)BudgetReserveChoices[LOWORD(wParam) - IDM_SETTINGS_RESERVE_BASE]);
+                return 0;
+            }
+            if (LOWORD(wParam) >= IDM_SETTINGS_SPRITES_BASE &&
+                LOWORD(wParam) < IDM_SETTINGS_SPRITES_BASE + SPRITE_LIMIT_CHOICES) {
+                SetSpriteLimit(SpriteLimitChoices[LOWORD(wParam) - IDM_SETTINGS_SPRITES_BASE]);
+                CHECK_MENU_RADIO_ITEM(hSpriteLimitMenu, IDM_SETTINGS_SPRITES_BASE,
+                                      IDM_SETTINGS_SPRITES_BASE + SPRITE_LIMIT_CHOICES - 1,
+                                      LOWORD(wParam), MF_BYCOMMAND);
+                addGameLog("Sprite limit: %d", SpriteLimit);
+                return 0;
+            }
             if (LOWORD(wParam) >= IDM_TILESET_BASE && LOWORD(wParam) < IDM_TILESET_MAX) {
                 int index;
                 char tilesetName[MAX_PATH];
@@ -2695,9 +2667,19 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             static int minimapUpdateCounter = 0;
             static int chartUpdateCounter = 0;
 
+            /* Keep the visible part of the map at full detail */
+            SetSimFocus(xOffset / TILE_SIZE, yOffset / TILE_SIZE,
+                        (cxClient - toolbarWidth) / TILE_SIZE + 1, cyClient / TILE_SIZE + 1);
+
             /* Run the simulation frame */
             SimFrame();
 
+            /* Close this frame's journal record */
+            JournalEndCycle();
+
+            /* Deliver messages published during the frame */
+            DispatchEvents();
+
             /* Always redraw to handle animations */
             needRedraw = TRUE;
 
@@ -2708,9 +2690,7 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 minimapUpdateCounter++;
                 if (minimapUpdateCounter >= 20) {
                     minimapUpdateCounter = 0;
-                    if (hwndMinimap && IsWindowVisible(hwndMinimap)) {
-                        InvalidateRect(hwndMinimap, NULL, FALSE);
-                    }
+                    invalidateMinimapChanges();
                 }
                 /* Update chart only every 50 frames (5 seconds at 100ms intervals) */
                 chartUpdateCounter++;
@@ -2776,7 +2756,9 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             }
 
             /* Draw the city to our buffer */
+            PROFILE_BEGIN("drawCity");
             drawCity(hdcBuffer);
+            PROFILE_END("drawCity");
 
             /* Calculate earthquake shake offset */
             if (shakeNow > 0) {
@@ -3084,6 +3066,14 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         /* Clean up chart system */
         CleanupChartSystem();
 
+        /* Write out any buffered tile trace, journal, hash log and profile */
+        enableTileDebug(0);
+        CloseJournal();
+        StopStateHashLog();
+        if (profileEnabled) {
+            StopProfile(NULL);
+        }
+
         PostQuitMessage(0);
         return 0;
 
@@ -3330,6 +3320,71 @@ OutputDebugString(errorMsg);
 }
 
 
+/* Free the separate sprite frames once an atlas holds them */
+static void freeSpriteBitmaps(void) {
+    int type, frame;
+
+    for (type = 0; type < 9; type++) {
+        for (frame = 0; frame < 16; frame++) {
+            if (hbmSprites[type][frame]) {
+                DeleteObject(hbmSprites[type][frame]);
+                hbmSprites[type][frame] = NULL;
+            }
+        }
+    }
+}
+
+/* Load a tileset through its cached atlas, packing the atlas on first use.
+   If packing fails the plain tileset is returned and sprites stay separate. */
+static HBITMAP loadTilesetAtlas(const char *tilesetFile, int resourceId) {
+    char atlasPath[MAX_PATH];
+    char tempPath[MAX_PATH];
+    char name[MAX_PATH];
+    char *dot;
+    HBITMAP hbmTileset, hbmAtlas, hConvertedBitmap;
+    HDC hdcTemp;
+
+    strcpy(name, tilesetFile);
+    dot = strrchr(name, '.');
+    if (dot) {
+        *dot = '\0';
+    }
+    GetTempPath(MAX_PATH, tempPath);
+    wsprintf(atlasPath, "%swintown-%s.atl", tempPath, name);
+
+    hbmAtlas = LoadAtlas(atlasPath, hPalette);
+    if (hbmAtlas) {
+        freeSpriteBitmaps();
+        return hbmAtlas;
+    }
+
+    hbmTileset = loadTilesetFromResource(resourceId);
+    if (!hbmTileset) {
+        return NULL;
+    }
+
+    /* Convert to uncompressed 8-bit format */
+    hdcTemp = GetDC(hwndMain);
+    hConvertedBitmap = convertTo8Bit(hbmTileset, hdcTemp, hPalette);
+    ReleaseDC(hwndMain, hdcTemp);
+    if (hConvertedBitmap) {
+        DeleteObject(hbmTileset);
+        hbmTileset = hConvertedBitmap;
+    }
+
+    loadSpriteBitmaps();
+    hbmAtlas = BuildAtlas(atlasPath, hbmTileset, hbmSprites, hPalette);
+    if (hbmAtlas) {
+        DeleteObject(hbmTileset);
+        freeSpriteBitmaps();
+        return hbmAtlas;
+    }
+
+    addDebugLog("Could not pack an atlas for %s, using separate sprites", tilesetFile);
+    FreeAtlas();
+    return hbmTileset;
+}
+
 int loadTileset(const char *filename) {
     HDC hdc;
     char errorMsg[256];
@@ -3365,7 +3420,7 @@ int loadTileset(const char *filename) {
         wsprintf(debugMsg, "Loading tileset %s from embedded resources (ID: %d)\n", tilesetName, resourceId);
         OutputDebugString(debugMsg);
         
-        hbmTiles = loadTilesetFromResource(resourceId);
+        hbmTiles = loadTilesetAtlas(tilesetName, resourceId);
         if (hbmTiles != NULL) {
             wsprintf(debugMsg, "Successfully loaded tileset %s from resources\n", tilesetName);
             OutputDebugString(debugMsg);
@@ -3393,22 +3448,6 @@ int loadTileset(const char *filename) {
                  bm.bmBitsPixel);
         OutputDebugString(debugMsg);
 
-        /* Convert all images to uncompressed 8-bit format */
-        {
-            HBITMAP hConvertedBitmap;
-            HDC hdcTemp;
-            
-            hdcTemp = GetDC(hwndMain);
-            hConvertedBitmap = convertTo8Bit(hbmTiles, hdcTemp, hPalette);
-            ReleaseDC(hwndMain, hdcTemp);
-            
-            if (hConvertedBitmap) {
-                /* Always replace original with uncompressed bitmap */
-                DeleteObject(hbmTiles);
-                hbmTiles = hConvertedBitmap;
-            }
-        }
-        
         /* Validate final tileset format */
         validateTilesetFormat(hbmTiles);
     }
@@ -3459,7 +3498,7 @@ int changeTileset(HWND hwnd, const char *tilesetName) {
         wsprintf(debugMsg, "Changing to tileset %s from embedded resources (ID: %d)\n", tilesetName, resourceId);
         OutputDebugString(debugMsg);
         
-        hbmTiles = loadTilesetFromResource(resourceId);
+        hbmTiles = loadTilesetAtlas(tilesetFilename, resourceId);
         if (hbmTiles != NULL) {
             wsprintf(debugMsg, "Successfully changed to tileset %s from resources\n", tilesetName);
             OutputDebugString(debugMsg);
@@ -3477,7 +3516,7 @@ int changeTileset(HWND hwnd, const char *tilesetName) {
             
             resourceId = findTilesetResourceByName("default.bmp");
             if (resourceId != 0) {
-                hbmTiles = loadTilesetFromResource(resourceId);
+                hbmTiles = loadTilesetAtlas("default.bmp", resourceId);
             }
                               
             if (hbmTiles == NULL) {
@@ -3498,22 +3537,6 @@ int changeTileset(HWND hwnd, const char *tilesetName) {
                  bm.bmBitsPixel);
         OutputDebugString(debugMsg);
 
-        /* Convert all images to uncompressed 8-bit format */
-        {
-            HBITMAP hConvertedBitmap;
-            HDC hdcTemp;
-            
-            hdcTemp = GetDC(hwndMain);
-            hConvertedBitmap = convertTo8Bit(hbmTiles, hdcTemp, hPalette);
-            ReleaseDC(hwndMain, hdcTemp);
-            
-            if (hConvertedBitmap) {
-                /* Always replace original with uncompressed bitmap */
-                DeleteObject(hbmTiles);
-                hbmTiles = hConvertedBitmap;
-            }
-        }
-        
         /* Validate final tileset format */
         validateTilesetFormat(hbmTiles);
     }
@@ -3551,6 +3574,9 @@ int changeTileset(HWND hwnd, const char *tilesetName) {
 }
 
 void cleanupGraphics(void) {
+    freeOverlayFrame();
+    FreeOverlay();
+
     if (hbmBuffer) {
         DeleteObject(hbmBuffer);
         hbmBuffer = NULL;
@@ -3966,6 +3992,7 @@ int saveCity(void) {
         return saveCityAs();
     } else {
         if (saveFile(cityFileName)) {
+            JournalCitySaved(cityFileName);
             addGameLog("City saved to: %s", cityFileName);
             return 1;
         } else {
@@ -4023,6 +4050,7 @@ int saveCityAs(void) {
                 SetWindowText(hwndMain, windowTitle);
             }
 
+            JournalCitySaved(szFileName);
             addGameLog("City saved as: %s", szFileName);
             return 1;
         } else {
@@ -4160,61 +4188,17 @@ extern int calcIndPop(int zone);     /* Calculate industrial zone population - f
 extern void ClearCensus(void);       /* Reset census counters - from simulation.c */
 extern void CityEvaluation(void);    /* Update city evaluation - from evaluation.c */
 extern void TakeCensus(void);        /* Take a census - from simulation.c */
-extern void CountSpecialTiles(void); /* Count special buildings - from evaluation.c */
 
 /* Force a census calculation of the entire map */
 void ForceFullCensus(void) {
-    int x, y;
-    short tile;
-    int zoneTile;
-
     /* Reset census counts */
     ClearCensus();
 
-    /* Scan entire map to count populations */
-    for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
-            tile = Map[y][x];
-
-            /* Check if this is a zone center */
-            if (tile & ZONEBIT) {
-                zoneTile = tile & LOMASK;
-
-                /* Population counting is handled exclusively by zone processing system */
-                /* Do not count population here to avoid conflicts with zone.c system */
-
-                /* Count other special zones */
-                if (zoneTile == FIRESTATION) {
-                    FirePop++;
-                } else if (zoneTile == POLICESTATION) {
-                    PolicePop++;
-                } else if (zoneTile == STADIUM) {
-                    StadiumPop++;
-                    /* Stadium population counted by zone processing */
-                } else if (zoneTile == PORT) {
-                    PortPop++;
-                    /* Port population counted by zone processing */
-                } else if (zoneTile == AIRPORT) {
-                    APortPop++;
-                    /* Airport population counted by zone processing */
-                } else if (zoneTile == NUCLEAR) {
-                    NuclearPop++;
-                }
-                /* Note: We don't count power plants here since CountSpecialTiles() in evaluation.c
-                 * handles it */
-
-                /* Power zone counting is handled exclusively by DoPowerScan() in power.c */
-                /* Do not count power zones here to avoid conflicts */
-            }
-
-            /* Count infrastructure */
-            if ((tile & LOMASK) >= ROADBASE && (tile & LOMASK) <= LASTROAD) {
-                RoadTotal++;
-            } else if ((tile & LOMASK) >= RAILBASE && (tile & LOMASK) <= LASTRAIL) {
-                RailTotal++;
-            }
-        }
-    }
+    /* Road, rail and special zone counts are kept current by census.c
+     * as tiles change, so there is no map sweep here */
+#ifdef CENSUS_DEBUG
+    VerifyCensusTiles();
+#endif
 
     /* Calculate total population using unified functions */
     TotalPop = CalculateTotalPopulation(ResPop, ComPop, IndPop);
@@ -4238,8 +4222,8 @@ void ForceFullCensus(void) {
         CityClass++; /* Megalopolis */
     }
 
-    /* Count special buildings for city evaluation */
-    CountSpecialTiles();
+    /* Refresh the developed-land traffic total for the evaluation */
+    CalcTrafficAverage();
 
     /* Update the city evaluation based on the new population */
     CityEvaluation();
@@ -4254,6 +4238,7 @@ int loadCity(char *filename) {
     int oldComPop;
     int oldIndPop;
     QUAD oldCityPop;
+    long recovered;
 
     /* Initialize variables at the top of function for C89 compliance */
     oldResPop = ResPop;
@@ -4266,12 +4251,16 @@ int loadCity(char *filename) {
     DisasterEvent = 0;
     DisasterWait = 0;
 
+    /* The previous city's journal ends here */
+    CloseJournal();
+
     lstrcpy(cityFileName, filename);
 
     if (!loadFile(filename)) {
         addGameLog("ERROR: Failed to load city file: %s", filename);
         return 0;
     }
+    JournalCityLoaded();
 
     xOffset = (WORLD_X * TILE_SIZE - cxClient) / 2;
     yOffset = (WORLD_Y * TILE_SIZE - cyClient) / 2;
@@ -4316,9 +4305,20 @@ int loadCity(char *filename) {
     /* Now we can initialize the simulation but preserve population */
     DoSimInit();
 
+    /* Recover changes made since the city was saved */
+    recovered = ReplayJournal(filename, -1);
+    if (recovered > 0) {
+        addGameLog("Recovered %ld frames of changes from the journal", recovered);
+    }
+
     /* Force a final population census calculation for the loaded city */
     ForceFullCensus();
 
+    /* Keep journalling on top of the recovered state */
+    if (JournalEnabled || recovered > 0) {
+        OpenJournal(filename, 0);
+    }
+
     /* Unpause simulation at medium speed */
     SetSimulationSpeed(hwndMain, SPEED_MEDIUM);
 
@@ -4717,6 +4717,63 @@ void drawTile(HDC hdc, int x, int y, short tileValue) {
      */
 }
 
+/* Release the overlay blend buffer */
+static void freeOverlayFrame(void) {
+    if (hdcOverlayFrame) {
+        SelectObject(hdcOverlayFrame, hbmOverlayFrameOld);
+        DeleteDC(hdcOverlayFrame);
+        hdcOverlayFrame = NULL;
+    }
+    if (hbmOverlayFrame) {
+        DeleteObject(hbmOverlayFrame);
+        hbmOverlayFrame = NULL;
+        overlayFrameBits = NULL;
+    }
+}
+
+/* The view buffer is 8-bit, so copy it into a 32-bit DIB, blend the
+   overlay there and copy it back */
+static void blendMapOverlay(HDC hdc) {
+    BITMAPINFOHEADER bi;
+    void *bits;
+    int width, height;
+
+    width = cxClient - toolbarWidth;
+    height = cyClient;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (!hdcOverlayFrame || width != overlayFrameWidth || height != overlayFrameHeight) {
+        freeOverlayFrame();
+
+        ZeroMemory(&bi, sizeof(BITMAPINFOHEADER));
+        bi.biSize = sizeof(BITMAPINFOHEADER);
+        bi.biWidth = width;
+        bi.biHeight = -height; /* Negative for top-down DIB */
+        bi.biPlanes = 1;
+        bi.biBitCount = 32;
+        bi.biCompression = BI_RGB;
+
+        hbmOverlayFrame = CreateDIBSection(hdc, (BITMAPINFO *)&bi, DIB_RGB_COLORS, &bits, NULL, 0);
+        if (hbmOverlayFrame == NULL) {
+            addDebugLog("Overlay: failed to create the blend buffer");
+            return;
+        }
+        overlayFrameBits = (OverlayPixel *)bits;
+        hdcOverlayFrame = CreateCompatibleDC(hdc);
+        hbmOverlayFrameOld = SelectObject(hdcOverlayFrame, hbmOverlayFrame);
+        overlayFrameWidth = width;
+        overlayFrameHeight = height;
+    }
+
+    BitBlt(hdcOverlayFrame, 0, 0, width, height, hdc, 0, 0, SRCCOPY);
+    GdiFlush();
+    if (OverlayBlend(overlayFrameBits, width, height, width, xOffset, yOffset, TILE_SIZE)) {
+        BitBlt(hdc, 0, 0, width, height, hdcOverlayFrame, 0, 0, SRCCOPY);
+    }
+}
+
 void drawCity(HDC hdc) {
     int x;
     int y;
@@ -4865,6 +4922,13 @@ void drawCity(HDC hdc) {
         }
     }
 
+    /* Blend the density overlay over the tiles */
+    if (GetOverlayLayer() != OVERLAY_NONE) {
+        PROFILE_BEGIN("BlendOverlay");
+        blendMapOverlay(hdc);
+        PROFILE_END("BlendOverlay");
+    }
+
     /* Show legend for power overlay if enabled - use cached brushes */
     if (powerOverlayEnabled) {
         RECT legendRect;
@@ -5043,7 +5107,7 @@ void drawCity(HDC hdc) {
         HPEN hOldPen;
         HBRUSH hOldBrush;
         
-        for (i = 0; i < MAX_SPRITES; i++) {
+        for (i = 0; i < GetSpriteSlotCount(); i++) {
             SimSprite *sprite = GetSprite(i);
             if (sprite != NULL) {
                 int spriteScreenX = sprite->x - xOffset;
@@ -5101,6 +5165,7 @@ void drawCity(HDC hdc) {
                         sprite->type == SPRITE_MONSTER || sprite->type == SPRITE_TORNADO) {
                         HBITMAP hbmSprite;
                         int frameIndex;
+                        int atlasX, atlasY;
                         
                         /* Get appropriate frame for the sprite */
                         frameIndex = sprite->frame - 1;
@@ -5137,7 +5202,11 @@ void drawCity(HDC hdc) {
                         /* Get the sprite bitmap */
                         hbmSprite = hbmSprites[sprite->type][frameIndex];
                         
-                        if (hbmSprite && hdcSprites) {
+                        if (hdcTiles && GetAtlasFrame(sprite->type, frameIndex, &atlasX, &atlasY)) {
+                            /* Packed in the tileset's atlas - draw straight from it */
+                            DrawTransparentBitmap(hdc, spriteScreenX - 16, spriteScreenY - 16,
+                                                32, 32, hdcTiles, atlasX, atlasY, RGB(255, 0, 255));
+                        } else if (hbmSprite && hdcSprites) {
                             HBITMAP hOldBitmap;
                             HPALETTE hOldPalette = NULL;
                             
@@ -5210,6 +5279,8 @@ void openCityDialog(HWND hwnd) {
 HMENU createMainMenu(void) {
     HMENU hMainMenu;
     HMENU hViewMenu;
+    char buf[32];
+    int i;
 
     hMainMenu = CreateMenu();
 
@@ -5218,6 +5289,7 @@ HMENU createMainMenu(void) {
     AppendMenu(hFileMenu, MF_STRING, IDM_FILE_OPEN, "&Open City...");
     AppendMenu(hFileMenu, MF_STRING, IDM_FILE_SAVE, "&Save City");
     AppendMenu(hFileMenu, MF_STRING, IDM_FILE_SAVE_AS, "Save City &As...");
+    AppendMenu(hFileMenu, MF_STRING, IDM_FILE_JOURNAL, "&Journal Changes");
     AppendMenu(hFileMenu, MF_SEPARATOR, 0, NULL);
     AppendMenu(hFileMenu, MF_STRING, IDM_FILE_EXIT, "E&xit");
 
@@ -5296,13 +5368,28 @@ HMENU createMainMenu(void) {
     CheckMenuItem(hViewMenu, IDM_VIEW_CHARTSWINDOW, MF_CHECKED);
     AppendMenu(hViewMenu, MF_SEPARATOR, 0, NULL);
     AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_POWER_OVERLAY, "&Power Overlay");
+
+    /* Density overlays blended over the city view */
+    hOverlayMenu = CreatePopupMenu();
+    for (i = 0; i < OVERLAY_COUNT; i++) {
+        AppendMenu(hOverlayMenu, MF_STRING, IDM_VIEW_OVERLAY_BASE + i, GetOverlayName(i));
+    }
+    AppendMenu(hOverlayMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hOverlayMenu, MF_STRING, IDM_VIEW_OVERLAY_SMOOTH, "&Smooth");
+    CHECK_MENU_RADIO_ITEM(hOverlayMenu, IDM_VIEW_OVERLAY_BASE, IDM_VIEW_OVERLAY_BASE + OVERLAY_COUNT - 1,
+                          IDM_VIEW_OVERLAY_BASE + OVERLAY_NONE, MF_BYCOMMAND);
+    AppendMenu(hViewMenu, MF_POPUP, (UINT)hOverlayMenu, "Map &Overlay");
     AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_TILESWINDOW, "Tile &Viewer");
     /* Leave unchecked by default since the tiles window is hidden on startup */
     CheckMenuItem(hViewMenu, IDM_VIEW_TILESWINDOW, MF_UNCHECKED);
     AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_TILE_DEBUG, "Tile &Debug");
     /* Leave unchecked by default since tile debug is disabled on startup */
     CheckMenuItem(hViewMenu, IDM_VIEW_TILE_DEBUG, MF_UNCHECKED);
+    AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_TILE_TRACE, "Tile T&race");
+    AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_HASH_LOG, "State &Hash Log");
+    AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_PROFILER, "&Profiler");
     AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_TEST_SAVELOAD, "Test Save/&Load");
+    AppendMenu(hViewMenu, MF_STRING, IDM_VIEW_DUMP_MINIMAP, "Dump Minimap &Snapshot");
 
     /* Spawn Menu */
     hSpawnMenu = CreatePopupMenu();
@@ -5341,6 +5428,41 @@ HMENU createMainMenu(void) {
     AppendMenu(hSettingsMenu, MF_STRING, IDM_SETTINGS_AUTO_BUDGET, "Auto &Budget");
     AppendMenu(hSettingsMenu, MF_STRING, IDM_SETTINGS_AUTO_BULLDOZE, "Auto B&ulldoze");
     AppendMenu(hSettingsMenu, MF_STRING, IDM_CHEATS_DISABLE_DISASTERS, "Enable &Disasters");
+
+    /* How a funding shortfall is split between services */
+    hBudgetPolicyMenu = CreatePopupMenu();
+    AppendMenu(hBudgetPolicyMenu, MF_STRING, IDM_SETTINGS_BUDGET_BASE + BUDGET_POLICY_INTERACTIVE,
+               "&Ask Each Year");
+    AppendMenu(hBudgetPolicyMenu, MF_STRING, IDM_SETTINGS_BUDGET_BASE + BUDGET_POLICY_PROPORTIONAL,
+               "&Proportional Cuts");
+    AppendMenu(hBudgetPolicyMenu, MF_STRING, IDM_SETTINGS_BUDGET_BASE + BUDGET_POLICY_PRIORITY,
+               "P&riority Order");
+    AppendMenu(hBudgetPolicyMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hBudgetPolicyMenu, MF_STRING, IDM_SETTINGS_RESERVE_BASE + 0, "Keep $&1,000 Reserve");
+    AppendMenu(hBudgetPolicyMenu, MF_STRING, IDM_SETTINGS_RESERVE_BASE + 1, "Keep $&5,000 Reserve");
+    AppendMenu(hBudgetPolicyMenu, MF_STRING, IDM_SETTINGS_RESERVE_BASE + 2, "Keep $&20,000 Reserve");
+    CHECK_MENU_RADIO_ITEM(hBudgetPolicyMenu, IDM_SETTINGS_BUDGET_BASE,
+                          IDM_SETTINGS_RESERVE_BASE + BUDGET_RESERVE_CHOICES - 1,
+                          IDM_SETTINGS_BUDGET_BASE + GetBudgetPolicy(), MF_BYCOMMAND);
+    AppendMenu(hSettingsMenu, MF_POPUP, (UINT)hBudgetPolicyMenu, "Budget Polic&y");
+    AppendMenu(hSettingsMenu, MF_SEPARATOR, 0, NULL);
+
+    /* Simulation shortcuts */
+    AppendMenu(hSettingsMenu, MF_STRING, IDM_SETTINGS_SIM_LOD, "Simulation &LOD");
+    AppendMenu(hSettingsMenu, MF_STRING, IDM_SETTINGS_POWER_FLOOD, "Flood Fill P&ower Scan");
+    AppendMenu(hSettingsMenu, MF_STRING, IDM_SETTINGS_TRAFFIC_FLOW, "Batched &Traffic Flow");
+    AppendMenu(hSettingsMenu, MF_STRING, IDM_SETTINGS_ZONE_SLEEP, "&Zone Sleep");
+
+    /* Sprites automatic generation keeps alive */
+    hSpriteLimitMenu = CreatePopupMenu();
+    for (i = 0; i < SPRITE_LIMIT_CHOICES; i++) {
+        wsprintf(buf, "%d Sprites", SpriteLimitChoices[i]);
+        AppendMenu(hSpriteLimitMenu, MF_STRING, IDM_SETTINGS_SPRITES_BASE + i, buf);
+    }
+    CHECK_MENU_RADIO_ITEM(hSpriteLimitMenu, IDM_SETTINGS_SPRITES_BASE,
+                          IDM_SETTINGS_SPRITES_BASE + SPRITE_LIMIT_CHOICES - 1,
+                          IDM_SETTINGS_SPRITES_BASE, MF_BYCOMMAND);
+    AppendMenu(hSettingsMenu, MF_POPUP, (UINT)hSpriteLimitMenu, "Sprite L&imit");
     
     /* Set default checkmarks */
     CheckMenuItem(hSettingsMenu, IDM_SIM_MEDIUM, MF_CHECKED); /* Default speed */
@@ -5348,6 +5470,10 @@ HMENU createMainMenu(void) {
     CheckMenuItem(hSettingsMenu, IDM_SETTINGS_AUTO_BUDGET, AutoBudget ? MF_CHECKED : MF_UNCHECKED);
     CheckMenuItem(hSettingsMenu, IDM_SETTINGS_AUTO_BULLDOZE, autoBulldoze ? MF_CHECKED : MF_UNCHECKED);
     CheckMenuItem(hSettingsMenu, IDM_CHEATS_DISABLE_DISASTERS, !disastersDisabled ? MF_CHECKED : MF_UNCHECKED);
+    CheckMenuItem(hSettingsMenu, IDM_SETTINGS_SIM_LOD, GetSimLod() ? MF_CHECKED : MF_UNCHECKED);
+    CheckMenuItem(hSettingsMenu, IDM_SETTINGS_POWER_FLOOD, GetPowerEngine() == POWER_ENGINE_FLOOD ? MF_CHECKED : MF_UNCHECKED);
+    CheckMenuItem(hSettingsMenu, IDM_SETTINGS_TRAFFIC_FLOW, GetTrafficEngine() == TRAFFIC_ENGINE_FLOW ? MF_CHECKED : MF_UNCHECKED);
+    CheckMenuItem(hSettingsMenu, IDM_SETTINGS_ZONE_SLEEP, GetZoneSleep() ? MF_CHECKED : MF_UNCHECKED);
 
     AppendMenu(hMainMenu, MF_POPUP, (UINT)hFileMenu, "&File");
     AppendMenu(hMainMenu, MF_POPUP, (UINT)hScenarioMenu, "&Scenarios");
@@ -5386,6 +5512,11 @@ void loadSpriteBitmaps(void) {
             extern int findSpriteResourceByName(const char* spriteType, int frameNumber);
             extern HBITMAP loadTilesetFromResource(int resourceId);
             
+            /* Already loaded for an earlier atlas */
+            if (hbmSprites[type + 1][frame]) {
+                continue;
+            }
+
             /* Find the resource ID for this sprite frame */
             resourceId = findSpriteResourceByName(prefix[type], frame);
             
@@ -5539,6 +5670,7 @@ void createNewMap(HWND hwnd) {
     
     /* Clear city filename since this is a new map */
     cityFileName[0] = '\0';
+    CloseJournal();
     
     /* Set default tileset for new maps */
     changeTileset(hwnd, "default");
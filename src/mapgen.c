@@ -6,6 +6,8 @@
 #include "mapgen.h"
 #include "sim.h"
 #include "tiles.h"
+#include "water.h"
+#include "noisegen.h"
 #include <windows.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,9 +31,9 @@ static int randArray[5] = {1018, 4521, 202, 419, 3};
 /* Map generation parameters */
 static MapGenParams currentParams;
 
-/* Initialize random number generator */
+/* Initialize random number generator - from the seed if one was given */
 static void initRandom(void) {
-    DWORD tick = GetTickCount();
+    DWORD tick = currentParams.seed ? (DWORD)currentParams.seed : GetTickCount();
     randArray[0] = tick & 0xFFFF;
     randArray[1] = (tick >> 8) & 0xFFFF;
     randArray[2] = (tick >> 16) & 0xFFFF;
@@ -392,6 +394,44 @@ static void smoothForestEdges(void) {
     }
 }
 
+/* Worker threads for the noise generator - one per processor */
+static int noiseThreadCount(void) {
+    SYSTEM_INFO sysInfo;
+
+    GetSystemInfo(&sysInfo);
+    return sysInfo.dwNumberOfProcessors > 0 ? (int)sysInfo.dwNumberOfProcessors : 1;
+}
+
+/* Fill noise generator settings from the map generation parameters */
+static void setupNoiseParams(MapGenParams *params, NoiseGenParams *noise) {
+    noise->seed = params->seed ? params->seed : (unsigned long)GetTickCount();
+    noise->waterPercent = params->waterPercent;
+    noise->forestPercent = params->forestPercent;
+    noise->octaves = 0;
+    noise->threads = noiseThreadCount();
+}
+
+/* Generate noise terrain (lakes, rivers and forests in one go) */
+static int generateNoiseMap(void) {
+    static short noiseTiles[WORLD_Y * WORLD_X];
+    NoiseGenParams noise;
+    int x, y;
+
+    setupNoiseParams(&currentParams, &noise);
+    addGameLog("Generating noise terrain, seed %lu", noise.seed);
+
+    if (!generateNoiseTerrain(&noise, noiseTiles, WORLD_X, WORLD_Y)) {
+        return 0;
+    }
+
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            setMapTile(x, y, noiseTiles[y * WORLD_X + x], 0, TILE_SET_REPLACE, "generateNoiseMap");
+        }
+    }
+    return 1;
+}
+
 /* Generate terrain map based on parameters */
 int generateTerrainMap(MapGenParams *params) {
     if (!params) {
@@ -402,7 +442,8 @@ int generateTerrainMap(MapGenParams *params) {
     currentParams = *params;
     
     addGameLog("Generating terrain map: Type=%s, Water=%d%%, Forest=%d%%",
-              (params->mapType == MAPTYPE_RIVERS) ? "Rivers" : "Island",
+              (params->mapType == MAPTYPE_RIVERS) ? "Rivers" :
+              (params->mapType == MAPTYPE_NOISE) ? "Noise" : "Island",
               params->waterPercent, params->forestPercent);
     
     /* Initialize random number generator */
@@ -419,6 +460,12 @@ int generateTerrainMap(MapGenParams *params) {
     case MAPTYPE_ISLAND:
         generateIsland();
         break;
+    case MAPTYPE_NOISE:
+        if (!generateNoiseMap()) {
+            addGameLog("ERROR: Noise terrain generation failed");
+            return 0;
+        }
+        break;
     default:
         /* Random choice - 10% chance for island */
         if (genRandom(10) == 0) {
@@ -429,14 +476,14 @@ int generateTerrainMap(MapGenParams *params) {
         break;
     }
     
-    /* Add lakes based on water percentage */
-    if (params->waterPercent > 0) {
-        generateLakes(params->waterPercent);
-    }
-    
-    /* Add forests based on forest percentage */
-    if (params->forestPercent > 0) {
-        generateForests(params->forestPercent);
+    /* Add lakes and forests (the noise generator places its own) */
+    if (params->mapType != MAPTYPE_NOISE) {
+        if (params->waterPercent > 0) {
+            generateLakes(params->waterPercent);
+        }
+        if (params->forestPercent > 0) {
+            generateForests(params->forestPercent);
+        }
     }
     
     /* Smooth edges for natural appearance */
@@ -444,10 +491,35 @@ int generateTerrainMap(MapGenParams *params) {
     smoothForestEdges();
     smoothForestEdges(); /* Run twice for better smoothing */
     
+    /* Build the water distance field once for the new terrain */
+    RebuildWaterField();
+    
     addGameLog("Terrain generation completed successfully");
     return 1;
 }
 
+/* Preview colour for a terrain tile */
+static COLORREF previewTileColor(int tile) {
+    switch (tile) {
+    case DIRT_TILE:
+        return RGB(139, 69, 19); /* Brown */
+    case RIVER_TILE:
+    case CHANNEL_TILE:
+        return RGB(0, 0, 255); /* Blue */
+    case RIVER_EDGE_TILE:
+        return RGB(0, 100, 200); /* Light blue */
+    case WOODS_TILE:
+        return RGB(0, 128, 0); /* Green */
+    default:
+        if (tile >= 29 && tile <= 37) {
+            return RGB(0, 100, 0); /* Dark green for tree variants */
+        } else if (tile >= 2 && tile <= 20) {
+            return RGB(0, 0, 200); /* Blue for water variants */
+        }
+        return RGB(139, 69, 19); /* Brown for everything else */
+    }
+}
+
 /* Generate small preview bitmap for map */
 int generateMapPreview(MapGenParams *params, HBITMAP *previewBitmap, int width, int height) {
     HDC hdc, memDC;
@@ -455,8 +527,8 @@ int generateMapPreview(MapGenParams *params, HBITMAP *previewBitmap, int width,
     int x, y, mapX, mapY, tile;
     int actualWidth, actualHeight, offsetX, offsetY;
     float aspectRatio, widthRatio, heightRatio;
-    COLORREF tileColor;
     HBRUSH bgBrush;
+    short *previewTiles;
     
     if (!params || !previewBitmap) {
         return 0;
@@ -479,8 +551,22 @@ int generateMapPreview(MapGenParams *params, HBITMAP *previewBitmap, int width,
     
     addGameLog("Generating map preview %dx%d (actual: %dx%d)", width, height, actualWidth, actualHeight);
     
-    /* Create temporary terrain map */
-    if (!generateTerrainMap(params)) {
+    /* Noise maps are sampled straight at preview size, the others need
+     * a full temporary terrain map */
+    previewTiles = NULL;
+    if (params->mapType == MAPTYPE_NOISE) {
+        NoiseGenParams noise;
+
+        previewTiles = (short *)malloc(actualWidth * actualHeight * sizeof(short));
+        if (!previewTiles) {
+            return 0;
+        }
+        setupNoiseParams(params, &noise);
+        if (!generateNoisePreview(&noise, previewTiles, actualWidth, actualHeight, WORLD_X, WORLD_Y)) {
+            free(previewTiles);
+            return 0;
+        }
+    } else if (!generateTerrainMap(params)) {
         return 0;
     }
     
@@ -503,43 +589,23 @@ int generateMapPreview(MapGenParams *params, HBITMAP *previewBitmap, int width,
     /* Draw preview centered with proper aspect ratio */
     for (y = 0; y < actualHeight; y++) {
         for (x = 0; x < actualWidth; x++) {
-            /* Map preview coordinates to world coordinates */
-            mapX = (x * WORLD_X) / actualWidth;
-            mapY = (y * WORLD_Y) / actualHeight;
-            
-            tile = getMapTile(mapX, mapY);
-            
-            /* Convert tile to color */
-            switch (tile) {
-            case DIRT_TILE:
-                tileColor = RGB(139, 69, 19); /* Brown */
-                break;
-            case RIVER_TILE:
-            case CHANNEL_TILE:
-                tileColor = RGB(0, 0, 255); /* Blue */
-                break;
-            case RIVER_EDGE_TILE:
-                tileColor = RGB(0, 100, 200); /* Light blue */
-                break;
-            case WOODS_TILE:
-                tileColor = RGB(0, 128, 0); /* Green */
-                break;
-            default:
-                if (tile >= 29 && tile <= 37) {
-                    tileColor = RGB(0, 100, 0); /* Dark green for tree variants */
-                } else if (tile >= 2 && tile <= 20) {
-                    tileColor = RGB(0, 0, 200); /* Blue for water variants */
-                } else {
-                    tileColor = RGB(139, 69, 19); /* Brown for everything else */
-                }
-                break;
+            if (previewTiles) {
+                tile = previewTiles[y * actualWidth + x];
+            } else {
+                /* Map preview coordinates to world coordinates */
+                mapX = (x * WORLD_X) / actualWidth;
+                mapY = (y * WORLD_Y) / actualHeight;
+                tile = getMapTile(mapX, mapY);
             }
             
-            SetPixel(memDC, x + offsetX, y + offsetY, tileColor);
+            SetPixel(memDC, x + offsetX, y + offsetY, previewTileColor(tile));
         }
     }
     
     /* Clean up */
+    if (previewTiles) {
+        free(previewTiles);
+    }
     SelectObject(memDC, oldBitmap);
     DeleteDC(memDC);
     ReleaseDC(NULL, hdc);
@@ -555,4 +621,5 @@ void initMapGenParams(MapGenParams *params) {
     params->mapType = MAPTYPE_RIVERS;
     params->waterPercent = 25;
     params->forestPercent = 30;
+    params->seed = 0;
 }
\ No newline at end of file
@@ -8,12 +8,14 @@
 /* Map types */
 #define MAPTYPE_RIVERS 0
 #define MAPTYPE_ISLAND 1
+#define MAPTYPE_NOISE 2
 
 /* Map generation parameters */
 typedef struct {
-    int mapType;        /* MAPTYPE_RIVERS or MAPTYPE_ISLAND */
+    int mapType;        /* MAPTYPE_RIVERS, MAPTYPE_ISLAND or MAPTYPE_NOISE */
     int waterPercent;   /* Percentage of water coverage (0-100) */
     int forestPercent;  /* Percentage of forest coverage (0-100) */
+    unsigned long seed; /* Generator seed, 0 to pick one from the clock */
 } MapGenParams;
 
 /* Function prototypes */
@@ -0,0 +1,389 @@
+/* minimap.c - Overview map raster for WiNTown
+ * Tile modes look each tile up in a 1024 entry table per mode, so a tile
+ * change repaints its pixel in every mode at once. Overlay modes look the
+ * scanner's value up in a 256 entry table; when a scanner has run, only
+ * the cells whose value moved since they were last drawn are repainted.
+ * Every repaint that changes a pixel grows the mode's dirty rectangle,
+ * which tells the window how much of itself to refresh.
+ */
+
+#include "sim.h"
+#include "minimap.h"
+#include <stdio.h>
+#include <string.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Colours of the all mode */
+#define ALL_DIRT        0
+#define ALL_RESIDENTIAL 1
+#define ALL_COMMERCIAL  2
+#define ALL_INDUSTRIAL  3
+#define ALL_ROAD        4
+#define ALL_RAIL        5
+#define ALL_POWERLINE   6
+#define ALL_WATER       7
+#define ALL_TREES       8
+#define ALL_OTHER       9
+
+/* Overlays shown in five bands - the lower bound of each band above the
+   first, and the colours from the lowest band up */
+typedef struct {
+    int mode;
+    int divide; /* The map's value is divided by this before banding */
+    int limit[4];
+    Byte colour[5][3];
+} MinimapBands;
+
+static const MinimapBands Bands[] = {
+    {MINIMAP_MODE_TRAFFIC, 1, {20, 40, 80, 120},
+     {{0, 255, 128}, {128, 255, 0}, {255, 255, 0}, {255, 128, 0}, {255, 0, 0}}},
+    {MINIMAP_MODE_POLLUTION, 1, {50, 100, 150, 200},
+     {{0, 255, 128}, {128, 255, 0}, {255, 255, 0}, {255, 128, 0}, {255, 0, 0}}},
+    {MINIMAP_MODE_CRIME, 1, {50, 100, 150, 200},
+     {{255, 255, 0}, {255, 192, 0}, {255, 128, 0}, {255, 64, 0}, {255, 0, 0}}},
+    {MINIMAP_MODE_LANDVALUE, 1, {50, 100, 150, 200},
+     {{255, 255, 192}, {192, 255, 192}, {128, 255, 128}, {64, 255, 64}, {0, 255, 0}}},
+    {MINIMAP_MODE_FIRE, 4, {50, 100, 150, 200},
+     {{255, 224, 224}, {255, 192, 192}, {255, 128, 128}, {255, 64, 64}, {255, 0, 0}}},
+    {MINIMAP_MODE_POLICE, 4, {50, 100, 150, 200},
+     {{224, 224, 255}, {192, 192, 255}, {128, 128, 255}, {64, 64, 255}, {0, 0, 255}}}
+};
+
+static Byte Raster[MINIMAP_MODE_COUNT][WORLD_Y][WORLD_X];
+static Byte Palette[MINIMAP_MODE_COUNT][MINIMAP_COLOURS][3];
+static Byte TileLut[MINIMAP_MODE_COUNT][1024];
+static Byte ValueLut[MINIMAP_MODE_COUNT][256];
+
+/* Overlay values as last drawn, by cell of the overlay's own map */
+static Byte LastValue[MINIMAP_MODE_COUNT][WORLD_Y / 2][WORLD_X / 2];
+static char OverlayStale[MINIMAP_MODE_COUNT];
+
+/* Changed since the window last asked - empty while x1 >= x2 */
+static short DirtyX1[MINIMAP_MODE_COUNT], DirtyY1[MINIMAP_MODE_COUNT];
+static short DirtyX2[MINIMAP_MODE_COUNT], DirtyY2[MINIMAP_MODE_COUNT];
+
+static int MinimapBuilt = 0;
+
+static void SetColour(int mode, int index, int r, int g, int b) {
+    Palette[mode][index][0] = (Byte)r;
+    Palette[mode][index][1] = (Byte)g;
+    Palette[mode][index][2] = (Byte)b;
+}
+
+/* The all mode, in the order the old per-pixel tests ran */
+static int AllColour(int tile) {
+    if (tile >= RESBASE && tile < HOSPITAL) {
+        return ALL_RESIDENTIAL;
+    }
+    if (tile >= COMBASE && tile < INDBASE) {
+        return ALL_COMMERCIAL;
+    }
+    if (tile >= INDBASE && tile < PORTBASE) {
+        return ALL_INDUSTRIAL;
+    }
+    if (tile >= ROADBASE && tile <= LASTROAD) {
+        return ALL_ROAD;
+    }
+    if (tile >= RAILBASE && tile <= LASTRAIL) {
+        return ALL_RAIL;
+    }
+    if (tile >= POWERBASE && tile <= LASTPOWER) {
+        return ALL_POWERLINE;
+    }
+    if (tile >= RIVER && tile <= LASTRIVEDGE) {
+        return ALL_WATER;
+    }
+    if (tile >= TREEBASE && tile <= WOODS5) {
+        return ALL_TREES;
+    }
+    return tile ? ALL_OTHER : ALL_DIRT;
+}
+
+/* Zone density as a shade, 25 a step */
+static int Shade(int density) {
+    return density * 25 > 255 ? 255 : density * 25;
+}
+
+static void BuildTables(void) {
+    const MinimapBands *b;
+    int i, t, v, band;
+
+    memset(Palette, 0, sizeof(Palette));
+    memset(TileLut, 0, sizeof(TileLut));
+    memset(ValueLut, 0, sizeof(ValueLut));
+
+    SetColour(MINIMAP_MODE_ALL, ALL_DIRT, 32, 32, 32);
+    SetColour(MINIMAP_MODE_ALL, ALL_RESIDENTIAL, 0, 255, 0);
+    SetColour(MINIMAP_MODE_ALL, ALL_COMMERCIAL, 0, 0, 255);
+    SetColour(MINIMAP_MODE_ALL, ALL_INDUSTRIAL, 255, 255, 0);
+    SetColour(MINIMAP_MODE_ALL, ALL_ROAD, 128, 128, 128);
+    SetColour(MINIMAP_MODE_ALL, ALL_RAIL, 192, 192, 192);
+    SetColour(MINIMAP_MODE_ALL, ALL_POWERLINE, 255, 0, 0);
+    SetColour(MINIMAP_MODE_ALL, ALL_WATER, 0, 128, 255);
+    SetColour(MINIMAP_MODE_ALL, ALL_TREES, 0, 128, 0);
+    SetColour(MINIMAP_MODE_ALL, ALL_OTHER, 64, 64, 64);
+
+    /* Power goes by the tile's flags rather than its number */
+    SetColour(MINIMAP_MODE_POWER, 1, 255, 255, 0);
+    SetColour(MINIMAP_MODE_POWER, 2, 128, 0, 0);
+
+    SetColour(MINIMAP_MODE_TRANSPORT, 1, 255, 255, 255);
+    SetColour(MINIMAP_MODE_TRANSPORT, 2, 192, 192, 192);
+
+    /* Shaded modes use the shade itself as the index */
+    for (i = 0; i < MINIMAP_COLOURS; i++) {
+        SetColour(MINIMAP_MODE_RESIDENTIAL, i, 0, i, 0);
+        SetColour(MINIMAP_MODE_COMMERCIAL, i, 0, 0, i);
+        SetColour(MINIMAP_MODE_INDUSTRIAL, i, i, i, 0);
+        SetColour(MINIMAP_MODE_POPULATION, i, i, 0, i);
+    }
+
+    for (t = 0; t < 1024; t++) {
+        TileLut[MINIMAP_MODE_ALL][t] = (Byte)AllColour(t);
+        if (t >= RESBASE && t < HOSPITAL) {
+            TileLut[MINIMAP_MODE_RESIDENTIAL][t] = (Byte)Shade(calcResPop(t));
+            /* Faint where no one lives yet */
+            TileLut[MINIMAP_MODE_POPULATION][t] = 32;
+        } else if (t >= COMBASE && t < INDBASE) {
+            TileLut[MINIMAP_MODE_COMMERCIAL][t] = (Byte)Shade(calcComPop(t));
+        } else if (t >= INDBASE && t < PORTBASE) {
+            TileLut[MINIMAP_MODE_INDUSTRIAL][t] = (Byte)Shade(calcIndPop(t));
+        }
+        if (t >= ROADBASE && t <= LASTROAD) {
+            TileLut[MINIMAP_MODE_TRANSPORT][t] = 1;
+        } else if (t >= RAILBASE && t <= LASTRAIL) {
+            TileLut[MINIMAP_MODE_TRANSPORT][t] = 2;
+        }
+    }
+
+    for (v = 1; v < 256; v++) {
+        ValueLut[MINIMAP_MODE_POPULATION][v] = (Byte)(v * 2 > 255 ? 255 : v * 2);
+    }
+
+    for (b = Bands; b < Bands + sizeof(Bands) / sizeof(Bands[0]); b++) {
+        for (i = 0; i < 5; i++) {
+            SetColour(b->mode, i + 1, b->colour[i][0], b->colour[i][1], b->colour[i][2]);
+        }
+        for (v = 1; v < 256; v++) {
+            band = 1;
+            while (band < 5 && v / b->divide >= b->limit[band - 1]) {
+                band++;
+            }
+            ValueLut[b->mode][v] = (Byte)band;
+        }
+    }
+}
+
+/* The scanner map behind an overlay mode and how many tiles a cell is
+   across, as a shift - NULL for modes drawn from the tiles */
+static const Byte *OverlayMap(int mode, int *shift) {
+    *shift = 1;
+    switch (mode) {
+    case MINIMAP_MODE_POPULATION: return &PopDensity[0][0];
+    case MINIMAP_MODE_TRAFFIC: return &TrfDensity[0][0];
+    case MINIMAP_MODE_POLLUTION: return &PollutionMem[0][0];
+    case MINIMAP_MODE_CRIME: return &CrimeMem[0][0];
+    case MINIMAP_MODE_LANDVALUE: return &LandValueMem[0][0];
+    }
+    *shift = 2;
+    switch (mode) {
+    case MINIMAP_MODE_FIRE: return &FireRate[0][0];
+    case MINIMAP_MODE_POLICE: return &PoliceMapEffect[0][0];
+    }
+    return NULL;
+}
+
+static int PixelIndex(int mode, int x, int y) {
+    const Byte *map;
+    int tile, shift, value;
+
+    tile = Map[y][x];
+    if (mode == MINIMAP_MODE_POWER) {
+        return (tile & POWERBIT) ? 1 : (tile & CONDBIT) ? 2 : 0;
+    }
+    map = OverlayMap(mode, &shift);
+    if (!map) {
+        return TileLut[mode][tile & LOMASK];
+    }
+    value = map[(y >> shift) * (WORLD_X >> shift) + (x >> shift)];
+    if (!value) {
+        return TileLut[mode][tile & LOMASK];
+    }
+    return ValueLut[mode][value];
+}
+
+static void Paint(int mode, int x, int y) {
+    int index;
+
+    index = PixelIndex(mode, x, y);
+    if (Raster[mode][y][x] == index) {
+        return;
+    }
+    Raster[mode][y][x] = (Byte)index;
+
+    if (DirtyX1[mode] >= DirtyX2[mode]) {
+        DirtyX1[mode] = (short)x;
+        DirtyY1[mode] = (short)y;
+        DirtyX2[mode] = (short)(x + 1);
+        DirtyY2[mode] = (short)(y + 1);
+        return;
+    }
+    if (x < DirtyX1[mode]) {
+        DirtyX1[mode] = (short)x;
+    }
+    if (y < DirtyY1[mode]) {
+        DirtyY1[mode] = (short)y;
+    }
+    if (x >= DirtyX2[mode]) {
+        DirtyX2[mode] = (short)(x + 1);
+    }
+    if (y >= DirtyY2[mode]) {
+        DirtyY2[mode] = (short)(y + 1);
+    }
+}
+
+/* Draw every mode from scratch */
+static void BuildMinimap(void) {
+    const Byte *map;
+    int mode, shift, x, y;
+
+    BuildTables();
+    for (mode = 0; mode < MINIMAP_MODE_COUNT; mode++) {
+        for (y = 0; y < WORLD_Y; y++) {
+            for (x = 0; x < WORLD_X; x++) {
+                Raster[mode][y][x] = (Byte)PixelIndex(mode, x, y);
+            }
+        }
+        map = OverlayMap(mode, &shift);
+        if (map) {
+            for (y = 0; y < WORLD_Y >> shift; y++) {
+                memcpy(LastValue[mode][y], map + y * (WORLD_X >> shift), WORLD_X >> shift);
+            }
+        }
+        OverlayStale[mode] = 0;
+        DirtyX1[mode] = 0;
+        DirtyY1[mode] = 0;
+        DirtyX2[mode] = WORLD_X;
+        DirtyY2[mode] = WORLD_Y;
+    }
+    MinimapBuilt = 1;
+    addDebugLog("Minimap raster built for %d modes", MINIMAP_MODE_COUNT);
+}
+
+/* Repaint the cells of an overlay whose value moved since they were drawn */
+static void RefreshOverlay(int mode) {
+    const Byte *map;
+    int shift, cx, cy, x, y, size, value;
+
+    if (!OverlayStale[mode]) {
+        return;
+    }
+    OverlayStale[mode] = 0;
+    map = OverlayMap(mode, &shift);
+    size = 1 << shift;
+    for (cy = 0; cy < WORLD_Y >> shift; cy++) {
+        for (cx = 0; cx < WORLD_X >> shift; cx++) {
+            value = map[cy * (WORLD_X >> shift) + cx];
+            if (value == LastValue[mode][cy][cx]) {
+                continue;
+            }
+            LastValue[mode][cy][cx] = (Byte)value;
+            for (y = cy * size; y < cy * size + size; y++) {
+                for (x = cx * size; x < cx * size + size; x++) {
+                    Paint(mode, x, y);
+                }
+            }
+        }
+    }
+}
+
+static int ValidMode(int mode) {
+    if (!MinimapBuilt) {
+        BuildMinimap();
+    }
+    if (mode < 0 || mode >= MINIMAP_MODE_COUNT) {
+        return MINIMAP_MODE_ALL;
+    }
+    RefreshOverlay(mode);
+    return mode;
+}
+
+/* Called by setMapTile() for every tile change */
+void MinimapTileChanged(int x, int y, int oldTile, int newTile) {
+    if (!MinimapBuilt) {
+        return;
+    }
+    if (((oldTile ^ newTile) & (LOMASK | POWERBIT | CONDBIT)) == 0) {
+        return;
+    }
+
+    /* Modes that draw from the tiles, the population mode where it has no density */
+    Paint(MINIMAP_MODE_ALL, x, y);
+    Paint(MINIMAP_MODE_RESIDENTIAL, x, y);
+    Paint(MINIMAP_MODE_COMMERCIAL, x, y);
+    Paint(MINIMAP_MODE_INDUSTRIAL, x, y);
+    Paint(MINIMAP_MODE_POWER, x, y);
+    Paint(MINIMAP_MODE_TRANSPORT, x, y);
+    Paint(MINIMAP_MODE_POPULATION, x, y);
+}
+
+void MinimapOverlayChanged(int mode) {
+    if (mode >= 0 && mode < MINIMAP_MODE_COUNT) {
+        OverlayStale[mode] = 1;
+    }
+}
+
+void MinimapOverlaysChanged(void) {
+    /* Draw the whole raster again on next use, so a new city starts
+       from its map whatever reached the hook while it was set up */
+    memset(OverlayStale, 1, sizeof(OverlayStale));
+    MinimapBuilt = 0;
+}
+
+const unsigned char *MinimapRaster(int mode) {
+    mode = ValidMode(mode);
+    return &Raster[mode][0][0];
+}
+
+const unsigned char *MinimapPalette(int mode) {
+    mode = ValidMode(mode);
+    return &Palette[mode][0][0];
+}
+
+int MinimapTakeDirty(int mode, int *x1, int *y1, int *x2, int *y2) {
+    mode = ValidMode(mode);
+    if (DirtyX1[mode] >= DirtyX2[mode]) {
+        return 0;
+    }
+    *x1 = DirtyX1[mode];
+    *y1 = DirtyY1[mode];
+    *x2 = DirtyX2[mode];
+    *y2 = DirtyY2[mode];
+    DirtyX1[mode] = 0;
+    DirtyX2[mode] = 0;
+    return 1;
+}
+
+int MinimapWritePPM(int mode, const char *path) {
+    FILE *f;
+    Byte row[WORLD_X * 3];
+    int x, y;
+
+    mode = ValidMode(mode);
+    f = fopen(path, "wb");
+    if (!f) {
+        addDebugLog("Minimap: cannot write %s", path);
+        return 0;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", WORLD_X, WORLD_Y);
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            memcpy(row + x * 3, Palette[mode][Raster[mode][y][x]], 3);
+        }
+        fwrite(row, 1, sizeof(row), f);
+    }
+    fclose(f);
+    return 1;
+}
@@ -0,0 +1,53 @@
+/* minimap.h - Overview map raster for WiNTown
+ * One byte per tile for every minimap mode, kept current as tiles change
+ * and as the scanners refresh the overlay maps. Each byte indexes the
+ * mode's palette, so a window only has to stretch the raster onto the
+ * screen with that palette as its colour table.
+ */
+
+#ifndef _MINIMAP_H
+#define _MINIMAP_H
+
+/* Minimap view modes */
+#define MINIMAP_MODE_ALL 0
+#define MINIMAP_MODE_RESIDENTIAL 1
+#define MINIMAP_MODE_COMMERCIAL 2
+#define MINIMAP_MODE_INDUSTRIAL 3
+#define MINIMAP_MODE_POWER 4
+#define MINIMAP_MODE_TRANSPORT 5
+#define MINIMAP_MODE_POPULATION 6
+#define MINIMAP_MODE_TRAFFIC 7
+#define MINIMAP_MODE_POLLUTION 8
+#define MINIMAP_MODE_CRIME 9
+#define MINIMAP_MODE_LANDVALUE 10
+#define MINIMAP_MODE_FIRE 11
+#define MINIMAP_MODE_POLICE 12
+#define MINIMAP_MODE_COUNT 13
+
+/* Palette entries per mode, each red, green, blue */
+#define MINIMAP_COLOURS 256
+
+/* Called by setMapTile() for every tile change */
+void MinimapTileChanged(int x, int y, int oldTile, int newTile);
+
+/* Called when a scanner has rewritten the map a mode shows */
+void MinimapOverlayChanged(int mode);
+
+/* Mark every mode stale, as after a new city - the raster is then drawn
+   again from the map on next use */
+void MinimapOverlaysChanged(void);
+
+/* The mode's raster, WORLD_X bytes a row from the top, brought up to date */
+const unsigned char *MinimapRaster(int mode);
+
+/* The mode's palette, MINIMAP_COLOURS entries of red, green, blue */
+const unsigned char *MinimapPalette(int mode);
+
+/* Take the tiles that changed in a mode since the last call - returns 0
+   if none did, otherwise sets the rectangle x1 <= x < x2, y1 <= y < y2 */
+int MinimapTakeDirty(int mode, int *x1, int *y1, int *x2, int *y2);
+
+/* Write a mode as a binary PPM, one pixel per tile - returns 0 on failure */
+int MinimapWritePPM(int mode, const char *path);
+
+#endif /* _MINIMAP_H */
@@ -8,6 +8,7 @@
 #include "sim.h"
 #include "tiles.h"
 #include "assets.h"
+#include "journal.h"
 #include <windows.h>
 #include <commdlg.h>
 #include <stdio.h>
@@ -51,6 +52,27 @@ static int scenarioCount = 8;
 static NewGameConfig *currentConfig = NULL;
 static HBITMAP currentPreviewBitmap = NULL;
 
+/* Map type picked by the Island and Noise checkboxes */
+static int dialogMapType(HWND hwnd) {
+    if (IsDlgButtonChecked(hwnd, IDC_MAP_NOISE) == BST_CHECKED) {
+        return MAPTYPE_NOISE;
+    }
+    return (IsDlgButtonChecked(hwnd, IDC_MAP_ISLAND) == BST_CHECKED) ? MAPTYPE_ISLAND : MAPTYPE_RIVERS;
+}
+
+/* Seed for a new preview, kept so the city is generated from the same one */
+static unsigned long newPreviewSeed(void) {
+    unsigned long seed = (unsigned long)GetTickCount();
+
+    if (!seed) {
+        seed = 1;
+    }
+    if (currentConfig) {
+        currentConfig->mapSeed = seed;
+    }
+    return seed;
+}
+
 /* Helper function to generate preview map */
 static void generateDefaultPreview(HWND hwnd) {
     MapGenParams params;
@@ -58,7 +80,6 @@ static void generateDefaultPreview(HWND hwnd) {
     RECT previewRect;
     int previewWidth, previewHeight;
     int waterPos, forestPos;
-    int isIslandChecked;
     
     /* Get current slider values */
     waterPos = GetScrollPos(GetDlgItem(hwnd, IDC_WATER_PERCENT), SB_CTL);
@@ -71,10 +92,10 @@ static void generateDefaultPreview(HWND hwnd) {
     previewHeight = previewRect.bottom - previewRect.top;
     
     /* Set up parameters - read checkbox state directly */
-    isIslandChecked = (IsDlgButtonChecked(hwnd, IDC_MAP_ISLAND) == BST_CHECKED);
-    params.mapType = isIslandChecked ? MAPTYPE_ISLAND : MAPTYPE_RIVERS;
+    params.mapType = dialogMapType(hwnd);
     params.waterPercent = waterPos;
     params.forestPercent = forestPos;
+    params.seed = newPreviewSeed();
     
     /* Clean up previous bitmap */
     if (currentPreviewBitmap) {
@@ -108,6 +129,7 @@ int showNewGameDialog(HWND parent, NewGameConfig *config) {
     strcpy(config->cityName, "New City");
     config->loadFile[0] = '\0';
     config->mapType = MAPTYPE_RIVERS; /* Default: unchecked = rivers */
+    config->mapSeed = 0;
     config->waterPercent = 25;
     config->forestPercent = 30;
     config->loadFromInternal = 1;
@@ -161,6 +183,7 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
         
         /* Initialize map generation controls */
         CheckDlgButton(hwnd, IDC_MAP_ISLAND, BST_UNCHECKED);
+        CheckDlgButton(hwnd, IDC_MAP_NOISE, BST_UNCHECKED);
         SetScrollRange(GetDlgItem(hwnd, IDC_WATER_PERCENT), SB_CTL, 0, 100, FALSE);
         SetScrollPos(GetDlgItem(hwnd, IDC_WATER_PERCENT), SB_CTL, 25, TRUE);
         SetScrollRange(GetDlgItem(hwnd, IDC_FOREST_PERCENT), SB_CTL, 0, 100, FALSE);
@@ -214,7 +237,6 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
         RECT previewRect;
         int previewWidth, previewHeight;
         int waterPos, forestPos;
-        int isIslandChecked;
         
         switch (LOWORD(wParam)) {
         case IDC_NEW_CITY:
@@ -225,6 +247,7 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_MEDIUM), TRUE);
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_HARD), TRUE);
                 EnableWindow(GetDlgItem(hwnd, IDC_MAP_ISLAND), TRUE);
+                EnableWindow(GetDlgItem(hwnd, IDC_MAP_NOISE), TRUE);
                 EnableWindow(GetDlgItem(hwnd, IDC_WATER_PERCENT), TRUE);
                 EnableWindow(GetDlgItem(hwnd, IDC_FOREST_PERCENT), TRUE);
                 EnableWindow(GetDlgItem(hwnd, IDC_GENERATE_PREVIEW), TRUE);
@@ -245,6 +268,7 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_MEDIUM), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_HARD), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_MAP_ISLAND), FALSE);
+                EnableWindow(GetDlgItem(hwnd, IDC_MAP_NOISE), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_WATER_PERCENT), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_FOREST_PERCENT), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_GENERATE_PREVIEW), FALSE);
@@ -281,6 +305,7 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_MEDIUM), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_HARD), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_MAP_ISLAND), FALSE);
+                EnableWindow(GetDlgItem(hwnd, IDC_MAP_NOISE), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_WATER_PERCENT), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_FOREST_PERCENT), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_GENERATE_PREVIEW), FALSE);
@@ -301,6 +326,7 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_MEDIUM), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_DIFFICULTY_HARD), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_MAP_ISLAND), FALSE);
+                EnableWindow(GetDlgItem(hwnd, IDC_MAP_NOISE), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_WATER_PERCENT), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_FOREST_PERCENT), FALSE);
                 EnableWindow(GetDlgItem(hwnd, IDC_GENERATE_PREVIEW), FALSE);
@@ -332,9 +358,14 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
             break;
             
         case IDC_MAP_ISLAND:
+        case IDC_MAP_NOISE:
             if (HIWORD(wParam) == BN_CLICKED && currentConfig) {
-                int isChecked = (IsDlgButtonChecked(hwnd, IDC_MAP_ISLAND) == BST_CHECKED);
-                currentConfig->mapType = isChecked ? MAPTYPE_ISLAND : MAPTYPE_RIVERS;
+                /* Island and noise maps exclude each other */
+                if (IsDlgButtonChecked(hwnd, LOWORD(wParam)) == BST_CHECKED) {
+                    CheckDlgButton(hwnd, LOWORD(wParam) == IDC_MAP_ISLAND ? IDC_MAP_NOISE : IDC_MAP_ISLAND,
+                                   BST_UNCHECKED);
+                }
+                currentConfig->mapType = dialogMapType(hwnd);
             }
             break;
             
@@ -352,10 +383,10 @@ BOOL CALLBACK newGameDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
                 previewHeight = previewRect.bottom - previewRect.top;
                 
                 /* Set up parameters - read checkbox state directly */
-                isIslandChecked = (IsDlgButtonChecked(hwnd, IDC_MAP_ISLAND) == BST_CHECKED);
-                params.mapType = isIslandChecked ? MAPTYPE_ISLAND : MAPTYPE_RIVERS;
+                params.mapType = dialogMapType(hwnd);
                 params.waterPercent = waterPos;
                 params.forestPercent = forestPos;
+                params.seed = newPreviewSeed();
                 
                 
                 /* Clean up previous bitmap */
@@ -627,12 +658,15 @@ int initNewGame(NewGameConfig *config) {
     if (!config) {
         return 0;
     }
+
+    /* The current city's journal ends here */
+    CloseJournal();
     
     switch (config->gameType) {
     case NEWGAME_NEW_CITY:
         return generateNewCityWithTerrain(config->cityName, config->difficulty, 
                                         config->mapType, config->waterPercent, 
-                                        config->forestPercent);
+                                        config->forestPercent, config->mapSeed);
         
     case NEWGAME_LOAD_CITY_BUILTIN:
         /* Load city from internal resources */
@@ -736,7 +770,8 @@ int generateNewCity(char *cityName, int difficulty) {
 }
 
 /* Generate a new city with terrain */
-int generateNewCityWithTerrain(char *cityName, int difficulty, int mapType, int waterPercent, int forestPercent) {
+int generateNewCityWithTerrain(char *cityName, int difficulty, int mapType, int waterPercent, int forestPercent,
+                               unsigned long seed) {
     MapGenParams params;
     
     if (!cityName) {
@@ -744,7 +779,8 @@ int generateNewCityWithTerrain(char *cityName, int difficulty, int mapType, int
     }
     
     addGameLog("Generating new city with terrain: %s (Type: %s, Water: %d%%, Forest: %d%%)", 
-              cityName, (mapType == MAPTYPE_RIVERS) ? "Rivers" : "Island", 
+              cityName, (mapType == MAPTYPE_RIVERS) ? "Rivers" :
+              (mapType == MAPTYPE_NOISE) ? "Noise" : "Island", 
               waterPercent, forestPercent);
     
     /* Set difficulty level */
@@ -773,6 +809,7 @@ int generateNewCityWithTerrain(char *cityName, int difficulty, int mapType, int
     params.mapType = mapType;
     params.waterPercent = waterPercent;
     params.forestPercent = forestPercent;
+    params.seed = seed; /* The previewed map's, so the city matches it */
     
     if (!generateTerrainMap(&params)) {
         addGameLog("ERROR: Failed to generate terrain map");
@@ -31,6 +31,7 @@
 
 /* Control IDs for Map Generation */
 #define IDC_MAP_ISLAND 10001
+#define IDC_MAP_NOISE 10002
 #define IDC_WATER_PERCENT 10003
 #define IDC_WATER_LABEL 10004
 #define IDC_FOREST_PERCENT 10005
@@ -66,7 +67,8 @@ typedef struct {
     int scenarioId;      /* 1-8 for scenarios, 0 for new city */
     char cityName[64];   /* City name */
     char loadFile[MAX_PATH]; /* File to load (for NEWGAME_LOAD_CITY) */
-    int mapType;         /* Map generation type (rivers/island) */
+    int mapType;         /* Map generation type (rivers/island/noise) */
+    unsigned long mapSeed; /* Seed of the previewed map, 0 if none */
     int waterPercent;    /* Water coverage percentage (0-100) */
     int forestPercent;   /* Forest coverage percentage (0-100) */
     int loadFromInternal; /* 1 for internal resources, 0 for external files */
@@ -88,7 +90,8 @@ int loadScenarioById(int scenarioId);
 
 /* New city generation */
 int generateNewCity(char *cityName, int difficulty);
-int generateNewCityWithTerrain(char *cityName, int difficulty, int mapType, int waterPercent, int forestPercent);
+int generateNewCityWithTerrain(char *cityName, int difficulty, int mapType, int waterPercent, int forestPercent,
+                               unsigned long seed);
 
 /* City loading */
 int loadCityFile(char *filename);
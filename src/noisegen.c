@@ -0,0 +1,355 @@
+/* noisegen.c - Seedable noise terrain generator for WiNTown
+ * Height and moisture come from multi-octave value noise hashed from the
+ * seed and tile position, so any block of the map can be filled on its own.
+ * Lakes and forests are thresholds on those fields, rivers follow the
+ * downhill flow accumulated across the height field.
+ */
+
+#include "noisegen.h"
+#include <windows.h>
+#include <stdlib.h>
+
+/* External functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Raw output tiles (see sim.h) */
+#define NG_DIRT   0
+#define NG_RIVER  2
+#define NG_REDGE  3
+#define NG_WOODS  37
+
+#define NG_DEFAULT_OCTAVES 5
+#define NG_MAX_THREADS     8
+#define NG_FEATURE_SIZE    32.0f  /* Tiles across the coarsest octave */
+#define NG_RIVER_ACCUM     300    /* Tiles drained before a river shows */
+#define NG_LEVELS          1024   /* Quantisation for thresholds and sorting */
+
+/* Noise fill work for one band of rows */
+typedef struct {
+    unsigned long seed;
+    int octaves;
+    int width, height;
+    float scaleX, scaleY;   /* World tiles per output cell */
+    float *heightMap;
+    float *moistMap;
+    int y0, y1;
+} NoiseBand;
+
+/* Integer hash of a lattice point */
+static unsigned long latticeHash(unsigned long seed, long x, long y) {
+    unsigned long h;
+
+    h = (seed ^ ((unsigned long)x * 374761393UL) ^ ((unsigned long)y * 668265263UL)) & 0xffffffffUL;
+    h = ((h ^ (h >> 13)) * 1274126177UL) & 0xffffffffUL;
+    return h ^ (h >> 16);
+}
+
+/* Value noise in [0,1) with smoothed bilinear interpolation */
+static float valueNoise(unsigned long seed, float x, float y) {
+    long xi, yi;
+    float fx, fy, v00, v10, v01, v11, a, b;
+
+    xi = (long)x;
+    yi = (long)y;
+    fx = x - (float)xi;
+    fy = y - (float)yi;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fy = fy * fy * (3.0f - 2.0f * fy);
+
+    v00 = (float)(latticeHash(seed, xi, yi) & 0xffff) / 65536.0f;
+    v10 = (float)(latticeHash(seed, xi + 1, yi) & 0xffff) / 65536.0f;
+    v01 = (float)(latticeHash(seed, xi, yi + 1) & 0xffff) / 65536.0f;
+    v11 = (float)(latticeHash(seed, xi + 1, yi + 1) & 0xffff) / 65536.0f;
+
+    a = v00 + (v10 - v00) * fx;
+    b = v01 + (v11 - v01) * fx;
+    return a + (b - a) * fy;
+}
+
+/* Sum of octaves, normalised to [0,1) */
+static float fractalNoise(unsigned long seed, int octaves, float x, float y) {
+    float sum, amp, norm, freq;
+    int o;
+
+    sum = 0.0f;
+    norm = 0.0f;
+    amp = 1.0f;
+    freq = 1.0f / NG_FEATURE_SIZE;
+    for (o = 0; o < octaves; o++) {
+        sum += valueNoise(seed + (unsigned long)o * 7919UL, x * freq, y * freq) * amp;
+        norm += amp;
+        amp *= 0.5f;
+        freq *= 2.0f;
+    }
+    return sum / norm;
+}
+
+/* Fill height and moisture for one band of rows (no CRT calls - may run on a worker) */
+static void fillNoiseBand(NoiseBand *band) {
+    int x, y, i;
+    float wx, wy;
+
+    for (y = band->y0; y < band->y1; y++) {
+        for (x = 0; x < band->width; x++) {
+            i = y * band->width + x;
+            wx = ((float)x + 0.5f) * band->scaleX;
+            wy = ((float)y + 0.5f) * band->scaleY;
+            band->heightMap[i] = fractalNoise(band->seed, band->octaves, wx, wy);
+            band->moistMap[i] = fractalNoise(band->seed ^ 0x5bd1e995UL, band->octaves, wx, wy);
+        }
+    }
+}
+
+static DWORD WINAPI noiseBandThread(LPVOID param) {
+    fillNoiseBand((NoiseBand *)param);
+    return 0;
+}
+
+/* Fill the noise fields in row bands, one worker thread per band */
+static void fillNoiseFields(NoiseBand *proto, int threads) {
+    NoiseBand bands[NG_MAX_THREADS];
+    HANDLE handles[NG_MAX_THREADS];
+    DWORD threadId;
+    int i;
+
+    if (threads > NG_MAX_THREADS) {
+        threads = NG_MAX_THREADS;
+    }
+    if (threads < 1 || proto->height < threads * 8) {
+        threads = 1;
+    }
+
+    for (i = 0; i < threads; i++) {
+        bands[i] = *proto;
+        bands[i].y0 = (proto->height * i) / threads;
+        bands[i].y1 = (proto->height * (i + 1)) / threads;
+        handles[i] = NULL;
+        if (i > 0) {
+            handles[i] = CreateThread(NULL, 0, noiseBandThread, &bands[i], 0, &threadId);
+        }
+    }
+
+    /* The calling thread takes the first band and any band a worker could not */
+    fillNoiseBand(&bands[0]);
+    for (i = 1; i < threads; i++) {
+        if (!handles[i]) {
+            fillNoiseBand(&bands[i]);
+        }
+    }
+
+    for (i = 1; i < threads; i++) {
+        if (handles[i]) {
+            WaitForSingleObject(handles[i], INFINITE);
+            CloseHandle(handles[i]);
+        }
+    }
+}
+
+/* Value below which the given percentage of cells fall */
+static float percentileOf(float *values, int count, int percent, int *hist) {
+    int i, level, target, seen;
+
+    if (percent <= 0) {
+        return -1.0f;
+    }
+    if (percent >= 100) {
+        return 2.0f;
+    }
+
+    for (i = 0; i < NG_LEVELS; i++) {
+        hist[i] = 0;
+    }
+    for (i = 0; i < count; i++) {
+        hist[(int)(values[i] * NG_LEVELS) & (NG_LEVELS - 1)]++;
+    }
+
+    target = (count * percent) / 100;
+    seen = 0;
+    for (level = 0; level < NG_LEVELS; level++) {
+        seen += hist[level];
+        if (seen >= target) {
+            break;
+        }
+    }
+    return (float)(level + 1) / (float)NG_LEVELS;
+}
+
+/* Shared generator - fills width x height cells covering worldW x worldH tiles */
+static int buildNoiseTerrain(NoiseGenParams *params, short *tiles, int width, int height,
+                             int worldW, int worldH) {
+    NoiseBand band;
+    float *heightMap, *moistMap;
+    int *hist, *order, *accum, *down;
+    int count, i, x, y, dx, dy, n, lowest, level, riverCells;
+    float lakeLevel, forestLevel, cellArea, lowestH;
+    unsigned char *water;
+
+    if (!params || !tiles || width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    count = width * height;
+    heightMap = (float *)malloc(count * sizeof(float));
+    moistMap = (float *)malloc(count * sizeof(float));
+    order = (int *)malloc(count * sizeof(int));
+    accum = (int *)malloc(count * sizeof(int));
+    down = (int *)malloc(count * sizeof(int));
+    water = (unsigned char *)malloc(count);
+    hist = (int *)malloc((NG_LEVELS + 1) * sizeof(int));
+    if (!heightMap || !moistMap || !order || !accum || !down || !water || !hist) {
+        free(heightMap);
+        free(moistMap);
+        free(order);
+        free(accum);
+        free(down);
+        free(water);
+        free(hist);
+        return 0;
+    }
+
+    /* Noise fields, filled in parallel row bands */
+    band.seed = params->seed;
+    band.octaves = params->octaves > 0 ? params->octaves : NG_DEFAULT_OCTAVES;
+    band.width = width;
+    band.height = height;
+    band.scaleX = (float)worldW / (float)width;
+    band.scaleY = (float)worldH / (float)height;
+    band.heightMap = heightMap;
+    band.moistMap = moistMap;
+    band.y0 = 0;
+    band.y1 = height;
+    fillNoiseFields(&band, params->threads);
+
+    /* Lakes take three quarters of the water budget, rivers the rest */
+    lakeLevel = percentileOf(heightMap, count, (params->waterPercent * 3) / 4, hist);
+    for (i = 0; i < count; i++) {
+        water[i] = (heightMap[i] < lakeLevel);
+    }
+
+    /* Steepest downhill neighbour of every cell */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            i = y * width + x;
+            lowest = -1;
+            lowestH = heightMap[i];
+            for (dy = -1; dy <= 1; dy++) {
+                for (dx = -1; dx <= 1; dx++) {
+                    if ((dx || dy) && x + dx >= 0 && x + dx < width && y + dy >= 0 && y + dy < height) {
+                        n = i + dy * width + dx;
+                        if (heightMap[n] < lowestH) {
+                            lowestH = heightMap[n];
+                            lowest = n;
+                        }
+                    }
+                }
+            }
+            down[i] = lowest;
+        }
+    }
+
+    /* Counting sort from highest to lowest, then push flow downhill */
+    for (level = 0; level <= NG_LEVELS; level++) {
+        hist[level] = 0;
+    }
+    for (i = 0; i < count; i++) {
+        hist[NG_LEVELS - 1 - ((int)(heightMap[i] * NG_LEVELS) & (NG_LEVELS - 1))]++;
+    }
+    for (level = 0, n = 0; level < NG_LEVELS; level++) {
+        x = hist[level];
+        hist[level] = n;
+        n += x;
+    }
+    for (i = 0; i < count; i++) {
+        order[hist[NG_LEVELS - 1 - ((int)(heightMap[i] * NG_LEVELS) & (NG_LEVELS - 1))]++] = i;
+    }
+    for (i = 0; i < count; i++) {
+        accum[i] = 1;
+    }
+    for (i = 0; i < count; i++) {
+        n = order[i];
+        if (down[n] >= 0) {
+            accum[down[n]] += accum[n];
+        }
+    }
+
+    /* Rivers where enough land drains through, widened on the big ones */
+    cellArea = band.scaleX * band.scaleY;
+    riverCells = 0;
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            i = y * width + x;
+            if (water[i] & 1 || (float)accum[i] * cellArea < NG_RIVER_ACCUM) {
+                continue;
+            }
+            water[i] |= 2;
+            riverCells++;
+            if ((float)accum[i] * cellArea >= NG_RIVER_ACCUM * 4) {
+                if (x + 1 < width) {
+                    water[i + 1] |= 2;
+                }
+                if (y + 1 < height) {
+                    water[i + width] |= 2;
+                }
+            }
+        }
+    }
+
+    /* Forest on the wettest share of the remaining land. Land moisture is
+     * packed to the front of moistMap with its cell index kept in order[]. */
+    n = 0;
+    for (i = 0; i < count; i++) {
+        if (!water[i]) {
+            moistMap[n] = moistMap[i];
+            order[n++] = i;
+        }
+    }
+    forestLevel = percentileOf(moistMap, n, 100 - params->forestPercent, hist);
+
+    for (i = 0; i < count; i++) {
+        tiles[i] = NG_DIRT;
+    }
+    for (i = 0; i < n; i++) {
+        if (moistMap[i] >= forestLevel) {
+            tiles[order[i]] = NG_WOODS;
+        }
+    }
+
+    /* Water cells touching land become edges for the caller to smooth */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            i = y * width + x;
+            if (!water[i]) {
+                continue;
+            }
+            if ((x > 0 && !water[i - 1]) || (x + 1 < width && !water[i + 1]) ||
+                (y > 0 && !water[i - width]) || (y + 1 < height && !water[i + width])) {
+                tiles[i] = NG_REDGE;
+            } else {
+                tiles[i] = NG_RIVER;
+            }
+        }
+    }
+
+    addDebugLog("Noise terrain %dx%d seed %lu: lake level %d/1024, %d river cells",
+                width, height, params->seed, (int)(lakeLevel * NG_LEVELS), riverCells);
+
+    free(heightMap);
+    free(moistMap);
+    free(order);
+    free(accum);
+    free(down);
+    free(water);
+    free(hist);
+    return 1;
+}
+
+/* Generate a full resolution map */
+int generateNoiseTerrain(NoiseGenParams *params, short *tiles, int width, int height) {
+    return buildNoiseTerrain(params, tiles, width, height, width, height);
+}
+
+/* Generate a reduced resolution thumbnail of a worldWidth x worldHeight map */
+int generateNoisePreview(NoiseGenParams *params, short *tiles, int width, int height,
+                         int worldWidth, int worldHeight) {
+    return buildNoiseTerrain(params, tiles, width, height, worldWidth, worldHeight);
+}
@@ -0,0 +1,24 @@
+/* noisegen.h - Seedable noise terrain generator for WiNTown */
+
+#ifndef NOISEGEN_H
+#define NOISEGEN_H
+
+/* Noise generator parameters */
+typedef struct {
+    unsigned long seed;  /* Same seed and settings always give the same map */
+    int waterPercent;    /* Share of tiles under lakes and rivers (0-100) */
+    int forestPercent;   /* Share of land covered by forest (0-100) */
+    int octaves;         /* Noise octaves, 0 for the default */
+    int threads;         /* Worker threads for the noise fill, 1 runs inline */
+} NoiseGenParams;
+
+/* Raw tiles produced: DIRT, RIVER, REDGE (water next to land) and WOODS.
+ * Edge smoothing is left to the caller. */
+int generateNoiseTerrain(NoiseGenParams *params, short *tiles, int width, int height);
+
+/* Same terrain sampled at a lower resolution, for thumbnails.
+ * worldWidth/worldHeight give the size of the full map being previewed. */
+int generateNoisePreview(NoiseGenParams *params, short *tiles, int width, int height,
+                         int worldWidth, int worldHeight);
+
+#endif /* NOISEGEN_H */
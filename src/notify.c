@@ -4,6 +4,7 @@
 
 #include "notify.h"
 #include "sim.h"
+#include "events.h"
 #include <stdio.h>
 #include <string.h>
 #include <windows.h>
@@ -13,13 +14,6 @@ extern HWND hwndMain;
 extern void addGameLog(const char *format, ...);
 extern void addDebugLog(const char *format, ...);
 
-/* Message system variables - like original WiNTown */
-int MessagePort = 0;
-int MesX = 0, MesY = 0;
-int MesNum = 0;
-int LastPicNum = 0;
-DWORD LastMesTime = 0;
-
 /* External simulation variables */
 extern int CityTime;
 extern int TotalZPop, ResZPop, ComZPop, IndZPop;
@@ -32,12 +26,27 @@ extern int TaxRate, RoadEffect, FireEffect, PoliceEffect, TrafficAverage;
 extern int ScenarioID, ScoreType, ScoreWait;
 extern int ResCap, IndCap, ComCap;
 
+/* Original message numbers mapped to notification ids */
+static const int MesNotifTable[40] = {
+    0,                           NOTIF_RESIDENTIAL_NEEDED,   NOTIF_COMMERCIAL_NEEDED,
+    NOTIF_INDUSTRIAL_NEEDED,     NOTIF_MORE_ROADS_NEEDED,    NOTIF_RAIL_SYSTEM_NEEDED,
+    NOTIF_POWER_PLANT_NEEDED,    NOTIF_STADIUM_NEEDED,       NOTIF_SEAPORT_NEEDED,
+    NOTIF_AIRPORT_NEEDED,        NOTIF_HIGH_POLLUTION,       NOTIF_HIGH_CRIME,
+    NOTIF_TRAFFIC_JAMS,          NOTIF_FIRE_DEPT_NEEDED,     NOTIF_POLICE_NEEDED,
+    NOTIF_BLACKOUTS,             NOTIF_TAX_TOO_HIGH,         NOTIF_ROADS_DETERIORATING,
+    NOTIF_FIRE_DEPT_UNDERFUNDED, NOTIF_POLICE_UNDERFUNDED,   NOTIF_FIRE_REPORTED,
+    NOTIF_MONSTER_SIGHTED,       NOTIF_EARTHQUAKE,           NOTIF_TORNADO,
+    NOTIF_FLOODING,              NOTIF_NUCLEAR_MELTDOWN,     NOTIF_PLANE_CRASHED,
+    NOTIF_TRAIN_CRASHED,         NOTIF_SHIP_CRASHED,         NOTIF_HELICOPTER_CRASHED,
+    NOTIF_FIRE_SPREADING,        0,                          0,
+    0,                           0,                          NOTIF_VILLAGE_2K,
+    NOTIF_TOWN_10K,              NOTIF_CITY_50K,             NOTIF_CAPITAL_100K,
+    NOTIF_METROPOLIS_500K};
+
 /* Forward declarations */
-int SendMes(int Mnum);
-void SendMesAt(int Mnum, int x, int y);
 void CheckGrowth(void);
 void DoScenarioScore(void);
-void ClearMes(void);
+static void NotifyEventHandler(const SimEvent *event, void *userData);
 
 /* Original SendMessages function - called every simulation cycle */
 void SendMessages(void) {
@@ -177,220 +186,151 @@ void CheckGrowth(void) {
     }
 }
 
-/* Original SendMes function - CRITICAL anti-spam logic */
+/* Publish an original message number - repeats are merged by the event bus */
 int SendMes(int Mnum) {
     if (Mnum < 0) {
-        /* Picture message (disaster) - only if different from last */
-        if (Mnum != LastPicNum) {
-            MessagePort = Mnum;
-            MesX = 0;
-            MesY = 0;
-            LastPicNum = Mnum;
-            addDebugLog("SendMes: Picture message %d allowed (different from last %d)", Mnum, LastPicNum);
-            return 1;
-        } else {
-            addDebugLog("SendMes: Picture message %d BLOCKED - same as last", Mnum);
-            return 0;
-        }
-    } else {
-        /* Text message - only if no active message */
-        if (!MessagePort) {
-            MessagePort = Mnum;
-            MesX = 0;
-            MesY = 0;
-            addDebugLog("SendMes: Text message %d allowed", Mnum);
-            return 1;
-        } else {
-            addDebugLog("SendMes: Text message %d BLOCKED - active message %d", Mnum, MessagePort);
-            return 0;
-        }
+        Mnum = -Mnum;
+    }
+    if (Mnum >= 40 || !MesNotifTable[Mnum]) {
+        addDebugLog("SendMes: Unknown message %d", Mnum);
+        return 0;
     }
+    return PublishEvent(MesNotifTable[Mnum], GetNotificationType(MesNotifTable[Mnum]), -1, -1);
 }
 
 /* Original SendMesAt function - for disaster locations */
 void SendMesAt(int Mnum, int x, int y) {
-    if (SendMes(Mnum)) {
-        MesX = x;
-        MesY = y;
-        addDebugLog("SendMesAt: Message %d at (%d,%d)", Mnum, x, y);
+    if (Mnum < 0) {
+        Mnum = -Mnum;
+    }
+    if (Mnum >= 40 || !MesNotifTable[Mnum]) {
+        addDebugLog("SendMesAt: Unknown message %d", Mnum);
+        return;
     }
+    PublishEvent(MesNotifTable[Mnum], GetNotificationType(MesNotifTable[Mnum]), x, y);
 }
 
 /* Clear message system */
 void ClearMes(void) {
-    MessagePort = 0;
-    MesX = 0;
-    MesY = 0;
-    LastPicNum = 0;
+    ResetEvents();
     addDebugLog("ClearMes: Message system cleared");
 }
 
-/* Process active message */
-void doMessage(void) {
-    char messageStr[256];
-    int firstTime;
-
-    messageStr[0] = 0;
-
-    if (MessagePort) {
-        MesNum = MessagePort;
-        MessagePort = 0;
-        LastMesTime = GetTickCount();
-        firstTime = 1;
-        addDebugLog("doMessage: Processing message %d", MesNum);
-    } else {
-        firstTime = 0;
-        if (MesNum == 0) return;
-        if (MesNum < 0) {
-            MesNum = -MesNum;
-            LastMesTime = GetTickCount();
-        } else if ((GetTickCount() - LastMesTime) > (60 * 1000)) { /* 60 seconds timeout */
-            MesNum = 0;
-            addDebugLog("doMessage: Message timed out");
-            return;
-        }
+/* Icon and sound class for a notification id */
+NotificationType GetNotificationType(int notificationId) {
+    if (notificationId >= 1000 && notificationId < 2000) {
+        return NOTIF_EMERGENCY;
     }
+    if (notificationId >= 6000 && notificationId < 7000) {
+        return NOTIF_FINANCIAL;
+    }
+    if (notificationId >= 7000 && notificationId < 8000) {
+        return NOTIF_MILESTONE;
+    }
+    if (notificationId >= 2000 && notificationId < 6000) {
+        return NOTIF_WARNING;
+    }
+    return NOTIF_INFO;
+}
 
-    if (MesNum >= 0) {
-        if (MesNum == 0) return;
-        if (MesNum > 60) {
-            MesNum = 0;
-            return;
-        }
-
-        /* Get message text */
-        switch(MesNum) {
-            case 1: strcpy(messageStr, "More residential zones needed."); break;
-            case 2: strcpy(messageStr, "More commercial zones needed."); break;
-            case 3: strcpy(messageStr, "More industrial zones needed."); break;
-            case 4: strcpy(messageStr, "More roads required."); break;
-            case 5: strcpy(messageStr, "More rail system needed."); break;
-            case 6: strcpy(messageStr, "More power needed."); break;
-            case 7: strcpy(messageStr, "Residents demand a stadium."); break;
-            case 8: strcpy(messageStr, "Industry requires a seaport."); break;
-            case 9: strcpy(messageStr, "Commerce requires an airport."); break;
-            case 10: strcpy(messageStr, "Pollution very high."); break;
-            case 11: strcpy(messageStr, "Crime very high."); break;
-            case 12: strcpy(messageStr, "Traffic very heavy."); break;
-            case 13: strcpy(messageStr, "Fire protection needed."); break;
-            case 14: strcpy(messageStr, "Police protection needed."); break;
-            case 15: strcpy(messageStr, "Blackouts reported. More power needed."); break;
-            case 16: strcpy(messageStr, "Tax rate too high."); break;
-            case 17: strcpy(messageStr, "Roads deteriorating rapidly."); break;
-            case 18: strcpy(messageStr, "Fire departments need funding."); break;
-            case 19: strcpy(messageStr, "Police departments need funding."); break;
-            case 20: strcpy(messageStr, "Fire reported!"); break;
-            case 21: strcpy(messageStr, "Monster attack!"); break;
-            case 22: strcpy(messageStr, "Earthquake!"); break;
-            case 23: strcpy(messageStr, "Tornado!"); break;
-            case 24: strcpy(messageStr, "Flooding!"); break;
-            case 25: strcpy(messageStr, "Nuclear meltdown!"); break;
-            case 26: strcpy(messageStr, "Airplane crashed!"); break;
-            case 27: strcpy(messageStr, "Train crashed!"); break;
-            case 28: strcpy(messageStr, "Ship crashed!"); break;
-            case 29: strcpy(messageStr, "Helicopter crashed!"); break;
-            case 30: strcpy(messageStr, "Major fire spreading!"); break;
-            case 35: strcpy(messageStr, "Population reached 2,000! Your village has become a town."); break;
-            case 36: strcpy(messageStr, "Population reached 10,000! Your town has become a city."); break;
-            case 37: strcpy(messageStr, "Population reached 50,000! Your city has become a capital."); break;
-            case 38: strcpy(messageStr, "Population reached 100,000! Your capital has become a metropolis."); break;
-            case 39: strcpy(messageStr, "Population reached 500,000! Your metropolis has become a megalopolis."); break;
-            default: sprintf(messageStr, "City Message %d", MesNum); break;
-        }
+/* Short message text for a notification id */
+const char *GetNotificationMessage(int notificationId) {
+    switch (notificationId) {
+    case NOTIF_RESIDENTIAL_NEEDED: return "More residential zones needed.";
+    case NOTIF_COMMERCIAL_NEEDED: return "More commercial zones needed.";
+    case NOTIF_INDUSTRIAL_NEEDED: return "More industrial zones needed.";
+    case NOTIF_MORE_ROADS_NEEDED: return "More roads required.";
+    case NOTIF_RAIL_SYSTEM_NEEDED: return "More rail system needed.";
+    case NOTIF_POWER_PLANT_NEEDED: return "More power needed.";
+    case NOTIF_STADIUM_NEEDED: return "Residents demand a stadium.";
+    case NOTIF_SEAPORT_NEEDED: return "Industry requires a seaport.";
+    case NOTIF_AIRPORT_NEEDED: return "Commerce requires an airport.";
+    case NOTIF_HIGH_POLLUTION: return "Pollution very high.";
+    case NOTIF_HIGH_CRIME: return "Crime very high.";
+    case NOTIF_TRAFFIC_JAMS: return "Traffic very heavy.";
+    case NOTIF_FIRE_DEPT_NEEDED: return "Fire protection needed.";
+    case NOTIF_POLICE_NEEDED: return "Police protection needed.";
+    case NOTIF_BLACKOUTS: return "Blackouts reported. More power needed.";
+    case NOTIF_BROWNOUTS: return "Brownouts reported. Power supply is short.";
+    case NOTIF_TAX_TOO_HIGH: return "Tax rate too high.";
+    case NOTIF_ROADS_DETERIORATING: return "Roads deteriorating rapidly.";
+    case NOTIF_FIRE_DEPT_UNDERFUNDED: return "Fire departments need funding.";
+    case NOTIF_POLICE_UNDERFUNDED: return "Police departments need funding.";
+    case NOTIF_FIRE_REPORTED: return "Fire reported!";
+    case NOTIF_FIRE_SPREADING: return "Major fire spreading!";
+    case NOTIF_MULTIPLE_FIRES: return "Multiple fires reported!";
+    case NOTIF_MONSTER_SIGHTED: return "Monster attack!";
+    case NOTIF_EARTHQUAKE: return "Earthquake!";
+    case NOTIF_TORNADO: return "Tornado!";
+    case NOTIF_FLOODING: return "Flooding!";
+    case NOTIF_NUCLEAR_MELTDOWN: return "Nuclear meltdown!";
+    case NOTIF_PLANE_CRASHED: return "Airplane crashed!";
+    case NOTIF_TRAIN_CRASHED: return "Train crashed!";
+    case NOTIF_SHIP_CRASHED: return "Ship crashed!";
+    case NOTIF_HELICOPTER_CRASHED: return "Helicopter crashed!";
+    case NOTIF_CITY_BROKE: return "The city treasury is empty!";
+    case NOTIF_BUDGET_DEFICIT: return "Not enough funds for the budget.";
+    case NOTIF_VILLAGE_2K: return "Population reached 2,000! Your village has become a town.";
+    case NOTIF_TOWN_10K: return "Population reached 10,000! Your town has become a city.";
+    case NOTIF_CITY_50K: return "Population reached 50,000! Your city has become a capital.";
+    case NOTIF_CAPITAL_100K: return "Population reached 100,000! Your capital has become a metropolis.";
+    case NOTIF_METROPOLIS_500K: return "Population reached 500,000! Your metropolis has become a megalopolis.";
+    default: return "City message.";
+    }
+}
 
-        addGameLog("CITY: %s", messageStr);
+/* Disasters that open a dialog, as in the original game */
+static int IsDisasterNotification(int notificationId) {
+    return notificationId == NOTIF_FIRE_REPORTED || notificationId == NOTIF_MONSTER_SIGHTED ||
+           notificationId == NOTIF_EARTHQUAKE || notificationId == NOTIF_TORNADO ||
+           notificationId == NOTIF_FLOODING || notificationId == NOTIF_NUCLEAR_MELTDOWN;
+}
 
-    } else {
-        /* Picture message (disaster) */
-        int pictId = -(MesNum);
-        
-        switch(pictId) {
-            case 10: strcpy(messageStr, "Pollution very high!"); break;
-            case 11: strcpy(messageStr, "Crime wave spreading!"); break;
-            case 12: strcpy(messageStr, "Traffic jams everywhere!"); break;
-            case 20: strcpy(messageStr, "FIRE REPORTED!"); break;
-            case 21: strcpy(messageStr, "MONSTER ATTACK!"); break;
-            case 22: strcpy(messageStr, "EARTHQUAKE!"); break;
-            case 23: strcpy(messageStr, "TORNADO!"); break;
-            case 24: strcpy(messageStr, "FLOODING!"); break;
-            case 25: strcpy(messageStr, "NUCLEAR MELTDOWN!"); break;
-            case 35: strcpy(messageStr, "Population reached 2,000!"); break;
-            case 36: strcpy(messageStr, "Population reached 10,000!"); break;
-            case 37: strcpy(messageStr, "Population reached 50,000!"); break;
-            case 38: strcpy(messageStr, "Population reached 100,000!"); break;
-            case 39: strcpy(messageStr, "Population reached 500,000!"); break;
-            default: sprintf(messageStr, "Disaster %d", pictId); break;
-        }
+/* Event bus subscriber - formats events for the game log and the disaster dialog.
+ * Runs from DispatchEvents() on the UI thread, never inside the simulation. */
+static void NotifyEventHandler(const SimEvent *event, void *userData) {
+    char messageStr[256];
+    char locStr[64];
 
-        if (MesX > 0 && MesY > 0) {
-            char locStr[64];
-            sprintf(locStr, " at (%d,%d)", MesX, MesY);
-            strcat(messageStr, locStr);
-        }
+    strcpy(messageStr, GetNotificationMessage(event->type));
+    if (event->x >= 0 && event->y >= 0) {
+        sprintf(locStr, " at (%d,%d)", event->x, event->y);
+        strcat(messageStr, locStr);
+    }
+    if (event->count > 1) {
+        sprintf(locStr, " (%d reports)", event->count);
+        strcat(messageStr, locStr);
+    }
 
+    if (event->severity == NOTIF_EMERGENCY) {
         addGameLog("ALERT: %s", messageStr);
-        
-        /* Show dialog for disasters only */
-        if (pictId >= 20 && pictId <= 25) {
-            Notification notif;
-            notif.id = pictId;
-            notif.locationX = MesX;
-            notif.locationY = MesY;
-            notif.hasLocation = (MesX > 0 && MesY > 0) ? 1 : 0;
-            strcpy(notif.message, messageStr);
-            notif.timestamp = GetTickCount();
-            notif.priority = 3;
-            CreateNotificationDialog(&notif);
-        }
+    } else {
+        addGameLog("CITY: %s", messageStr);
+    }
 
-        MessagePort = pictId; /* resend text message */
+    /* Show dialog for disasters only */
+    if (hwndMain && IsDisasterNotification(event->type)) {
+        Notification notif;
+        notif.id = event->type;
+        notif.type = (NotificationType)event->severity;
+        notif.locationX = event->x;
+        notif.locationY = event->y;
+        notif.hasLocation = (event->x >= 0 && event->y >= 0) ? 1 : 0;
+        strcpy(notif.message, messageStr);
+        notif.timestamp = GetTickCount();
+        notif.priority = 3;
+        CreateNotificationDialog(&notif);
     }
 }
 
-/* Replace old notification functions with new SendMes equivalents */
+/* Publish a notification without a location */
 void ShowNotification(int notificationId, ...) {
-    /* Map new IDs to original message numbers */
-    switch(notificationId) {
-        case NOTIF_EARTHQUAKE:
-            SendMes(-22);
-            break;
-        case NOTIF_FIRE_REPORTED:
-            SendMes(-20);
-            break;
-        case NOTIF_MONSTER_SIGHTED:
-            SendMes(-21);
-            break;
-        default:
-            addDebugLog("ShowNotification: Unknown ID %d", notificationId);
-            break;
-    }
+    PublishEvent(notificationId, GetNotificationType(notificationId), -1, -1);
 }
 
+/* Publish a notification at a map location */
 void ShowNotificationAt(int notificationId, int x, int y, ...) {
-    /* Map new IDs to original message numbers */
-    switch(notificationId) {
-        case NOTIF_EARTHQUAKE:
-            SendMesAt(-22, x, y);
-            break;
-        case NOTIF_FIRE_REPORTED:
-            SendMesAt(-20, x, y);
-            break;
-        case NOTIF_MONSTER_SIGHTED:
-            SendMesAt(-21, x, y);
-            break;
-        case NOTIF_TORNADO:
-            SendMesAt(-23, x, y);
-            break;
-        case NOTIF_FLOODING:
-            SendMesAt(-24, x, y);
-            break;
-        case NOTIF_NUCLEAR_MELTDOWN:
-            SendMesAt(-25, x, y);
-            break;
-        default:
-            addDebugLog("ShowNotificationAt: Unknown ID %d", notificationId);
-            break;
-    }
+    PublishEvent(notificationId, GetNotificationType(notificationId), x, y);
 }
 
 /* DoScenarioScore is defined in scenario.c */
@@ -423,17 +363,17 @@ BOOL CALLBACK NotificationDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM
             if (!notif) return FALSE;
             
             switch (notif->id) {
-                case 22: /* EARTHQUAKE */
+                case NOTIF_EARTHQUAKE:
                     strcpy(titleText, "EARTHQUAKE DISASTER");
                     strcpy(explanationText, "A major earthquake has struck your city! Buildings have been damaged and infrastructure may be compromised.");
                     strcpy(adviceText, "Rebuild damaged areas quickly. Consider earthquake-resistant construction for the future.");
                     break;
-                case 20: /* FIRE */
+                case NOTIF_FIRE_REPORTED:
                     strcpy(titleText, "FIRE EMERGENCY");
                     strcpy(explanationText, "A serious fire has broken out in your city! Fire departments are responding to the emergency.");
                     strcpy(adviceText, "Ensure adequate fire station coverage. Consider fireproof building materials in high-risk areas.");
                     break;
-                case 21: /* MONSTER */
+                case NOTIF_MONSTER_SIGHTED:
                     strcpy(titleText, "MONSTER ATTACK");
                     strcpy(explanationText, "A giant monster has appeared in your city! It is causing massive destruction as it moves through the area.");
                     strcpy(adviceText, "The monster will eventually leave on its own. Focus on rebuilding damaged areas afterward.");
@@ -488,5 +428,6 @@ void CenterMapOnLocation(int x, int y) {
 /* Initialize notification system */
 void InitNotificationSystem(void) {
     ClearMes();
+    SubscribeEvents(NotifyEventHandler, NULL);
     addDebugLog("Notification system initialized with original WiNTown logic");
 }
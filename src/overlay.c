@@ -0,0 +1,301 @@
+/* overlay.c - Density overlays for the city view in WiNTown
+ * The layer is drawn into a cached frame of packed alpha and colour, one
+ * pixel per screen pixel, either with each map cell as a block like the
+ * original overlays or blended between cell centres. The cache is kept
+ * until the map behind it, the view or the layer changes. Blending works
+ * on two colour channels per multiply so it needs nothing beyond 32-bit
+ * integer arithmetic on any of the NT processors.
+ */
+
+#include "sim.h"
+#include "overlay.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Highest alpha of a ramp, out of 255 */
+#define OVERLAY_MAX_ALPHA 160
+
+/* A layer's map and its ramp - colours and alpha at 0, 128 and 255 */
+typedef struct {
+    const char *name;
+    int shift; /* Tiles per map cell, as a shift */
+    Byte colour[3][3];
+    Byte alpha[3];
+} OverlayLayer;
+
+static const OverlayLayer Layers[OVERLAY_COUNT] = {
+    {"None", 0, {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}}, {0, 0, 0}},
+    {"Population", 1, {{64, 0, 64}, {192, 0, 192}, {255, 64, 255}}, {0, 96, OVERLAY_MAX_ALPHA}},
+    {"Traffic", 1, {{0, 255, 128}, {255, 255, 0}, {255, 0, 0}}, {0, 112, OVERLAY_MAX_ALPHA}},
+    {"Pollution", 1, {{0, 255, 128}, {255, 255, 0}, {255, 0, 0}}, {0, 112, OVERLAY_MAX_ALPHA}},
+    {"Crime", 1, {{255, 255, 0}, {255, 128, 0}, {255, 0, 0}}, {0, 112, OVERLAY_MAX_ALPHA}},
+    {"Land Value", 1, {{255, 255, 192}, {128, 255, 128}, {0, 255, 0}}, {0, 96, OVERLAY_MAX_ALPHA}},
+    {"Fire Coverage", 2, {{255, 224, 224}, {255, 128, 128}, {255, 0, 0}}, {0, 96, OVERLAY_MAX_ALPHA}},
+    {"Police Coverage", 2, {{224, 224, 255}, {128, 128, 255}, {0, 0, 255}}, {0, 96, OVERLAY_MAX_ALPHA}}
+};
+
+static int Layer = OVERLAY_NONE;
+static int Smooth = 0;
+
+/* Alpha in the top byte, colour below */
+static OverlayPixel Ramp[256];
+
+/* The cached layer and what it was drawn from */
+static OverlayPixel *Cache = NULL;
+static int CacheSize = 0;
+static int CacheColumns = 0;
+static int CacheValid = 0;
+static int CacheWidth, CacheHeight, CacheLeft, CacheTop, CacheTile;
+static Byte CacheMap[WORLD_Y / 2][WORLD_X / 2];
+
+/* Per column of the cache - the cells to either side and the weight of
+   the right one, or -1 past the edge of the map */
+static short *ColLeft = NULL;
+static short *ColRight = NULL;
+static Byte *ColWeight = NULL;
+
+static const Byte *LayerMap(int layer) {
+    switch (layer) {
+    case OVERLAY_POPULATION: return &PopDensity[0][0];
+    case OVERLAY_TRAFFIC: return &TrfDensity[0][0];
+    case OVERLAY_POLLUTION: return &PollutionMem[0][0];
+    case OVERLAY_CRIME: return &CrimeMem[0][0];
+    case OVERLAY_LANDVALUE: return &LandValueMem[0][0];
+    case OVERLAY_FIRE: return &FireRate[0][0];
+    case OVERLAY_POLICE: return &PoliceMapEffect[0][0];
+    }
+    return NULL;
+}
+
+static int Mix(int a, int b, int t) {
+    return a + (b - a) * t / 128;
+}
+
+static void BuildRamp(void) {
+    const OverlayLayer *l;
+    int v, lo, t, c, alpha;
+    OverlayPixel colour;
+
+    l = &Layers[Layer];
+    Ramp[0] = 0;
+    for (v = 1; v < 256; v++) {
+        lo = v < 128 ? 0 : 1;
+        t = v < 128 ? v : v - 128;
+        if (v == 255) {
+            t = 128;
+        }
+        colour = 0;
+        for (c = 0; c < 3; c++) {
+            colour = (colour << 8) | (OverlayPixel)Mix(l->colour[lo][c], l->colour[lo + 1][c], t);
+        }
+        alpha = Mix(l->alpha[lo], l->alpha[lo + 1], t);
+        Ramp[v] = ((OverlayPixel)alpha << 24) | colour;
+    }
+}
+
+void SetOverlayLayer(int layer) {
+    if (layer < 0 || layer >= OVERLAY_COUNT) {
+        layer = OVERLAY_NONE;
+    }
+    Layer = layer;
+    CacheValid = 0;
+    BuildRamp();
+    addDebugLog("Overlay: %s", Layers[Layer].name);
+}
+
+int GetOverlayLayer(void) {
+    return Layer;
+}
+
+const char *GetOverlayName(int layer) {
+    if (layer < 0 || layer >= OVERLAY_COUNT) {
+        return Layers[OVERLAY_NONE].name;
+    }
+    return Layers[layer].name;
+}
+
+void SetOverlaySmooth(int smooth) {
+    Smooth = smooth ? 1 : 0;
+    CacheValid = 0;
+}
+
+int GetOverlaySmooth(void) {
+    return Smooth;
+}
+
+void FreeOverlay(void) {
+    free(Cache);
+    free(ColLeft);
+    free(ColRight);
+    free(ColWeight);
+    Cache = NULL;
+    ColLeft = NULL;
+    ColRight = NULL;
+    ColWeight = NULL;
+    CacheSize = 0;
+    CacheColumns = 0;
+    CacheValid = 0;
+}
+
+/* Grow the cache to hold a frame */
+static int ReserveCache(int width, int height) {
+    if (width * height <= CacheSize && width <= CacheColumns) {
+        return 1;
+    }
+    FreeOverlay();
+    CacheSize = width * height;
+    CacheColumns = width;
+    Cache = (OverlayPixel *)malloc(CacheSize * sizeof(OverlayPixel));
+    ColLeft = (short *)malloc(width * sizeof(short));
+    ColRight = (short *)malloc(width * sizeof(short));
+    ColWeight = (Byte *)malloc(width);
+    if (!Cache || !ColLeft || !ColRight || !ColWeight) {
+        addDebugLog("Overlay: out of memory for a %dx%d layer", width, height);
+        FreeOverlay();
+        return 0;
+    }
+    return 1;
+}
+
+/* Where pixel p falls between cell centres - the cell to either side and
+   the weight of the far one out of 256. Blocks weigh only the near one. */
+static void Sample(int p, int cell, int cells, short *lo, short *hi, Byte *weight) {
+    int u;
+
+    if (p < 0 || p >= cell * cells) {
+        *lo = -1;
+        *hi = -1;
+        *weight = 0;
+        return;
+    }
+    if (!Smooth) {
+        *lo = (short)(p / cell);
+        *hi = *lo;
+        *weight = 0;
+        return;
+    }
+
+    /* Eighth bit fixed point, from the centre of the first cell */
+    u = ((p * 2 + 1) * 128) / cell - 128;
+    if (u < 0) {
+        u = 0;
+    }
+    *lo = (short)(u >> 8);
+    *hi = (short)(*lo + 1 < cells ? *lo + 1 : *lo);
+    *weight = (Byte)(u & 255);
+}
+
+static void Rasterise(const Byte *map, int width, int height, int left, int top, int tileSize) {
+    OverlayPixel *out;
+    const Byte *row0, *row1;
+    int shift, cell, cellsX, cellsY, i, j, fx, fy, value;
+    short r0, r1;
+    Byte wy;
+
+    shift = Layers[Layer].shift;
+    cell = tileSize << shift;
+    cellsX = WORLD_X >> shift;
+    cellsY = WORLD_Y >> shift;
+
+    for (i = 0; i < width; i++) {
+        Sample(left + i, cell, cellsX, &ColLeft[i], &ColRight[i], &ColWeight[i]);
+    }
+
+    for (j = 0; j < height; j++) {
+        out = Cache + j * width;
+        Sample(top + j, cell, cellsY, &r0, &r1, &wy);
+        if (r0 < 0) {
+            memset(out, 0, width * sizeof(OverlayPixel));
+            continue;
+        }
+        row0 = map + r0 * cellsX;
+        row1 = map + r1 * cellsX;
+        fy = wy;
+        for (i = 0; i < width; i++) {
+            if (ColLeft[i] < 0) {
+                out[i] = 0;
+                continue;
+            }
+            fx = ColWeight[i];
+            if (!Smooth) {
+                value = row0[ColLeft[i]];
+            } else {
+                value = ((row0[ColLeft[i]] * (256 - fx) + row0[ColRight[i]] * fx) * (256 - fy) +
+                         (row1[ColLeft[i]] * (256 - fx) + row1[ColRight[i]] * fx) * fy) >> 16;
+            }
+            out[i] = Ramp[value];
+        }
+    }
+
+    /* Remember what the cache shows */
+    for (j = 0; j < cellsY; j++) {
+        memcpy(CacheMap[j], map + j * cellsX, cellsX);
+    }
+    CacheWidth = width;
+    CacheHeight = height;
+    CacheLeft = left;
+    CacheTop = top;
+    CacheTile = tileSize;
+    CacheValid = 1;
+}
+
+/* Is the cache still a picture of the map */
+static int CacheCurrent(const Byte *map, int width, int height, int left, int top, int tileSize) {
+    int shift, cellsX, j;
+
+    if (!CacheValid || width != CacheWidth || height != CacheHeight || left != CacheLeft ||
+        top != CacheTop || tileSize != CacheTile) {
+        return 0;
+    }
+    shift = Layers[Layer].shift;
+    cellsX = WORLD_X >> shift;
+    for (j = 0; j < WORLD_Y >> shift; j++) {
+        if (memcmp(CacheMap[j], map + j * cellsX, cellsX) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int OverlayBlend(OverlayPixel *frame, int width, int height, int pitch, int left, int top,
+                 int tileSize) {
+    const OverlayPixel *src;
+    OverlayPixel *dst;
+    OverlayPixel p, d, rb, g;
+    const Byte *map;
+    int i, j, a;
+
+    map = LayerMap(Layer);
+    if (!map || width <= 0 || height <= 0 || tileSize <= 0) {
+        return 0;
+    }
+    if (!CacheCurrent(map, width, height, left, top, tileSize)) {
+        if (!ReserveCache(width, height)) {
+            return 0;
+        }
+        Rasterise(map, width, height, left, top, tileSize);
+    }
+
+    for (j = 0; j < height; j++) {
+        src = Cache + j * width;
+        dst = frame + j * pitch;
+        for (i = 0; i < width; i++) {
+            p = src[i];
+            a = (int)(p >> 24);
+            if (!a) {
+                continue;
+            }
+            a += a >> 7; /* 0 to 256 */
+
+            /* Red and blue together, then green */
+            d = dst[i];
+            rb = (((p & 0xFF00FF) * a + (d & 0xFF00FF) * (256 - a)) >> 8) & 0xFF00FF;
+            g = (((p & 0x00FF00) * a + (d & 0x00FF00) * (256 - a)) >> 8) & 0x00FF00;
+            dst[i] = rb | g;
+        }
+    }
+    return 1;
+}
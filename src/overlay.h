@@ -0,0 +1,43 @@
+/* overlay.h - Density overlays for the city view in WiNTown
+ * A layer is one of the half or quarter size scanner maps, scaled up to
+ * screen pixels and coloured through a ramp whose alpha grows with the
+ * value. The coloured layer is cached and only drawn again when its map
+ * or the view moves; each frame it is just blended over the tiles.
+ */
+
+#ifndef _OVERLAY_H
+#define _OVERLAY_H
+
+/* Overlay layers */
+#define OVERLAY_NONE 0
+#define OVERLAY_POPULATION 1
+#define OVERLAY_TRAFFIC 2
+#define OVERLAY_POLLUTION 3
+#define OVERLAY_CRIME 4
+#define OVERLAY_LANDVALUE 5
+#define OVERLAY_FIRE 6
+#define OVERLAY_POLICE 7
+#define OVERLAY_COUNT 8
+
+/* 0x00RRGGBB, the layout of a 32-bit DIB */
+typedef unsigned int OverlayPixel;
+
+/* Pick the layer shown - OVERLAY_NONE for none */
+void SetOverlayLayer(int layer);
+int GetOverlayLayer(void);
+const char *GetOverlayName(int layer);
+
+/* Blend between the map's cells rather than showing them as blocks */
+void SetOverlaySmooth(int smooth);
+int GetOverlaySmooth(void);
+
+/* Blend the layer over a frame of width by height pixels, rows pitch
+   pixels apart, that shows the map from pixel (left, top) at tileSize
+   pixels a tile. Returns 0 if there was nothing to blend. */
+int OverlayBlend(OverlayPixel *frame, int width, int height, int pitch, int left, int top,
+                 int tileSize);
+
+/* Free the cached layer */
+void FreeOverlay(void);
+
+#endif /* _OVERLAY_H */
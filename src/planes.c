@@ -0,0 +1,134 @@
+/* planes.c - Flag bitplanes and tile ID plane for WiNTown
+ * Like the census, the planes follow the old/new tile of each change. The
+ * map and the planes both start out zeroed, which keeps them in step from
+ * the first write onward.
+ */
+
+#include "sim.h"
+#include "planes.h"
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+#define PLANE_WORD_MASK 0xFFFFFFFFUL
+
+PlaneWord FlagPlane[PLANE_COUNT][WORLD_Y][PLANE_ROW_WORDS];
+unsigned short TileIdPlane[WORLD_Y][WORLD_X];
+
+/* Bit index from the isolated lowest bit of a word times the de Bruijn constant */
+static const int DeBruijnBit[32] = {
+    0,  1,  28, 2,  29, 14, 24, 3,  30, 22, 20, 15, 25, 17, 4,  8,
+    31, 27, 13, 23, 21, 19, 16, 7,  26, 12, 18, 6,  11, 5,  10, 9
+};
+
+static int LowestBit(PlaneWord w) {
+    return DeBruijnBit[(((w & (0 - w)) * 0x077CB531UL) & PLANE_WORD_MASK) >> 27];
+}
+
+static int CountBits(PlaneWord w) {
+    w = w - ((w >> 1) & 0x55555555UL);
+    w = (w & 0x33333333UL) + ((w >> 2) & 0x33333333UL);
+    w = (w + (w >> 4)) & 0x0F0F0F0FUL;
+    return (int)(((w * 0x01010101UL) & PLANE_WORD_MASK) >> 24);
+}
+
+/* Called by setMapTile() for every tile change */
+void PlaneTileChanged(int x, int y, int oldTile, int newTile) {
+    PlaneWord bit, *word;
+    int flags, plane;
+
+    TileIdPlane[y][x] = (unsigned short)(newTile & LOMASK);
+
+    /* Set each bit from the new tile rather than toggling by the change,
+       so a plane can never drift from the map it shadows */
+    flags = newTile >> PLANE_FIRST_BIT;
+    bit = (PlaneWord)1 << (x % PLANE_WORD_BITS);
+    for (plane = 0; plane < PLANE_COUNT; plane++, flags >>= 1) {
+        word = &FlagPlane[plane][y][x / PLANE_WORD_BITS];
+        if (flags & 1) {
+            *word |= bit;
+        } else {
+            *word &= ~bit;
+        }
+    }
+}
+
+int PlaneNextBit(int plane, int y, int from, int to) {
+    const PlaneWord *row;
+    PlaneWord bits;
+    int w, last, x;
+
+    if (from >= to) {
+        return -1;
+    }
+
+    row = FlagPlane[plane][y];
+    w = from / PLANE_WORD_BITS;
+    last = (to - 1) / PLANE_WORD_BITS;
+    bits = row[w] & ((PLANE_WORD_MASK << (from % PLANE_WORD_BITS)) & PLANE_WORD_MASK);
+
+    for (;;) {
+        if (bits) {
+            x = w * PLANE_WORD_BITS + LowestBit(bits);
+            return x < to ? x : -1;
+        }
+        if (++w > last) {
+            return -1;
+        }
+        bits = row[w];
+    }
+}
+
+int PlaneCount(int plane) {
+    const PlaneWord *p;
+    int i, count;
+
+    p = &FlagPlane[plane][0][0];
+    count = 0;
+    for (i = 0; i < WORLD_Y * PLANE_ROW_WORDS; i++) {
+        count += CountBits(p[i]);
+    }
+    return count;
+}
+
+int PlaneCountBoth(int planeA, int planeB) {
+    const PlaneWord *a, *b;
+    int i, count;
+
+    a = &FlagPlane[planeA][0][0];
+    b = &FlagPlane[planeB][0][0];
+    count = 0;
+    for (i = 0; i < WORLD_Y * PLANE_ROW_WORDS; i++) {
+        count += CountBits(a[i] & b[i]);
+    }
+    return count;
+}
+
+#ifdef PLANES_DEBUG
+/* Compare the planes with the map, returns mismatching tiles */
+int VerifyPlanes(void) {
+    int x, y, plane, errors;
+    int inPlane, inMap;
+
+    errors = 0;
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            if (TileIdPlane[y][x] != (Map[y][x] & LOMASK)) {
+                addDebugLog("PLANES MISMATCH: tile id at (%d,%d) plane=%d map=%d", x, y,
+                            TileIdPlane[y][x], Map[y][x] & LOMASK);
+                errors++;
+            }
+            for (plane = 0; plane < PLANE_COUNT; plane++) {
+                inPlane = (FlagPlane[plane][y][x / PLANE_WORD_BITS] >> (x % PLANE_WORD_BITS)) & 1;
+                inMap = (Map[y][x] >> (PLANE_FIRST_BIT + plane)) & 1;
+                if (inPlane != inMap) {
+                    addDebugLog("PLANES MISMATCH: flag plane %d at (%d,%d) plane=%d map=%d",
+                                plane, x, y, inPlane, inMap);
+                    errors++;
+                }
+            }
+        }
+    }
+    return errors;
+}
+#endif
@@ -0,0 +1,46 @@
+/* planes.h - Flag bitplanes and tile ID plane for WiNTown
+ * Shadows of the map kept current from setMapTile(). Each flag bit has a
+ * packed plane of one bit per tile (1.6 KB), so scans that only test a
+ * flag walk whole words instead of pulling the 24 KB map through cache.
+ * Map itself stays the authoritative copy.
+ */
+
+#ifndef _PLANES_H
+#define _PLANES_H
+
+/* One plane word holds 32 tiles of a row; rows are padded to whole words */
+typedef unsigned long PlaneWord;
+#define PLANE_WORD_BITS 32
+#define PLANE_ROW_WORDS ((WORLD_X + PLANE_WORD_BITS - 1) / PLANE_WORD_BITS)
+
+/* Planes in flag bit order, starting from ZONEBIT (bit 10) */
+#define PLANE_FIRST_BIT 10
+#define PLANE_ZONE      0 /* ZONEBIT */
+#define PLANE_ANIM      1 /* ANIMBIT */
+#define PLANE_BULL      2 /* BULLBIT */
+#define PLANE_BURN      3 /* BURNBIT */
+#define PLANE_COND      4 /* CONDBIT */
+#define PLANE_POWER     5 /* POWERBIT */
+#define PLANE_COUNT     6
+
+extern PlaneWord FlagPlane[PLANE_COUNT][WORLD_Y][PLANE_ROW_WORDS];
+extern unsigned short TileIdPlane[WORLD_Y][WORLD_X];
+
+/* Called by setMapTile() for every tile change */
+void PlaneTileChanged(int x, int y, int oldTile, int newTile);
+
+/* Next x in [from, to) of row y with the plane's bit set, or -1.
+ * Reads the plane live, so bits set or cleared behind the caller's
+ * position are seen on the next call. */
+int PlaneNextBit(int plane, int y, int from, int to);
+
+/* Tiles with the bit set in one plane, or in both of two planes */
+int PlaneCount(int plane);
+int PlaneCountBoth(int planeA, int planeB);
+
+#ifdef PLANES_DEBUG
+/* Compare the planes with the map, returns mismatching tiles */
+int VerifyPlanes(void);
+#endif
+
+#endif /* _PLANES_H */
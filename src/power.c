@@ -4,11 +4,15 @@
 
 #include "sim.h"
 #include "tiles.h"
+#include "planes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <windows.h>
 
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
 /* Power stack size for power distribution algorithm */
 #define PWRSTKSIZE 1000
 
@@ -21,10 +25,6 @@ static short PowerStackY[PWRSTKSIZE];
 static QUAD MaxPower = 0;
 static QUAD NumPower = 0;
 
-/* Number of each type of power plant */
-static int CoalPop = 0;
-static int NuclearPop = 0;
-
 /* Function prototypes */
 static void PushPowerStack(void);
 static void PullPowerStack(void);
@@ -131,31 +131,6 @@ static void PullPowerStack(void) {
     }
 }
 
-/* Count power plants - cache-optimized version */
-void CountPowerPlants(void) {
-    int x, y;
-    short fullTile, tile;
-
-    CoalPop = 0;
-    NuclearPop = 0;
-
-    /* Sequential row-by-row access for better cache performance */
-    for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
-            fullTile = Map[y][x]; /* Single memory access */
-            tile = fullTile & LOMASK;
-
-            if ((fullTile & ZONEBIT) != 0) {
-                if (tile == POWERPLANT) {
-                    CoalPop++;
-                } else if (tile == NUCLEAR) {
-                    NuclearPop++;
-                }
-            }
-        }
-    }
-}
-
 /* Add a power plant position to the distribution queue */
 void QueuePowerPlant(int x, int y) {
     if (PowerStackNum < (PWRSTKSIZE - 2)) {
@@ -165,51 +140,31 @@ void QueuePowerPlant(int x, int y) {
     }
 }
 
-/* Find all power plants and add them to the queue - cache-optimized */
+/* Find all power plants and add them to the queue - only zone centers are visited */
 void FindPowerPlants(void) {
     int x, y;
-    short fullTile, tile;
+    short tile;
 
     PowerStackNum = 0;
 
-    /* Sequential row-by-row access for better cache performance */
     for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
-            fullTile = Map[y][x]; /* Single memory access */
-            tile = fullTile & LOMASK;
-
-            if ((fullTile & ZONEBIT) != 0) {
-                if (tile == POWERPLANT || tile == NUCLEAR) {
-                    QueuePowerPlant(x, y);
-                }
+        for (x = PlaneNextBit(PLANE_ZONE, y, 0, WORLD_X); x >= 0;
+             x = PlaneNextBit(PLANE_ZONE, y, x + 1, WORLD_X)) {
+            tile = TileIdPlane[y][x];
+            if (tile == POWERPLANT || tile == NUCLEAR) {
+                QueuePowerPlant(x, y);
             }
         }
     }
 }
 
-/* Count powered and unpowered zones - cache-optimized version */
+/* Count powered and unpowered zones from the zone and power planes */
 static void CountPowerZones(void) {
-    int x, y;
-    short fullTile;
     int oldPwrd = PwrdZCnt;
     int oldUnpwrd = UnpwrdZCnt;
     
-    PwrdZCnt = 0;
-    UnpwrdZCnt = 0;
-    
-    /* Sequential row-by-row access for better cache performance */
-    for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
-            fullTile = Map[y][x]; /* Single memory access */
-            if (fullTile & ZONEBIT) {
-                if (fullTile & POWERBIT) {
-                    PwrdZCnt++;
-                } else {
-                    UnpwrdZCnt++;
-                }
-            }
-        }
-    }
+    PwrdZCnt = PlaneCountBoth(PLANE_ZONE, PLANE_POWER);
+    UnpwrdZCnt = PlaneCount(PLANE_ZONE) - PwrdZCnt;
     
     /* Debug logging to track changes */
 #ifdef DEBUG
@@ -220,40 +175,25 @@ static void CountPowerZones(void) {
 #endif
 }
 
-/* Do a full power distribution scan - ORIGINAL ALGORITHM
+/* Walk the grid the ORIGINAL way
    This uses the original WiNTown power transmission method that traces along
-   power lines and conductive terrain rather than using a simple radius */
-void DoPowerScan(void) {
+   power lines and conductive terrain rather than using a simple radius.
+   Returns 1 if it stopped because the plants ran out of capacity. */
+static int DoPowerWalk(void) {
     int x, y;
     short ADir, ConNum, Dir;
 
-#ifdef DEBUG
-    addDebugLog("DoPowerScan: Starting power distribution scan");
-#endif
-
-    /* Count power plants */
-    CountPowerPlants();
-
-    /* Calculate total power capacity */
-    MaxPower = (CoalPop * 700L) + (NuclearPop * 2000L);
-    NumPower = 0;
-
-    /* Clear the power map first using unified system - cache-friendly row-by-row */
+    /* Clear the power map first - the power plane gives the tiles that need it */
     for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
+        for (x = PlaneNextBit(PLANE_POWER, y, 0, WORLD_X); x >= 0;
+             x = PlaneNextBit(PLANE_POWER, y, x + 1, WORLD_X)) {
             SetPowerStatusOnly(x, y, 0); /* Clear power status without updating counts */
         }
     }
-    
-    /* Reset zone counts after clearing */
-    PwrdZCnt = 0;
-    UnpwrdZCnt = 0;
 
     /* If we have no power plants, no point in doing anything else */
     if (CoalPop == 0 && NuclearPop == 0) {
-        /* Count unpowered zones using unified system */
-        CountPowerZones();
-        return;
+        return 0;
     }
 
     /* Initialize the power stack with all power plants */
@@ -271,9 +211,7 @@ void DoPowerScan(void) {
             /* Increment the power counter - if over capacity, stop */
             if (++NumPower > MaxPower) {
                 /* We've reached the power capacity limit */
-                /* Count power zones using unified system */
-                CountPowerZones();
-                return;
+                return 1;
             }
 
             /* Move to the current direction */
@@ -302,6 +240,321 @@ void DoPowerScan(void) {
         } while (ConNum); /* Continue as long as we have conductive paths */
     }
 
-    /* Update power zone counts using unified system */
+    return 0;
+}
+
+/* Flood engine - the grid as one bit per tile, spread a ring at a time */
+typedef PlaneWord PowerBoard[WORLD_Y][PLANE_ROW_WORDS];
+
+#define POWER_WORD_MASK 0xFFFFFFFFUL
+
+static PowerBoard FloodPowered;  /* Result of the flood */
+static PowerBoard FloodComp;     /* Component being flooded */
+static PowerBoard FloodRingA;
+static PowerBoard FloodRingB;
+
+static int PowerEngine = POWER_ENGINE_WALK;
+
+static int CountBoardBits(PlaneWord w) {
+    w = w - ((w >> 1) & 0x55555555UL);
+    w = (w & 0x33333333UL) + ((w >> 2) & 0x33333333UL);
+    w = (w + (w >> 4)) & 0x0F0F0F0FUL;
+    return (int)(((w * 0x01010101UL) & POWER_WORD_MASK) >> 24);
+}
+
+/* Plant capacity in tiles, 0 if the tile is not a plant center */
+static QUAD PlantCapacity(int x, int y) {
+    if (TileIdPlane[y][x] == POWERPLANT) {
+        return 700L;
+    }
+    if (TileIdPlane[y][x] == NUCLEAR) {
+        return 2000L;
+    }
+    return 0;
+}
+
+/* Spread FloodComp outward from the tiles already in it and in ring,
+   between rows top and bottom. A tile conducts if it has CONDBIT or
+   ZONEBIT, as in TestForCond. Stops after budget tiles if budget is not
+   negative, taking the last ring in row order. Returns tiles in FloodComp. */
+static QUAD FloodRings(PlaneWord (*ring)[PLANE_ROW_WORDS], int top, int bottom, QUAD count,
+                       QUAD budget) {
+    PlaneWord (*next)[PLANE_ROW_WORDS];
+    PlaneWord (*swap)[PLANE_ROW_WORDS];
+    PlaneWord f, n, bit;
+    int y, w, lo, hi, newTop, newBottom;
+    QUAD ringCount;
+
+    next = (ring == FloodRingA) ? FloodRingB : FloodRingA;
+
+    while (top <= bottom) {
+        lo = top > 0 ? top - 1 : 0;
+        hi = bottom < WORLD_Y - 1 ? bottom + 1 : WORLD_Y - 1;
+        newTop = WORLD_Y;
+        newBottom = -1;
+        ringCount = 0;
+
+        for (y = lo; y <= hi; y++) {
+            for (w = 0; w < PLANE_ROW_WORDS; w++) {
+                f = ring[y][w];
+                n = (f << 1) | (f >> 1);
+                if (w > 0) {
+                    n |= ring[y][w - 1] >> (PLANE_WORD_BITS - 1);
+                }
+                if (w < PLANE_ROW_WORDS - 1) {
+                    n |= ring[y][w + 1] << (PLANE_WORD_BITS - 1);
+                }
+                if (y > 0) {
+                    n |= ring[y - 1][w];
+                }
+                if (y < WORLD_Y - 1) {
+                    n |= ring[y + 1][w];
+                }
+                n &= (FlagPlane[PLANE_COND][y][w] | FlagPlane[PLANE_ZONE][y][w]) &
+                     ~FloodComp[y][w] & POWER_WORD_MASK;
+                next[y][w] = n;
+                if (n) {
+                    ringCount += CountBoardBits(n);
+                    if (y < newTop) {
+                        newTop = y;
+                    }
+                    newBottom = y;
+                }
+            }
+        }
+
+        /* Retire this ring so the board is clear when it is reused */
+        for (y = top; y <= bottom; y++) {
+            for (w = 0; w < PLANE_ROW_WORDS; w++) {
+                ring[y][w] = 0;
+            }
+        }
+
+        if (budget >= 0 && count + ringCount > budget) {
+            /* Not enough capacity for the whole ring */
+            for (y = newTop; y <= newBottom; y++) {
+                for (w = 0; w < PLANE_ROW_WORDS; w++) {
+                    n = next[y][w];
+                    while (n && count < budget) {
+                        bit = n & (0 - n);
+                        FloodComp[y][w] |= bit;
+                        n ^= bit;
+                        count++;
+                    }
+                    next[y][w] = 0;
+                }
+            }
+            return count;
+        }
+
+        for (y = newTop; y <= newBottom; y++) {
+            for (w = 0; w < PLANE_ROW_WORDS; w++) {
+                FloodComp[y][w] |= next[y][w];
+            }
+        }
+        count += ringCount;
+
+        swap = ring;
+        ring = next;
+        next = swap;
+        top = newTop;
+        bottom = newBottom;
+    }
+
+    return count;
+}
+
+/* Power the grid connected to one plant. Each component gets the
+   capacity of the plants in it; when that is short, power spreads from
+   all of them at once and the tiles furthest from any plant go without.
+   Returns 1 if the component was short of capacity. */
+static int FloodPlantComponent(int plantX, int plantY) {
+    QUAD size, capacity;
+    int i, y, w, top, bottom, limited;
+    PlaneWord bit;
+
+    memset(FloodComp, 0, sizeof(FloodComp));
+    bit = (PlaneWord)1 << (plantX % PLANE_WORD_BITS);
+    FloodComp[plantY][plantX / PLANE_WORD_BITS] = bit;
+    FloodRingA[plantY][plantX / PLANE_WORD_BITS] = bit;
+    size = FloodRings(FloodRingA, plantY, plantY, 1, -1);
+
+    /* Capacity of every plant on this grid */
+    capacity = 0;
+    top = WORLD_Y;
+    bottom = -1;
+    for (i = 1; i <= PowerStackNum; i++) {
+        y = PowerStackY[i];
+        w = PowerStackX[i] / PLANE_WORD_BITS;
+        bit = (PlaneWord)1 << (PowerStackX[i] % PLANE_WORD_BITS);
+        if (FloodComp[y][w] & bit) {
+            capacity += PlantCapacity(PowerStackX[i], y);
+            FloodRingA[y][w] |= bit;
+            if (y < top) {
+                top = y;
+            }
+            if (y > bottom) {
+                bottom = y;
+            }
+        }
+    }
+
+    limited = size > capacity;
+    if (limited) {
+        /* Start again from all the plants with only their capacity */
+        memset(FloodComp, 0, sizeof(FloodComp));
+        size = 0;
+        for (y = top; y <= bottom; y++) {
+            for (w = 0; w < PLANE_ROW_WORDS; w++) {
+                FloodComp[y][w] = FloodRingA[y][w];
+                size += CountBoardBits(FloodRingA[y][w]);
+            }
+        }
+        size = FloodRings(FloodRingA, top, bottom, size, capacity);
+    } else {
+        /* Seeds are not needed - clear them for the next component */
+        for (y = top; y <= bottom; y++) {
+            for (w = 0; w < PLANE_ROW_WORDS; w++) {
+                FloodRingA[y][w] = 0;
+            }
+        }
+    }
+
+    for (y = 0; y < WORLD_Y; y++) {
+        for (w = 0; w < PLANE_ROW_WORDS; w++) {
+            FloodPowered[y][w] |= FloodComp[y][w];
+        }
+    }
+    NumPower += size;
+    return limited;
+}
+
+/* Work out the powered tiles into FloodPowered without touching the map.
+   Returns 1 if any grid was short of capacity. */
+static int DoPowerFlood(void) {
+    int i, x, y, limited;
+
+    memset(FloodPowered, 0, sizeof(FloodPowered));
+    PowerStackNum = 0;
+    if (CoalPop == 0 && NuclearPop == 0) {
+        return 0;
+    }
+
+    FindPowerPlants();
+
+    limited = 0;
+    for (i = PowerStackNum; i > 0; i--) {
+        x = PowerStackX[i];
+        y = PowerStackY[i];
+        /* Already powered from a plant on the same grid */
+        if (FloodPowered[y][x / PLANE_WORD_BITS] & ((PlaneWord)1 << (x % PLANE_WORD_BITS))) {
+            continue;
+        }
+        limited |= FloodPlantComponent(x, y);
+    }
+    PowerStackNum = 0;
+    return limited;
+}
+
+/* Write FloodPowered to the map, changing only the tiles that differ */
+static void ApplyPowerFlood(void) {
+    PlaneWord diff;
+    int y, w, b;
+
+    for (y = 0; y < WORLD_Y; y++) {
+        for (w = 0; w < PLANE_ROW_WORDS; w++) {
+            diff = FloodPowered[y][w] ^ FlagPlane[PLANE_POWER][y][w];
+            for (b = 0; diff; b++, diff >>= 1) {
+                if (diff & 1) {
+                    SetPowerStatusOnly(w * PLANE_WORD_BITS + b, y,
+                                       (int)((FloodPowered[y][w] >> b) & 1));
+                }
+            }
+        }
+    }
+}
+
+#ifdef POWER_DEBUG
+/* Run the walker over the same city and compare the powered tiles. Only
+   meaningful when neither engine ran short of capacity, since they ration
+   differently - the walker also counts a tile again each time it backs up
+   to a branch. */
+static void CrossCheckPowerFlood(int floodLimited) {
+    QUAD floodPower;
+    int y, w, mismatches;
+
+    floodPower = NumPower;
+    NumPower = 0;
+    if (DoPowerWalk() || floodLimited) {
+        NumPower = floodPower;
+        return;
+    }
+
+    mismatches = 0;
+    for (y = 0; y < WORLD_Y; y++) {
+        for (w = 0; w < PLANE_ROW_WORDS; w++) {
+            mismatches += CountBoardBits(FloodPowered[y][w] ^ FlagPlane[PLANE_POWER][y][w]);
+        }
+    }
+    if (mismatches) {
+        addDebugLog("POWER MISMATCH: flood and walk differ on %d tiles", mismatches);
+    }
+    NumPower = floodPower;
+}
+#endif
+
+/* Select the engine DoPowerScan uses */
+void SetPowerEngine(int engine) {
+    if (engine != POWER_ENGINE_WALK && engine != POWER_ENGINE_FLOOD) {
+        return;
+    }
+    PowerEngine = engine;
+    addDebugLog("Power engine set to %d", engine);
+}
+
+int GetPowerEngine(void) {
+    return PowerEngine;
+}
+
+/* Do a full power distribution scan with the selected engine */
+void DoPowerScan(void) {
+#if defined(DEBUG) || defined(POWER_DEBUG)
+    int limited;
+#endif
+
+#ifdef DEBUG
+    addDebugLog("DoPowerScan: Starting power distribution scan");
+#endif
+
+    /* Calculate total power capacity - plant counts are kept by census.c */
+    MaxPower = (CoalPop * 700L) + (NuclearPop * 2000L);
+    NumPower = 0;
+
+    /* Whether the plants ran out is only reported in debug builds */
+    if (PowerEngine == POWER_ENGINE_FLOOD) {
+#if defined(DEBUG) || defined(POWER_DEBUG)
+        limited = DoPowerFlood();
+#else
+        DoPowerFlood();
+#endif
+#ifdef POWER_DEBUG
+        CrossCheckPowerFlood(limited);
+#endif
+        ApplyPowerFlood();
+    } else {
+#if defined(DEBUG) || defined(POWER_DEBUG)
+        limited = DoPowerWalk();
+#else
+        DoPowerWalk();
+#endif
+    }
+
+#ifdef DEBUG
+    if (limited) {
+        addDebugLog("DoPowerScan: plants ran out of capacity after %ld tiles", (long)NumPower);
+    }
+#endif
+
+    /* Update power zone counts from the planes */
     CountPowerZones();
-}
\ No newline at end of file
+}
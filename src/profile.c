@@ -0,0 +1,149 @@
+/* profile.c - Frame profiler for WiNTown
+ * Each thread records into its own ring, so a marker is a counter read
+ * and three stores with no lock. Stamps stay in raw counter ticks until
+ * the JSON is written.
+ */
+
+#include "sim.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <windows.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Threads that can record at once */
+#define PROFILE_MAX_THREADS 4
+
+typedef struct {
+    const char *name;
+    LARGE_INTEGER stamp;
+    int phase;
+} ProfileRecord;
+
+typedef struct {
+    ProfileRecord events[PROFILE_RING_SIZE];
+    long count;   /* Events recorded, including overwritten ones */
+    DWORD threadId;
+} ProfileRing;
+
+int profileEnabled = 0;
+
+static DWORD profileTlsIndex = 0;
+static int profileReady = 0;
+static ProfileRing *profileRings[PROFILE_MAX_THREADS];
+static volatile LONG profileRingCount = 0;
+static LARGE_INTEGER profileStart;
+
+static ProfileRing *AttachProfileRing(void) {
+    ProfileRing *ring;
+    LONG slot;
+
+    slot = InterlockedIncrement((LONG *)&profileRingCount) - 1;
+    if (slot >= PROFILE_MAX_THREADS) {
+        InterlockedDecrement((LONG *)&profileRingCount);
+        return NULL;
+    }
+
+    ring = (ProfileRing *)malloc(sizeof(ProfileRing));
+    if (!ring) {
+        InterlockedDecrement((LONG *)&profileRingCount);
+        return NULL;
+    }
+    ring->count = 0;
+    ring->threadId = GetCurrentThreadId();
+    profileRings[slot] = ring;
+    TlsSetValue(profileTlsIndex, ring);
+    return ring;
+}
+
+void ProfileEvent(const char *name, int phase) {
+    ProfileRing *ring;
+    ProfileRecord *rec;
+
+    ring = (ProfileRing *)TlsGetValue(profileTlsIndex);
+    if (!ring) {
+        ring = AttachProfileRing();
+        if (!ring) {
+            return;
+        }
+    }
+
+    rec = &ring->events[ring->count % PROFILE_RING_SIZE];
+    QueryPerformanceCounter(&rec->stamp);
+    rec->name = name;
+    rec->phase = phase;
+    ring->count++;
+}
+
+int StartProfile(void) {
+    LONG i;
+
+    if (!profileReady) {
+        profileTlsIndex = TlsAlloc();
+        if (profileTlsIndex == (DWORD)0xFFFFFFFF) {
+            return 0;
+        }
+        profileReady = 1;
+    }
+
+    for (i = 0; i < profileRingCount; i++) {
+        profileRings[i]->count = 0;
+    }
+    QueryPerformanceCounter(&profileStart);
+    profileEnabled = 1;
+    return 1;
+}
+
+/* Write one ring, oldest event first */
+static long WriteProfileRing(FILE *f, ProfileRing *ring, double ticksPerMicro, int first) {
+    ProfileRecord *rec;
+    long i, start, written;
+    double ts;
+
+    start = ring->count > PROFILE_RING_SIZE ? ring->count - PROFILE_RING_SIZE : 0;
+    written = 0;
+    for (i = start; i < ring->count; i++) {
+        rec = &ring->events[i % PROFILE_RING_SIZE];
+        ts = (double)(rec->stamp.QuadPart - profileStart.QuadPart) / ticksPerMicro;
+        fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu}",
+                (first && written == 0) ? "" : ",", rec->name, rec->phase, ts,
+                (unsigned long)ring->threadId);
+        written++;
+    }
+    return written;
+}
+
+long StopProfile(const char *path) {
+    LARGE_INTEGER freq;
+    FILE *f;
+    double ticksPerMicro;
+    long total;
+    LONG i;
+
+    profileEnabled = 0;
+    if (!profileReady) {
+        return 0;
+    }
+
+    f = fopen(path ? path : PROFILE_FILE_NAME, "w");
+    if (!f) {
+        addDebugLog("Profiler: cannot create %s", path ? path : PROFILE_FILE_NAME);
+        return 0;
+    }
+
+    QueryPerformanceFrequency(&freq);
+    ticksPerMicro = (double)freq.QuadPart / 1000000.0;
+
+    total = 0;
+    fprintf(f, "{\"traceEvents\":[");
+    for (i = 0; i < profileRingCount; i++) {
+        total += WriteProfileRing(f, profileRings[i], ticksPerMicro, total == 0);
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+
+    addDebugLog("Profiler wrote %ld events to %s", total, path ? path : PROFILE_FILE_NAME);
+    return total;
+}
@@ -0,0 +1,30 @@
+/* profile.h - Frame profiler for WiNTown
+ * Begin/end scopes are stamped with QueryPerformanceCounter into a ring
+ * per thread and written out as Chrome trace_event JSON, which
+ * chrome://tracing and Perfetto load directly.
+ */
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#define PROFILE_FILE_NAME "profile.json"
+
+/* Events kept per thread - the oldest are overwritten */
+#define PROFILE_RING_SIZE 65536
+
+extern int profileEnabled;
+
+/* Scope markers - name must be a string that outlives the recording.
+ * A disabled profiler costs one test of profileEnabled per marker. */
+#define PROFILE_BEGIN(name) do { if (profileEnabled) ProfileEvent((name), 'B'); } while (0)
+#define PROFILE_END(name) do { if (profileEnabled) ProfileEvent((name), 'E'); } while (0)
+
+void ProfileEvent(const char *name, int phase);
+
+/* Start recording with empty rings */
+int StartProfile(void);
+
+/* Stop recording and write the rings as JSON. Returns events written. */
+long StopProfile(const char *path);
+
+#endif /* _PROFILE_H */
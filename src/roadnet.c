@@ -0,0 +1,532 @@
+/* roadnet.c - Road and rail network graph for WiNTown
+ * Tiles with other than two network neighbours become nodes, as does every
+ * tile whose x + y is a multiple of ROADNET_SPLIT so that no run gets much
+ * longer than that and flow loads stay local. Each run of two-neighbour
+ * tiles between nodes becomes an edge, stored both ways in
+ * CSR form so a node's edges are one contiguous slice. Any change to the
+ * network marks the graph stale and the next query rebuilds it in a
+ * single pass. Trip destinations next to the network are counted per
+ * connected component, and zone changes patch those counts in place.
+ */
+
+#include "sim.h"
+#include "roadnet.h"
+#include <string.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+#define ROADNET_SPLIT     8
+#define ROADNET_MAX_COMPS (WORLD_X * WORLD_Y / 2 + 1)
+#define ROADNET_FAR       0x7FFFFFFF
+
+/* Trip destinations by source zone - R>C C>I I>R, as in the original */
+static const short TripLow[3] = {COMBASE, LHTHR, LHTHR};
+static const short TripHigh[3] = {NUCLEAR, PORT, COMBASE};
+
+/* N, E, S, W */
+static const short RoadDx[4] = {0, 1, 0, -1};
+static const short RoadDy[4] = {-1, 0, 1, 0};
+
+/* Per tile: node id plus one, or for run tiles the edge that covers
+   them plus one and the steps from that edge's first node */
+static unsigned short TileNode[WORLD_Y][WORLD_X];
+static unsigned short TileEdge[WORLD_Y][WORLD_X];
+static unsigned short TileEdgePos[WORLD_Y][WORLD_X];
+
+/* Edges of node n are EdgeStart[n] .. EdgeStart[n + 1] - 1 */
+static int NodeCount = 0;
+static int EdgeCount = 0;
+static int EdgeStart[ROADNET_MAX_NODES + 1];
+static unsigned short EdgeFrom[ROADNET_MAX_EDGES];
+static unsigned short EdgeTo[ROADNET_MAX_EDGES];
+static unsigned short EdgeLen[ROADNET_MAX_EDGES];
+
+/* For flow models - where each node is, which way each edge leaves its
+   first node, and the edge that speaks for both directions of a run */
+static unsigned short NodeTile[ROADNET_MAX_NODES]; /* y * WORLD_X + x */
+static unsigned char EdgeDir[ROADNET_MAX_EDGES];
+static unsigned short EdgeLink[ROADNET_MAX_EDGES];
+static unsigned long RoadNetVersion = 0;
+static RoadNetGraph Graph;
+
+/* Connected components, numbered from 1 */
+static unsigned short NodeComp[ROADNET_MAX_NODES];
+static int CompCount = 0;
+static unsigned short CompDest[ROADNET_MAX_COMPS][3];
+
+static int RoadNetStale = 1;
+
+/* Shortest path search - an indexed heap over NodeDist. NodeDist is only
+   valid where DistMark matches DistEpoch, so searches need no reset. */
+static int NodeDist[ROADNET_MAX_NODES];
+static unsigned short DistMark[ROADNET_MAX_NODES];
+static unsigned short DistEpoch = 0;
+static unsigned short HeapNode[ROADNET_MAX_NODES];
+static unsigned short HeapPos[ROADNET_MAX_NODES]; /* Heap index plus one, 0 if not queued */
+static int HeapSize = 0;
+
+int IsRoadNetTile(int tile) {
+    tile &= LOMASK;
+
+    /* Not a road or rail if it's outside the valid ranges */
+    if (tile < ROADBASE || tile > LASTRAIL || (tile >= POWERBASE && tile < RAILBASE)) {
+        return 0;
+    }
+    return 1;
+}
+
+int IsTripDestination(int zoneType, int tile) {
+    tile &= LOMASK;
+    return tile >= TripLow[zoneType] && tile <= TripHigh[zoneType];
+}
+
+static int IsNetAt(int x, int y) {
+    return BOUNDS_CHECK(x, y) && IsRoadNetTile(Map[y][x]);
+}
+
+static int NetDegree(int x, int y) {
+    int d, degree;
+
+    degree = 0;
+    for (d = 0; d < 4; d++) {
+        if (IsNetAt(x + RoadDx[d], y + RoadDy[d])) {
+            degree++;
+        }
+    }
+    return degree;
+}
+
+static int TileComponent(int x, int y) {
+    if (TileNode[y][x]) {
+        return NodeComp[TileNode[y][x] - 1];
+    }
+    if (TileEdge[y][x]) {
+        return NodeComp[EdgeFrom[TileEdge[y][x] - 1]];
+    }
+    return 0;
+}
+
+static void AddNode(int x, int y) {
+    TileNode[y][x] = (unsigned short)(NodeCount + 1);
+    NodeTile[NodeCount] = (unsigned short)(y * WORLD_X + x);
+    NodeCount++;
+}
+
+/* Follow the run leaving node at (x, y) in direction dir to the next node */
+static void WalkEdge(int node, int x, int y, int dir) {
+    int edge, len, d, back;
+
+    edge = EdgeCount++;
+    EdgeDir[edge] = (unsigned char)dir;
+    len = 0;
+    for (;;) {
+        x += RoadDx[dir];
+        y += RoadDy[dir];
+        len++;
+        if (TileNode[y][x]) {
+            break;
+        }
+
+        /* The first walk along a run claims its tiles */
+        if (!TileEdge[y][x]) {
+            TileEdge[y][x] = (unsigned short)(edge + 1);
+            TileEdgePos[y][x] = (unsigned short)len;
+        }
+
+        /* Run tiles have two neighbours - carry on through the other one */
+        back = (dir + 2) & 3;
+        for (d = 0; d < 4; d++) {
+            if (d != back && IsNetAt(x + RoadDx[d], y + RoadDy[d])) {
+                break;
+            }
+        }
+        dir = d;
+    }
+
+    EdgeFrom[edge] = (unsigned short)node;
+    EdgeTo[edge] = (unsigned short)(TileNode[y][x] - 1);
+    EdgeLen[edge] = (unsigned short)len;
+}
+
+/* Pair each edge with the one run both directions share. Longer runs
+   go by the edge that claimed their tiles; a step between neighbouring
+   nodes goes by the lower numbered of its two edges. */
+static void LinkEdges(void) {
+    int e, f, x, y, from;
+
+    for (e = 0; e < EdgeCount; e++) {
+        from = EdgeFrom[e];
+        x = NodeTile[from] % WORLD_X + RoadDx[EdgeDir[e]];
+        y = NodeTile[from] / WORLD_X + RoadDy[EdgeDir[e]];
+        if (EdgeLen[e] > 1) {
+            EdgeLink[e] = (unsigned short)(TileEdge[y][x] - 1);
+            continue;
+        }
+        EdgeLink[e] = (unsigned short)e;
+        for (f = EdgeStart[EdgeTo[e]]; f < EdgeStart[EdgeTo[e] + 1]; f++) {
+            if (EdgeTo[f] == from && EdgeLen[f] == 1 && f < e) {
+                EdgeLink[e] = (unsigned short)f;
+            }
+        }
+    }
+}
+
+/* Number the components and count the destinations beside each */
+static void LabelComponents(void) {
+    int n, head, tail, node, e, comp, x, y, d, k, tx, ty;
+
+    memset(NodeComp, 0, sizeof(NodeComp[0]) * NodeCount);
+    CompCount = 0;
+
+    for (n = 0; n < NodeCount; n++) {
+        if (NodeComp[n]) {
+            continue;
+        }
+        /* Breadth first, borrowing the heap array as the queue */
+        comp = ++CompCount;
+        NodeComp[n] = (unsigned short)comp;
+        HeapNode[0] = (unsigned short)n;
+        head = 0;
+        tail = 1;
+        while (head < tail) {
+            node = HeapNode[head++];
+            for (e = EdgeStart[node]; e < EdgeStart[node + 1]; e++) {
+                if (!NodeComp[EdgeTo[e]]) {
+                    NodeComp[EdgeTo[e]] = (unsigned short)comp;
+                    HeapNode[tail++] = EdgeTo[e];
+                }
+            }
+        }
+    }
+
+    memset(CompDest, 0, sizeof(CompDest[0]) * (CompCount + 1));
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            comp = TileComponent(x, y);
+            if (!comp) {
+                continue;
+            }
+            for (d = 0; d < 4; d++) {
+                tx = x + RoadDx[d];
+                ty = y + RoadDy[d];
+                if (!BOUNDS_CHECK(tx, ty)) {
+                    continue;
+                }
+                for (k = 0; k < 3; k++) {
+                    if (IsTripDestination(k, Map[ty][tx])) {
+                        CompDest[comp][k]++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void RebuildRoadNet(void) {
+    int x, y, n, d, scan;
+
+    memset(TileNode, 0, sizeof(TileNode));
+    memset(TileEdge, 0, sizeof(TileEdge));
+    NodeCount = 0;
+    EdgeCount = 0;
+
+    /* Junctions, dead ends, lone tiles and the split points */
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            if (IsRoadNetTile(Map[y][x]) && (NetDegree(x, y) != 2 || (x + y) % ROADNET_SPLIT == 0)) {
+                AddNode(x, y);
+            }
+        }
+    }
+
+    /* Walk each node's runs in node order so its edges stay together.
+       Nodes are found again by scanning in the order they were added. */
+    n = 0;
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            if (!TileNode[y][x]) {
+                continue;
+            }
+            EdgeStart[n] = EdgeCount;
+            for (d = 0; d < 4; d++) {
+                if (IsNetAt(x + RoadDx[d], y + RoadDy[d])) {
+                    WalkEdge(n, x, y, d);
+                }
+            }
+            n++;
+        }
+    }
+
+    /* Whatever run tiles are left form loops with no junction on them -
+       make one tile of each loop a node */
+    for (scan = 0; scan < WORLD_X * WORLD_Y; scan++) {
+        x = scan % WORLD_X;
+        y = scan / WORLD_X;
+        if (TileNode[y][x] || TileEdge[y][x] || !IsRoadNetTile(Map[y][x])) {
+            continue;
+        }
+        AddNode(x, y);
+        EdgeStart[n] = EdgeCount;
+        for (d = 0; d < 4; d++) {
+            if (IsNetAt(x + RoadDx[d], y + RoadDy[d])) {
+                WalkEdge(n, x, y, d);
+            }
+        }
+        n++;
+    }
+    EdgeStart[NodeCount] = EdgeCount;
+
+    LinkEdges();
+    LabelComponents();
+    RoadNetStale = 0;
+    RoadNetVersion++;
+
+    addDebugLog("Road network rebuilt: %d nodes, %d edges, %d networks", NodeCount, EdgeCount,
+                CompCount);
+}
+
+/* Called by setMapTile() for every tile change */
+void RoadNetTileChanged(int x, int y, int oldTile, int newTile) {
+    int d, k, tx, ty, comp, change;
+
+    if (RoadNetStale) {
+        return;
+    }
+    if (IsRoadNetTile(oldTile) != IsRoadNetTile(newTile)) {
+        RoadNetStale = 1;
+        return;
+    }
+
+    /* A destination appearing or going beside the network */
+    for (k = 0; k < 3; k++) {
+        change = IsTripDestination(k, newTile) - IsTripDestination(k, oldTile);
+        if (!change) {
+            continue;
+        }
+        for (d = 0; d < 4; d++) {
+            tx = x + RoadDx[d];
+            ty = y + RoadDy[d];
+            if (BOUNDS_CHECK(tx, ty)) {
+                comp = TileComponent(tx, ty);
+                if (comp) {
+                    CompDest[comp][k] = (unsigned short)(CompDest[comp][k] + change);
+                }
+            }
+        }
+    }
+}
+
+int RoadNetComponent(int x, int y) {
+    if (!BOUNDS_CHECK(x, y)) {
+        return 0;
+    }
+    if (RoadNetStale) {
+        RebuildRoadNet();
+    }
+    return TileComponent(x, y);
+}
+
+int RoadNetHasTripDestination(int x, int y, int zoneType) {
+    int comp;
+
+    if (zoneType < 0 || zoneType > 2) {
+        return 0;
+    }
+    comp = RoadNetComponent(x, y);
+    return comp && CompDest[comp][zoneType] > 0;
+}
+
+/* Lower a node's distance, queueing it if needed */
+static void HeapUpdate(int node, int dist) {
+    int i, parent;
+
+    if (DistMark[node] == DistEpoch && NodeDist[node] <= dist) {
+        return;
+    }
+    if (DistMark[node] != DistEpoch) {
+        DistMark[node] = DistEpoch;
+        HeapPos[node] = 0;
+    }
+    NodeDist[node] = dist;
+
+    i = HeapPos[node] ? HeapPos[node] - 1 : HeapSize++;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (NodeDist[HeapNode[parent]] <= dist) {
+            break;
+        }
+        HeapNode[i] = HeapNode[parent];
+        HeapPos[HeapNode[i]] = (unsigned short)(i + 1);
+        i = parent;
+    }
+    HeapNode[i] = (unsigned short)node;
+    HeapPos[node] = (unsigned short)(i + 1);
+}
+
+static int HeapPop(void) {
+    int top, last, i, child, dist;
+
+    top = HeapNode[0];
+    HeapPos[top] = 0;
+    last = HeapNode[--HeapSize];
+    if (HeapSize == 0) {
+        return top;
+    }
+
+    dist = NodeDist[last];
+    i = 0;
+    for (;;) {
+        child = i * 2 + 1;
+        if (child >= HeapSize) {
+            break;
+        }
+        if (child + 1 < HeapSize && NodeDist[HeapNode[child + 1]] < NodeDist[HeapNode[child]]) {
+            child++;
+        }
+        if (dist <= NodeDist[HeapNode[child]]) {
+            break;
+        }
+        HeapNode[i] = HeapNode[child];
+        HeapPos[HeapNode[i]] = (unsigned short)(i + 1);
+        i = child;
+    }
+    HeapNode[i] = (unsigned short)last;
+    HeapPos[last] = (unsigned short)(i + 1);
+    return top;
+}
+
+/* Nodes a tile leads to and how far - one for a node, the two ends for a run */
+static int TileEnds(int x, int y, int *node, int *dist) {
+    int edge;
+
+    if (TileNode[y][x]) {
+        node[0] = TileNode[y][x] - 1;
+        dist[0] = 0;
+        return 1;
+    }
+    edge = TileEdge[y][x] - 1;
+    node[0] = EdgeFrom[edge];
+    dist[0] = TileEdgePos[y][x];
+    node[1] = EdgeTo[edge];
+    dist[1] = EdgeLen[edge] - TileEdgePos[y][x];
+    return 2;
+}
+
+int RoadNetDistance(int x1, int y1, int x2, int y2) {
+    int srcNode[2], srcDist[2], dstNode[2], dstDist[2];
+    int srcCount, dstCount, best, i, u, e, du;
+
+    if (!BOUNDS_CHECK(x2, y2)) {
+        return -1;
+    }
+    i = RoadNetComponent(x1, y1);
+    if (!i || i != TileComponent(x2, y2)) {
+        return -1;
+    }
+    if (x1 == x2 && y1 == y2) {
+        return 0;
+    }
+
+    best = ROADNET_FAR;
+
+    /* Both along the same run */
+    if (TileEdge[y1][x1] && TileEdge[y1][x1] == TileEdge[y2][x2]) {
+        best = TileEdgePos[y1][x1] - TileEdgePos[y2][x2];
+        if (best < 0) {
+            best = -best;
+        }
+    }
+
+    srcCount = TileEnds(x1, y1, srcNode, srcDist);
+    dstCount = TileEnds(x2, y2, dstNode, dstDist);
+
+    if (++DistEpoch == 0) {
+        memset(DistMark, 0, sizeof(DistMark));
+        DistEpoch = 1;
+    }
+    HeapSize = 0;
+    for (i = 0; i < srcCount; i++) {
+        HeapUpdate(srcNode[i], srcDist[i]);
+    }
+
+    while (HeapSize > 0) {
+        u = HeapPop();
+        du = NodeDist[u];
+        if (du >= best) {
+            break;
+        }
+        for (i = 0; i < dstCount; i++) {
+            if (u == dstNode[i] && du + dstDist[i] < best) {
+                best = du + dstDist[i];
+            }
+        }
+        for (e = EdgeStart[u]; e < EdgeStart[u + 1]; e++) {
+            if (du + EdgeLen[e] < best) {
+                HeapUpdate(EdgeTo[e], du + EdgeLen[e]);
+            }
+        }
+    }
+
+    /* Leave the heap slots clear for the next search */
+    for (i = 0; i < HeapSize; i++) {
+        HeapPos[HeapNode[i]] = 0;
+    }
+    HeapSize = 0;
+
+    return best == ROADNET_FAR ? -1 : best;
+}
+
+const RoadNetGraph *GetRoadNetGraph(void) {
+    if (RoadNetStale) {
+        RebuildRoadNet();
+    }
+    Graph.version = RoadNetVersion;
+    Graph.nodeCount = NodeCount;
+    Graph.edgeCount = EdgeCount;
+    Graph.edgeStart = EdgeStart;
+    Graph.edgeFrom = EdgeFrom;
+    Graph.edgeTo = EdgeTo;
+    Graph.edgeLen = EdgeLen;
+    Graph.edgeLink = EdgeLink;
+    Graph.nodeTile = NodeTile;
+    return &Graph;
+}
+
+int RoadNetTileEnds(int x, int y, int *node, int *dist, int *link) {
+    if (!RoadNetComponent(x, y)) {
+        return 0;
+    }
+    *link = TileEdge[y][x] ? TileEdge[y][x] - 1 : -1;
+    return TileEnds(x, y, node, dist);
+}
+
+int RoadNetLinkTiles(int link, short *xs, short *ys) {
+    int x, y, dir, d, back, count;
+
+    if (RoadNetStale) {
+        RebuildRoadNet();
+    }
+    if (link < 0 || link >= EdgeCount) {
+        return 0;
+    }
+
+    x = NodeTile[EdgeFrom[link]] % WORLD_X;
+    y = NodeTile[EdgeFrom[link]] / WORLD_X;
+    dir = EdgeDir[link];
+    for (count = 0; count < EdgeLen[link] - 1; count++) {
+        x += RoadDx[dir];
+        y += RoadDy[dir];
+        xs[count] = (short)x;
+        ys[count] = (short)y;
+
+        back = (dir + 2) & 3;
+        for (d = 0; d < 4; d++) {
+            if (d != back && IsNetAt(x + RoadDx[d], y + RoadDy[d])) {
+                break;
+            }
+        }
+        dir = d;
+    }
+    return count;
+}
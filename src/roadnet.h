@@ -0,0 +1,64 @@
+/* roadnet.h - Road and rail network graph for WiNTown
+ * The network as a compact graph: junctions and dead ends are nodes,
+ * the runs of road between them are edges weighted by their length.
+ * Answers connectivity and shortest path questions without walking tiles.
+ */
+
+#ifndef _ROADNET_H
+#define _ROADNET_H
+
+#define ROADNET_MAX_NODES (WORLD_X * WORLD_Y)
+#define ROADNET_MAX_EDGES (ROADNET_MAX_NODES * 4)
+
+/* Read-only view of the graph for flow models. Each edge is stored once
+ * per direction; edgeLink names the edge both directions of a run share,
+ * so loads can be kept per run. Valid until the network next changes,
+ * and version moves on with every rebuild. */
+typedef struct {
+    unsigned long version;
+    int nodeCount;
+    int edgeCount;
+    const int *edgeStart;           /* Edges of node n: edgeStart[n] .. edgeStart[n + 1] - 1 */
+    const unsigned short *edgeFrom;
+    const unsigned short *edgeTo;
+    const unsigned short *edgeLen;  /* Tiles driven from one end to the other */
+    const unsigned short *edgeLink;
+    const unsigned short *nodeTile; /* y * WORLD_X + x */
+} RoadNetGraph;
+
+/* Tiles that carry traffic - roads, rail and their crossings */
+int IsRoadNetTile(int tile);
+
+/* Is the tile somewhere a trip from this zone type (0=res, 1=com,
+   2=ind) can end next to */
+int IsTripDestination(int zoneType, int tile);
+
+/* Called by setMapTile() for every tile change */
+void RoadNetTileChanged(int x, int y, int oldTile, int newTile);
+
+/* Rebuild the graph from the map - queries do this when it is stale */
+void RebuildRoadNet(void);
+
+/* Connected network the tile is on, 0 if it is not a network tile */
+int RoadNetComponent(int x, int y);
+
+/* Could a trip from this zone type starting on the tile reach a
+   destination at all */
+int RoadNetHasTripDestination(int x, int y, int zoneType);
+
+/* Fewest tiles driven between two network tiles, -1 if not connected */
+int RoadNetDistance(int x1, int y1, int x2, int y2);
+
+/* The graph, rebuilt first if it is stale */
+const RoadNetGraph *GetRoadNetGraph(void);
+
+/* Nodes a network tile leads to and how far: one for a node tile, both
+   ends for a tile along a run, whose link is stored (-1 for a node).
+   Returns how many ends, 0 if the tile is not on the network. */
+int RoadNetTileEnds(int x, int y, int *node, int *dist, int *link);
+
+/* Tiles along a link from its first node, the end nodes left out.
+   xs and ys need room for the link's length. Returns the count. */
+int RoadNetLinkTiles(int link, short *xs, short *ys);
+
+#endif /* _ROADNET_H */
@@ -3,6 +3,8 @@
  */
 
 #include "sim.h"
+#include "coverage.h"
+#include "minimap.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,21 +13,18 @@
 /* Internal state variables */
 static short CCx, CCy;             /* City center X and Y coordinates */
 static short CCx2, CCy2;           /* City center coordinates, divided by 2 */
-static short PolMaxX, PolMaxY;     /* Coordinates of highest pollution */
+short PolMaxX, PolMaxY;            /* Coordinates of highest pollution */
 static short CrimeMaxX, CrimeMaxY; /* Coordinates of highest crime */
 
 /* Temporary arrays for smoothing operations - reorganized for cache efficiency */
 static Byte tem[WORLD_Y / 2][WORLD_X / 2];  /* Temp array 1 for smoothing - row-major */
 static Byte tem2[WORLD_Y / 2][WORLD_X / 2]; /* Temp array 2 for smoothing - row-major */
-static Byte STem[WORLD_Y / 4][WORLD_X / 4]; /* Small temp array for fire/police map - row-major */
 static Byte Qtem[WORLD_Y / 4][WORLD_X / 4]; /* Quarter-size temp array - row-major */
 
 /* Function prototypes */
 static void ClrTemArray(void);
 static void DoSmooth(void);
 static void DoSmooth2(void);
-static void SmoothPSMap(void);
-static void SmoothFSMap(void);
 static void SmoothTerrain(void);
 static int GetDisCC(int x, int y);
 static int GetPValueLocal(int loc);
@@ -108,80 +107,6 @@ static void DoSmooth2(void) {
     }
 }
 
-/* Smooth the Police Station effect map */
-static void SmoothPSMap(void) {
-    int x, y, edge;
-
-    /* Quarter size map */
-    for (x = 0; x < WORLD_X / 4; x++) {
-        for (y = 0; y < WORLD_Y / 4; y++) {
-            edge = 0;
-
-            /* Add up surrounding cells */
-            if (x > 0) {
-                edge += PoliceMap[y][x - 1];
-            }
-            if (x < (WORLD_X / 4 - 1)) {
-                edge += PoliceMap[y][x + 1];
-            }
-            if (y > 0) {
-                edge += PoliceMap[y - 1][x];
-            }
-            if (y < (WORLD_Y / 4 - 1)) {
-                edge += PoliceMap[y + 1][x];
-            }
-
-            /* Original WiNTown smoothing algorithm */
-            edge = (edge >> 2) + PoliceMap[y][x];  /* (neighbors/4) + current */
-            STem[x][y] = (Byte)(edge >> 1);        /* divide by 2 - cast to Byte */
-        }
-    }
-
-    /* Copy back to original map */
-    for (x = 0; x < WORLD_X / 4; x++) {
-        for (y = 0; y < WORLD_Y / 4; y++) {
-            PoliceMap[y][x] = STem[x][y];
-        }
-    }
-}
-
-/* Smooth the Fire Station effect map */
-static void SmoothFSMap(void) {
-    int x, y, edge;
-
-    /* Quarter size map */
-    for (x = 0; x < WORLD_X / 4; x++) {
-        for (y = 0; y < WORLD_Y / 4; y++) {
-            edge = 0;
-
-            /* Add up surrounding cells */
-            if (x > 0) {
-                edge += FireStMap[y][x - 1];
-            }
-            if (x < (WORLD_X / 4 - 1)) {
-                edge += FireStMap[y][x + 1];
-            }
-            if (y > 0) {
-                edge += FireStMap[y - 1][x];
-            }
-            if (y < (WORLD_Y / 4 - 1)) {
-                edge += FireStMap[y + 1][x];
-            }
-
-            /* Original WiNTown smoothing algorithm */
-            edge = (edge >> 2) + FireStMap[y][x];  /* (neighbors/4) + current */
-            STem[x][y] = (Byte)(edge >> 1);        /* divide by 2 - cast to Byte */
-        }
-    }
-
-    /* Copy back to original map */
-    for (x = 0; x < WORLD_X / 4; x++) {
-        for (y = 0; y < WORLD_Y / 4; y++) {
-            FireStMap[y][x] = STem[x][y];
-        }
-    }
-}
-
 /* Smooth terrain map */
 static void SmoothTerrain(void) {
     int x, y, z;
@@ -312,19 +237,12 @@ static void DistIntMarket(void) {
 
 /* Fire effect analysis - spread fire station coverage */
 void FireAnalysis(void) {
-    int x, y;
-
-    /* Smooth the fire station map three times - original algorithm */
-    SmoothFSMap();
-    SmoothFSMap();
-    SmoothFSMap();
+    /* Coverage from every fire station, summarised into FireStMap */
+    BuildCoverage(COVERAGE_FIRE);
 
     /* Copy to fire rate map */
-    for (x = 0; x < WORLD_X / 4; x++) {
-        for (y = 0; y < WORLD_Y / 4; y++) {
-            FireRate[y][x] = FireStMap[y][x];
-        }
-    }
+    memcpy(FireRate, FireStMap, sizeof(FireRate));
+    MinimapOverlayChanged(MINIMAP_MODE_FIRE);
 }
 
 /* Do population density scan */
@@ -372,6 +290,7 @@ void PopDenScan(void) {
             PopDensity[y][x] = (Byte)(tem2[x][y] << 1);
         }
     }
+    MinimapOverlayChanged(MINIMAP_MODE_POPULATION);
 
     /* Set commercial rate based on center of city */
     DistIntMarket();
@@ -529,6 +448,9 @@ void PTLScan(void) {
 
     /* Smooth terrain */
     SmoothTerrain();
+
+    MinimapOverlayChanged(MINIMAP_MODE_POLLUTION);
+    MinimapOverlayChanged(MINIMAP_MODE_LANDVALUE);
 }
 
 /* Scan crime map */
@@ -537,10 +459,8 @@ void CrimeScan(void) {
     QUAD totz;
     int x, y, z;
 
-    /* Smooth police station effect map three times - original algorithm */
-    SmoothPSMap();
-    SmoothPSMap();
-    SmoothPSMap();
+    /* Coverage from every police station, summarised into PoliceMap */
+    BuildCoverage(COVERAGE_POLICE);
 
     totz = 0;
     numz = 0;
@@ -562,8 +482,10 @@ void CrimeScan(void) {
                     z = 300;
                 }
 
-                /* Police stations reduce crime */
-                z -= PoliceMap[y >> 2][x >> 2];
+                /* Police stations reduce crime - average over the 2x2 tiles */
+                z -= (PoliceCoverage[y << 1][x << 1] + PoliceCoverage[y << 1][(x << 1) + 1] +
+                      PoliceCoverage[(y << 1) + 1][x << 1] +
+                      PoliceCoverage[(y << 1) + 1][(x << 1) + 1]) >> 2;
 
                 /* Ensure crime values are in range 0-250 */
                 if (z > 250) {
@@ -600,9 +522,8 @@ void CrimeScan(void) {
     }
 
     /* Copy police map to effect map */
-    for (x = 0; x < WORLD_X / 4; x++) {
-        for (y = 0; y < WORLD_Y / 4; y++) {
-            PoliceMapEffect[y][x] = PoliceMap[y][x];
-        }
-    }
+    memcpy(PoliceMapEffect, PoliceMap, sizeof(PoliceMapEffect));
+
+    MinimapOverlayChanged(MINIMAP_MODE_CRIME);
+    MinimapOverlayChanged(MINIMAP_MODE_POLICE);
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 #include "sim.h"
 #include "sprite.h"
+#include "coverage.h"
+#include "journal.h"
 #include "notify.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -59,6 +61,7 @@ int loadScenario(int scenarioId) {
 
     /* Reset city filename */
     cityFileName[0] = '\0';
+    CloseJournal();
 
     GameLevel = 0; /* Set game level to easy */
 
@@ -284,6 +287,12 @@ int loadScenario(int scenarioId) {
     /* Initialize sprite system for animations and transportation */
     InitSprites();
 
+    /* Clear any flood left over from the previous city */
+    ResetFlood();
+
+    /* Forget police and fire stations from the previous city */
+    ResetCoverage();
+
     /* Initialize evaluation system */
     EvalInit();
 
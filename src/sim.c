@@ -5,7 +5,16 @@
 #include "sim.h"
 #include "tiles.h"
 #include "sprite.h"
+#include "coverage.h"
 #include "charts.h"
+#include "census.h"
+#include "planes.h"
+#include "events.h"
+#include "statehash.h"
+#include "profile.h"
+#include "trafflow.h"
+#include "lod.h"
+#include "minimap.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -63,7 +72,7 @@ extern short ScoreWait;
 extern void scenarioDisaster(void);
 extern void DoScenarioScore(void);
 
-/* Zone population totals for SendMessages */
+/* Zone counts for SendMessages - kept by census.c */
 int TotalZPop = 0;
 int ResZPop = 0;
 int ComZPop = 0;
@@ -115,12 +124,15 @@ int StadiumPop = 0;
 int PortPop = 0;
 int APortPop = 0;
 int NuclearPop = 0;
+int HospPop = 0;
 
 /* External effects */
 int RoadEffect = 0;
 int PoliceEffect = 1000;  /* Back to original values for debugging */
 int FireEffect = 1000;    /* Back to original values for debugging */
 int TrafficAverage = 0;
+long DevTrfTotal = 0;
+int DevTrfCount = 0;
 int PollutionAverage = 0;
 int CrimeAverage = 0;
 int LVAverage = 0;
@@ -152,16 +164,30 @@ static int TMapX, TMapY;
 static short CChr;
 static short CChr9;
 
-/* Random number generator - Windows compatible */
+/* Random number generator - the same sequence as the MSVC runtime rand(),
+ * but with a state the journal can record and restore */
+static unsigned long SimRandState = 12345;
+unsigned long SimRandomDraws = 0;
+
 void RandomlySeedRand(void) {
     /* Using a fixed seed of 12345 gives more consistent results while still allowing variation */
     static int fixedSeed = 12345;
-    srand((unsigned int)fixedSeed);
+    SimRandState = (unsigned long)fixedSeed;
 }
 
 /* Public random number function - available to other modules */
 int SimRandom(int range) {
-    return (rand() % range);
+    SimRandState = (SimRandState * 214013UL + 2531011UL) & 0xFFFFFFFFUL;
+    SimRandomDraws++;
+    return (int)((SimRandState >> 16) & 0x7FFF) % range;
+}
+
+unsigned long GetSimRandomState(void) {
+    return SimRandState;
+}
+
+void SetSimRandomState(unsigned long state) {
+    SimRandState = state & 0xFFFFFFFFUL;
 }
 
 void DoSimInit(void) {
@@ -178,10 +204,11 @@ void DoSimInit(void) {
     oldCityPop = CityPop;
     oldCityClass = CityClass;
     
-    /* Reset tile logging to overwrite the log file */
-#ifdef TILE_DEBUG
+    /* Restart the tile trace and hash log so they cover only this city */
     resetTileLogging();
-#endif
+    if (stateHashLogging) {
+        StartStateHashLog(NULL);
+    }
 
     /* Clear all the density maps */
     memset(PopDensity, 0, sizeof(PopDensity));
@@ -218,6 +245,9 @@ void DoSimInit(void) {
         }
     }
 
+    /* The minimap redraws every overlay from the cleared maps */
+    MinimapOverlaysChanged();
+
     /* Clear power status from all tiles */
     for (y = 0; y < WORLD_Y; y++) {
         for (x = 0; x < WORLD_X; x++) {
@@ -273,6 +303,15 @@ void DoSimInit(void) {
     /* Initialize sprite system */
     InitSprites();
 
+    /* Clear any flood left over from the previous city */
+    ResetFlood();
+
+    /* Forget police and fire stations from the previous city */
+    ResetCoverage();
+
+    /* Drop messages still queued for the previous city */
+    ResetEvents();
+
     /* Generate a random disaster wait period */
     DisasterWait = SimRandom(51) + 49;
 
@@ -329,8 +368,17 @@ void SimFrame(void) {
     }
 }
 
+/* Profiler scope names for the sixteen simulation phases */
+static const char *SimulatePhaseNames[16] = {
+    "Simulate 0",  "Simulate 1",  "Simulate 2",  "Simulate 3",
+    "Simulate 4",  "Simulate 5",  "Simulate 6",  "Simulate 7",
+    "Simulate 8",  "Simulate 9",  "Simulate 10", "Simulate 11",
+    "Simulate 12", "Simulate 13", "Simulate 14", "Simulate 15"
+};
+
 void Simulate(int mod16) {
     /* Main simulation logic */
+    PROFILE_BEGIN(SimulatePhaseNames[mod16]);
 
     /* Perform different actions based on the cycle position (mod 16) */
     switch (mod16) {
@@ -357,14 +405,17 @@ void Simulate(int mod16) {
         /* Power scan moved to case 11 to avoid duplicate calls */
 
         /* Process tile animations */
+        PROFILE_BEGIN("AnimateTiles");
         AnimateTiles();
+        PROFILE_END("AnimateTiles");
 
         /* Move transportation sprites */
+        PROFILE_BEGIN("MoveSprites");
         MoveSprites();
+        PROFILE_END("MoveSprites");
         
-        /* Original WiNTown message system */
+        /* Original WiNTown message system - delivered by DispatchEvents() */
         SendMessages();
-        doMessage();
         break;
 
     case 1:
@@ -389,12 +440,11 @@ void Simulate(int mod16) {
     case 6:
     case 7:
     case 8:
-        /* Scan map in 8 different segments (1/8th each time) */
-        {
-            int xs = (mod16 - 1) * (WORLD_X / 8);
-            int xe = xs + (WORLD_X / 8);
-            MapScan(xs, xe, 0, WORLD_Y);
-        }
+        /* Scan map in 8 different segments (1/8th each time), quiet
+           blocks at a reduced rate when LOD is on */
+        PROFILE_BEGIN("MapScan");
+        LodMapScan(mod16 - 1);
+        PROFILE_END("MapScan");
         break;
 
     case 9:
@@ -420,6 +470,7 @@ void Simulate(int mod16) {
                     }
                 }
             }
+            MinimapOverlayChanged(MINIMAP_MODE_POLICE);
             if (totalCoverage > 0) {
                 addDebugLog("POLICE MAP: Total=%d Max=%d Stations=%d", totalCoverage, maxCoverage, PolicePop);
             } else if (PolicePop > 0) {
@@ -446,19 +497,31 @@ void Simulate(int mod16) {
         if ((CityTime % TAXFREQ) == 0) {
             addDebugLog("Tax collection triggered: CityTime=%d, TAXFREQ=%d", CityTime, TAXFREQ);
             CollectTax();        /* Collect taxes based on population */
-            CountSpecialTiles(); /* Count special buildings */
+#ifdef CENSUS_DEBUG
+            VerifyCensusTiles(); /* Cross-check the running counts */
+#endif
+#ifdef PLANES_DEBUG
+            VerifyPlanes();      /* Cross-check the bitplanes */
+#endif
             CityEvaluation();    /* Evaluate city conditions */
+            if (GetSimLod()) {
+                addDebugLog("LOD: %d of %d blocks at full detail", LodDetailBlocks(),
+                            LOD_BLOCKS_X * LOD_BLOCKS_Y);
+            }
         }
         break;
 
     case 10:
-        /* Process traffic decrease & other tile updates */
-        DecTrafficMap();
+        /* The link engine assigns the trips the zones queued since last time */
+        if (GetTrafficEngine() == TRAFFIC_ENGINE_FLOW) {
+            PROFILE_BEGIN("AssignTrafficFlow");
+            AssignTrafficFlow();
+            PROFILE_END("AssignTrafficFlow");
+        }
 
-        /* Calculate traffic average periodically */
+        /* Decay traffic, refreshing the average and road animation every 4th pass */
+        UpdateTrafficMap((Scycle % 4) == 0);
         if ((Scycle % 4) == 0) {
-            CalcTrafficAverage();
-
             /* Log traffic */
             if (TrafficAverage > 100) {
                 addDebugLog("Traffic level: %d (Heavy)", TrafficAverage);
@@ -470,12 +533,16 @@ void Simulate(int mod16) {
         /* CityPop is updated in case 9 when population counters change - no need to recalculate */
 
         /* Run animations for smoother motion */
+        PROFILE_BEGIN("AnimateTiles");
         AnimateTiles();
+        PROFILE_END("AnimateTiles");
         break;
 
     case 11:
         /* Process power grid updates */
+        PROFILE_BEGIN("DoPowerScan");
         DoPowerScan();
+        PROFILE_END("DoPowerScan");
 
         /* Generate transportation sprites */
         GenerateTrains();
@@ -519,7 +586,9 @@ void Simulate(int mod16) {
     case 12:
         /* Process pollution spread (at a reduced rate) */
         if ((Scycle % 16) == 12) {
+            PROFILE_BEGIN("PTLScan");
             PTLScan(); /* Do pollution, terrain, and land value */
+            PROFILE_END("PTLScan");
 
             /* Log pollution and land value */
             addDebugLog("Pollution average: %d", PollutionAverage);
@@ -533,13 +602,17 @@ void Simulate(int mod16) {
         }
 
         /* Process tile animations more frequently for smoother motion */
+        PROFILE_BEGIN("AnimateTiles");
         AnimateTiles();
+        PROFILE_END("AnimateTiles");
         break;
 
     case 13:
         /* Process crime spread (at a reduced rate) */
         if ((Scycle % 4) == 1) {
+            PROFILE_BEGIN("CrimeScan");
             CrimeScan(); /* Do crime map analysis */
+            PROFILE_END("CrimeScan");
 
             /* Log crime level */
             if (CrimeAverage > 100) {
@@ -553,8 +626,12 @@ void Simulate(int mod16) {
     case 14:
         /* Process population density (at a reduced rate) */
         if ((Scycle % 16) == 14) {
+            PROFILE_BEGIN("PopDenScan");
             PopDenScan();   /* Do population density scan */
+            PROFILE_END("PopDenScan");
+            PROFILE_BEGIN("FireAnalysis");
             FireAnalysis(); /* Update fire protection effect */
+            PROFILE_END("FireAnalysis");
         }
         break;
 
@@ -572,6 +649,9 @@ void Simulate(int mod16) {
             }
         }
 
+        /* Spread or drain any active flood */
+        DoFlood();
+
         /* Process disasters */
         addDebugLog("DISASTER CHECK: Event=%d, Disabled=%d, Case=15", DisasterEvent, disastersDisabled);
         if (DisasterEvent && !disastersDisabled) {
@@ -598,9 +678,16 @@ void Simulate(int mod16) {
         }
 
         /* Process tile animations again at the end of the cycle */
+        PROFILE_BEGIN("AnimateTiles");
         AnimateTiles();
+        PROFILE_END("AnimateTiles");
+
+        /* Fingerprint the state for comparing runs */
+        StateHashCycle();
         break;
     }
+
+    PROFILE_END(SimulatePhaseNames[mod16]);
 }
 
 void DoTimeStuff(void) {
@@ -829,22 +916,14 @@ void ClearCensus(void) {
     PrevResPop = ResPop;
     PrevCityPop = (int)CityPop;
 
-    /* Log infrastructure counts before resetting */
+    /* Log infrastructure counts */
     addDebugLog("Infrastructure: Roads=%d Rail=%d Fire=%d Police=%d", RoadTotal, RailTotal, FirePop,
                 PolicePop);
     addDebugLog("Special zones: Stadium=%d Port=%d Airport=%d Nuclear=%d", StadiumPop, PortPop,
                 APortPop, NuclearPop);
     addDebugLog("Power: Powered=%d Unpowered=%d", PwrdZCnt, UnpwrdZCnt);
 
-    /* Infrastructure counts always need resetting */
-    RoadTotal = 0;
-    RailTotal = 0;
-    FirePop = 0;
-    PolicePop = 0;
-    StadiumPop = 0;
-    PortPop = 0;
-    APortPop = 0;
-    NuclearPop = 0;
+    /* Infrastructure and zone counts are kept by census.c as tiles change - do not reset here */
     /* Power zone counts are managed exclusively by DoPowerScan() - do not reset here */
 
     /* Fire and police maps are now cleared in case 1 before map scanning */
@@ -1015,24 +1094,20 @@ void TakeCensus(void) {
 void MapScan(int x1, int x2, int y1, int y2) {
     /* Scan a section of the map for zone processing - optimized version */
     int x, y;
-    short fullTile;
 
     if (x1 < 0 || x2 > WORLD_X || y1 < 0 || y2 > WORLD_Y) {
         return;
     }
 
-    /* Process row by row for better cache locality */
+    /* Visit only zone centers. The plane is read live, so a zone DoZone
+       builds further along the row is still reached in this pass. */
     for (y = y1; y < y2; y++) {
-        for (x = x1; x < x2; x++) {
-            fullTile = Map[y][x]; /* Single memory access */
-            
-            /* Only process zones to reduce overhead */
-            if (fullTile & ZONEBIT) {
-                SMapX = x;
-                SMapY = y;
-                CChr = fullTile & LOMASK;
-                DoZone(x, y, CChr);
-            }
+        for (x = PlaneNextBit(PLANE_ZONE, y, x1, x2); x >= 0;
+             x = PlaneNextBit(PLANE_ZONE, y, x + 1, x2)) {
+            SMapX = x;
+            SMapY = y;
+            CChr = TileIdPlane[y][x];
+            DoZone(x, y, CChr);
         }
     }
 }
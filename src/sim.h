@@ -10,16 +10,8 @@
 /* External declaration for UpdateToolbar function */
 extern void UpdateToolbar(void);
 
-/* Message system variables - like original WiNTown */
-extern int MessagePort;
-extern int MesX, MesY;
-extern int MesNum;
-extern int LastPicNum;
-extern DWORD LastMesTime;
-
-/* Message system functions */
+/* Message system functions - messages are published on the event bus (events.h) */
 void SendMessages(void);
-void doMessage(void);
 int SendMes(int Mnum);
 void SendMesAt(int Mnum, int x, int y);
 void ClearMes(void);
@@ -398,13 +390,21 @@ extern int StadiumPop;   /* Number of stadium tiles */
 extern int PortPop;      /* Number of seaport tiles */
 extern int APortPop;     /* Number of airport tiles */
 extern int NuclearPop;   /* Number of nuclear plant tiles */
+extern int CoalPop;      /* Number of coal plant zones */
+extern int HospPop;      /* Number of hospital zones */
+extern int ResZPop;      /* Number of residential zones */
+extern int ComZPop;      /* Number of commercial zones */
+extern int IndZPop;      /* Number of industrial zones */
 
 /* External effects */
 extern int RoadEffect;   /* Road maintenance effectiveness (a function of funding) */
 extern int PoliceEffect; /* Police effectiveness */
 extern int FireEffect;   /* Fire department effectiveness */
 extern int TrafficAverage; /* Average traffic */
+extern long DevTrfTotal;   /* Traffic summed over developed land - set by CalcTrafficAverage */
+extern int DevTrfCount;    /* Developed land cells in DevTrfTotal */
 extern int PollutionAverage; /* Average pollution */
+extern short PolMaxX, PolMaxY; /* Tile with the highest pollution - set by PTLScan */
 extern int CrimeAverage; /* Average crime */
 extern int LVAverage;    /* Average land value */
 
@@ -419,6 +419,10 @@ extern short DisasterEvent; /* Current disaster type (0=none) - defined in scena
 extern short DisasterWait;  /* Countdown to next disaster - defined in scenarios.c */
 extern int DisasterLevel;   /* Disaster level */
 extern int DisastersEnabled; /* Enable/disable disasters (0=disabled, 1=enabled) */
+extern int FloodSpreadBudget; /* Flood frontier tiles expanded per cycle - defined in disastr.c */
+extern int FloodRecedeBudget; /* Flooded tiles drained per cycle */
+extern int FloodRiseCycles;   /* Cycles a flood keeps rising */
+extern int FloodMaxTiles;     /* Largest area a single flood may cover */
 
 /* Difficulty level multiplier tables - based on original WiNTown */
 extern float DifficultyTaxEfficiency[3];     /* Tax revenue multipliers [Easy, Medium, Hard] */
@@ -452,6 +456,33 @@ int CalculateTotalPopulation(int resPop, int comPop, int indPop);
 #define BUDGET_TYPE_ROAD        0
 #define BUDGET_TYPE_POLICE      1
 #define BUDGET_TYPE_FIRE        2
+#define BUDGET_TYPES            3
+
+/* Power engines - how DoPowerScan() finds the powered tiles */
+#define POWER_ENGINE_WALK  0  /* Original walker along the lines, one tile at a time */
+#define POWER_ENGINE_FLOOD 1  /* Word-wide flood fill over the flag bitplanes */
+
+/* Traffic engines - how MakeTraffic() sends zone trips onto the roads */
+#define TRAFFIC_ENGINE_WALK 0  /* Original random walk, one trip at a time */
+#define TRAFFIC_ENGINE_FLOW 1  /* Batched link assignment over the road graph */
+
+/* Budget policies - how DoBudget() divides the money between services */
+#define BUDGET_POLICY_INTERACTIVE  0  /* Ask the player on a shortfall, then fund by priority */
+#define BUDGET_POLICY_PROPORTIONAL 1  /* Cut every service by the same fraction */
+#define BUDGET_POLICY_PRIORITY     2  /* Roads, then fire, then police */
+#define BUDGET_POLICY_RESERVE      3  /* Proportional, keeping a reserve in the treasury */
+#define BUDGET_POLICY_CALLBACK     4  /* Allocation decided by SetBudgetPolicyCallback() */
+
+/* One budget decision - amounts indexed by BUDGET_TYPE_* */
+typedef struct {
+    QUAD fund[BUDGET_TYPES];     /* Full funding requirement */
+    QUAD request[BUDGET_TYPES];  /* Requirement scaled by the funding percentage */
+    QUAD total;                  /* Sum of the requests */
+    QUAD available;              /* Tax income plus treasury */
+    QUAD spend[BUDGET_TYPES];    /* Allocation - filled in by the policy */
+} BudgetRequest;
+
+typedef void (*BudgetPolicyProc)(BudgetRequest *req, void *userData);
 
 /* Unified population management functions */
 void AddToZonePopulation(int zoneType, int amount);
@@ -476,6 +507,10 @@ void TogglePause(void);
 
 /* Functions implemented in zone.c */
 void DoZone(int Xloc, int Yloc, int pos);
+void ZoneTileChanged(int x, int y, int oldTile, int newTile);
+void SetZoneSleep(int enabled);  /* Let settled zones skip unchanged evaluations */
+int GetZoneSleep(void);
+void SetZoneDuePasses(int passes); /* Passes the next MapScan stands in for, 1 normally */
 int calcResPop(int zone);   /* Calculate residential zone population */
 int calcComPop(int zone);   /* Calculate commercial zone population */
 int calcIndPop(int zone);   /* Calculate industrial zone population */
@@ -483,18 +518,26 @@ int calcIndPop(int zone);   /* Calculate industrial zone population */
 /* Power-related variables and functions - power.c */
 extern int SMapX;             /* Current map X position for power scan */
 extern int SMapY;             /* Current map Y position for power scan */
-void CountPowerPlants(void);
 void QueuePowerPlant(int x, int y);
 void FindPowerPlants(void);
 void DoPowerScan(void);
+void SetPowerEngine(int engine);   /* Select a POWER_ENGINE_* for DoPowerScan */
+int GetPowerEngine(void);          /* Current power engine */
 
 /* Traffic-related functions - traffic.c */
 int MakeTraffic(int zoneType);
 int FindPRoad(void);
+void RoadMaskTileChanged(int x, int y, int oldTile, int newTile);
 void DecTrafficMap(void);
 void CalcTrafficAverage(void);
+void UpdateTrafficMap(int average); /* Decay, plus the average when asked, in one pass */
+void SetTrafficEngine(int engine); /* Select a TRAFFIC_ENGINE_* for MakeTraffic */
+int GetTrafficEngine(void);        /* Current traffic engine */
 void RandomlySeedRand(void); /* Initialize random number generator */
 int SimRandom(int range);  /* Random number function used by traffic system */
+unsigned long GetSimRandomState(void); /* Generator state, for the journal */
+void SetSimRandomState(unsigned long state);
+extern unsigned long SimRandomDraws; /* Numbers drawn since startup */
 
 /* Scanner-related functions - scanner.c */
 void FireAnalysis(void);    /* Fire station effect analysis */
@@ -505,7 +548,6 @@ void CrimeScan(void);       /* Crime level scan */
 /* Evaluation-related functions - evaluation.c */
 void EvalInit(void);           /* Initialize evaluation system */
 void CityEvaluation(void);     /* Perform city evaluation */
-void CountSpecialTiles(void);  /* Count special building types */
 const char* GetProblemText(int problemIndex);  /* Get problem description */
 const char* GetCityClassName(void);            /* Get city class name */
 void GetTopProblems(short problems[4]);        /* Get top problems list */
@@ -541,6 +583,10 @@ void SetRoadPercent(float percent);      /* Set road funding percentage */
 void SetPolicePercent(float percent);    /* Set police funding percentage */
 void SetFirePercent(float percent);      /* Set fire department funding percentage */
 void SetBudgetPercent(int budgetType, float percent);  /* Unified budget percentage setter */
+void SetBudgetPolicy(int policy);        /* Select a BUDGET_POLICY_* allocator */
+int GetBudgetPolicy(void);               /* Current budget policy */
+void SetBudgetPolicyCallback(BudgetPolicyProc proc, void *userData); /* Custom allocator */
+void SetBudgetReserve(QUAD reserve);     /* Treasury floor for BUDGET_POLICY_RESERVE */
 
 /* Scenario functions (scenarios.c) */
 int loadScenario(int scenarioId);        /* Load a scenario by ID */
@@ -550,6 +596,9 @@ void DoScenarioScore(void);              /* Evaluate scenario victory conditions
 /* Disaster functions (disasters.c) */
 void doEarthquake(void);                 /* Create an earthquake */
 void makeFlood(void);                    /* Create a flood */
+void DoFlood(void);                      /* Spread or drain an active flood */
+void ResetFlood(void);                   /* Clear all flood state */
+int GetFloodTileCount(void);             /* Tiles currently under flood water */
 void makeFire(int x, int y);             /* Start a fire */
 void spreadFire(void);                   /* Check for and spread fires */
 void makeMonster(void);                  /* Create a monster */
@@ -0,0 +1,103 @@
+/* spawn.c - Spawn point registry for WiNTown
+ * One list per kind with a per-tile slot, so tiles are added and dropped
+ * in O(1) as they change and a pick is a single random index. Like the
+ * census, the lists start empty to match the all-dirt map.
+ */
+
+#include "sim.h"
+#include "spawn.h"
+
+/* Packed y * WORLD_X + x indices of each kind */
+static unsigned short SpawnList[SPAWN_KINDS][WORLD_X * WORLD_Y];
+static int SpawnCount[SPAWN_KINDS];
+
+/* Slot in its kind's list plus one, 0 when the tile is not listed */
+static unsigned short SpawnSlot[WORLD_Y][WORLD_X];
+
+/* Kind a tile is listed under, or -1 */
+static int SpawnKind(int tile) {
+    tile &= LOMASK;
+    if (tile >= RAILBASE && tile <= LASTRAIL) {
+        return SPAWN_RAIL;
+    }
+    if (tile >= PORTBASE && tile <= LASTPORT) {
+        return SPAWN_PORT;
+    }
+    if (tile >= AIRPORTBASE && tile <= AIRPORT) {
+        return SPAWN_AIRPORT;
+    }
+    return -1;
+}
+
+/* Is the tile in its slot of this kind's list */
+static int SpawnListed(int kind, int x, int y) {
+    int slot;
+
+    slot = SpawnSlot[y][x] - 1;
+    return slot >= 0 && slot < SpawnCount[kind] &&
+           SpawnList[kind][slot] == (unsigned short)(y * WORLD_X + x);
+}
+
+static void RemoveSpawn(int kind, int x, int y) {
+    int slot;
+    unsigned short last;
+
+    if (!SpawnListed(kind, x, y)) {
+        return;
+    }
+    slot = SpawnSlot[y][x] - 1;
+    last = SpawnList[kind][--SpawnCount[kind]];
+    SpawnList[kind][slot] = last;
+    SpawnSlot[last / WORLD_X][last % WORLD_X] = (unsigned short)(slot + 1);
+    SpawnSlot[y][x] = 0;
+}
+
+static void AddSpawn(int kind, int x, int y) {
+    if (SpawnListed(kind, x, y)) {
+        return;
+    }
+    SpawnList[kind][SpawnCount[kind]] = (unsigned short)(y * WORLD_X + x);
+    SpawnSlot[y][x] = (unsigned short)(++SpawnCount[kind]);
+}
+
+/* Called by setMapTile() for every tile change. Adding and removing are
+   idempotent and go by the new tile rather than the old one, so the lists
+   hold each tile at most once, under its current kind. */
+void SpawnTileChanged(int x, int y, int oldTile, int newTile) {
+    int kind, newKind;
+
+    newKind = SpawnKind(newTile);
+    if (newKind < 0 ? !SpawnSlot[y][x] : SpawnListed(newKind, x, y)) {
+        return;
+    }
+
+    for (kind = 0; kind < SPAWN_KINDS; kind++) {
+        if (kind != newKind) {
+            RemoveSpawn(kind, x, y);
+        }
+    }
+    if (newKind >= 0) {
+        AddSpawn(newKind, x, y);
+    } else {
+        SpawnSlot[y][x] = 0;
+    }
+}
+
+int GetSpawnCount(int kind) {
+    if (kind < 0 || kind >= SPAWN_KINDS) {
+        return 0;
+    }
+    return SpawnCount[kind];
+}
+
+int PickSpawnPoint(int kind, int *x, int *y) {
+    unsigned short index;
+
+    if (GetSpawnCount(kind) == 0) {
+        return 0;
+    }
+    index = SpawnList[kind][SimRandom(SpawnCount[kind])];
+    *x = index % WORLD_X;
+    *y = index / WORLD_X;
+    return 1;
+}
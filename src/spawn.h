@@ -0,0 +1,25 @@
+/* spawn.h - Spawn point registry for WiNTown
+ * Rail, seaport and airport tiles kept in lists from setMapTile(), so
+ * trains, ships and aircraft can pick a uniformly random start tile
+ * without sweeping the map
+ */
+
+#ifndef _SPAWN_H
+#define _SPAWN_H
+
+/* Spawn point kinds */
+#define SPAWN_RAIL    0 /* RAILBASE..LASTRAIL */
+#define SPAWN_PORT    1 /* PORTBASE..LASTPORT */
+#define SPAWN_AIRPORT 2 /* AIRPORTBASE..AIRPORT */
+#define SPAWN_KINDS   3
+
+/* Called by setMapTile() for every tile change */
+void SpawnTileChanged(int x, int y, int oldTile, int newTile);
+
+/* Tiles of a kind on the map */
+int GetSpawnCount(int kind);
+
+/* Uniformly random tile of a kind. Returns 0 if there is none. */
+int PickSpawnPoint(int kind, int *x, int *y);
+
+#endif /* _SPAWN_H */
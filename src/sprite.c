@@ -5,14 +5,38 @@
 
 #include "sprite.h"
 #include "sim.h"
+#include "water.h"
+#include "spawn.h"
 #include <stdlib.h>
 
 /* External cheat flags */
 extern int disastersDisabled;
 
-/* Sprite globals */
-static SimSprite GlobalSprites[MAX_SPRITES];
+/* Sprite pool - blocks of slots allocated on first use and kept for reuse */
+static SimSprite *SpriteBlocks[MAX_SPRITE_BLOCKS];
+static int SpriteSlotCount = 0;     /* Slots handed out so far */
+static int SpriteFreeHead = -1;     /* First slot on the free list */
+static short SpriteFreeNext[MAX_SPRITES];
 static int SpriteCount = 0;
+int SpriteLimit = DEFAULT_SPRITE_LIMIT;
+
+/* Per-type update batches (slot indices), compacted after each update pass */
+static short SpriteBatch[SPRITE_TYPE_COUNT][MAX_SPRITES];
+static int SpriteBatchCount[SPRITE_TYPE_COUNT];
+
+/* Uniform grid spatial hash, in pixels */
+#define SPRITE_CELL_SHIFT   6       /* 64 pixel cells */
+#define SPRITE_GRID_ORIGIN  128     /* Sprites may wander this far off the map */
+#define SPRITE_GRID_W       ((((WORLD_X << 4) + 2 * SPRITE_GRID_ORIGIN) >> SPRITE_CELL_SHIFT) + 1)
+#define SPRITE_GRID_H       ((((WORLD_Y << 4) + 2 * SPRITE_GRID_ORIGIN) >> SPRITE_CELL_SHIFT) + 1)
+#define SPRITE_GRID_SLACK   16      /* Movement allowed between grid rebuilds */
+
+static short SpriteCellHead[SPRITE_GRID_H][SPRITE_GRID_W];
+static short SpriteCellNext[MAX_SPRITES];
+static short SpriteCellOf[MAX_SPRITES];  /* Cell a slot is linked into, or -1 */
+
+#define SPRITE_SLOT(i) (&SpriteBlocks[(i) / SPRITE_BLOCK_SIZE][(i) % SPRITE_BLOCK_SIZE])
+
 static short CrashX, CrashY;
 static int SpriteCycle = 0;
 
@@ -38,8 +62,6 @@ static short TrainPic2[5] = {1, 2, 1, 2, 5};
 /* Turn direction table for sprite navigation */
 static short Dir2Tab[16] = {0, 1, 2, 3, 4, 7, 6, 5, 0, 0, 0, 0, 0, 0, 0, 0};
 
-/* Water navigation clear table */
-static short BtClrTab[8] = {RIVER, CHANNEL, POWERBASE, POWERBASE+1, RAILBASE, RAILBASE+1, BRWH, BRWV};
 
 /* Forward declarations */
 static int GetDirection(int orgX, int orgY, int desX, int desY);
@@ -52,60 +74,71 @@ static void ExplodeSprite(SimSprite *sprite);
 static void MakeSound(int soundId, int x, int y);
 static short TryOther(int x, int y, int dir, SimSprite *sprite);
 static void CheckCollisions(SimSprite *sprite);
-static int IsWater(short tile);
+static int ShipOnWater(int x, int y);
+static void GridInsert(SimSprite *sprite);
+static void RebuildSpriteGrid(void);
+static void SweepSprites(void);
 
 /* Initialize sprite system */
 void InitSprites(void) {
     int i;
     
-    for (i = 0; i < MAX_SPRITES; i++) {
-        GlobalSprites[i].type = SPRITE_UNDEFINED;
-        GlobalSprites[i].frame = 0;
-        GlobalSprites[i].x = 0;
-        GlobalSprites[i].y = 0;
-        GlobalSprites[i].width = 0;
-        GlobalSprites[i].height = 0;
-        GlobalSprites[i].x_offset = 0;
-        GlobalSprites[i].y_offset = 0;
-        GlobalSprites[i].x_hot = 0;
-        GlobalSprites[i].y_hot = 0;
-        GlobalSprites[i].orig_x = 0;
-        GlobalSprites[i].orig_y = 0;
-        GlobalSprites[i].dest_x = 0;
-        GlobalSprites[i].dest_y = 0;
-        GlobalSprites[i].count = 0;
-        GlobalSprites[i].sound_count = 0;
-        GlobalSprites[i].dir = 0;
-        GlobalSprites[i].new_dir = 0;
-        GlobalSprites[i].step = 0;
-        GlobalSprites[i].flag = 0;
-        GlobalSprites[i].control = -1;
-        GlobalSprites[i].turn = 0;
-        GlobalSprites[i].accel = 0;
-        GlobalSprites[i].speed = DEFAULT_SPRITE_SPEED;
+    for (i = 0; i < SpriteSlotCount; i++) {
+        SPRITE_SLOT(i)->type = SPRITE_UNDEFINED;
     }
+    SpriteSlotCount = 0;
+    SpriteFreeHead = -1;
+    for (i = 0; i < SPRITE_TYPE_COUNT; i++) {
+        SpriteBatchCount[i] = 0;
+    }
+    RebuildSpriteGrid();
     
     SpriteCount = 0;
     SpriteCycle = 0;
 }
 
+/* Set how many sprites automatic generation keeps alive */
+void SetSpriteLimit(int limit) {
+    if (limit < 1) {
+        limit = 1;
+    }
+    if (limit > MAX_SPRITES) {
+        limit = MAX_SPRITES;
+    }
+    SpriteLimit = limit;
+}
+
 /* Create a new sprite */
 SimSprite* NewSprite(int type, int x, int y) {
     SimSprite *sprite;
     int i;
     
-    /* Find available sprite slot */
-    for (i = 0; i < MAX_SPRITES; i++) {
-        if (GlobalSprites[i].type == SPRITE_UNDEFINED) {
-            sprite = &GlobalSprites[i];
-            break;
+    if (type <= SPRITE_UNDEFINED || type >= SPRITE_TYPE_COUNT) {
+        return NULL;
+    }
+    
+    /* Take a slot from the free list, or hand out a fresh one */
+    if (SpriteFreeHead >= 0) {
+        i = SpriteFreeHead;
+        SpriteFreeHead = SpriteFreeNext[i];
+    } else if (SpriteSlotCount < MAX_SPRITES) {
+        i = SpriteSlotCount;
+        if (SpriteBlocks[i / SPRITE_BLOCK_SIZE] == NULL) {
+            SpriteBlocks[i / SPRITE_BLOCK_SIZE] =
+                (SimSprite *)malloc(SPRITE_BLOCK_SIZE * sizeof(SimSprite));
+            if (SpriteBlocks[i / SPRITE_BLOCK_SIZE] == NULL) {
+                return NULL;
+            }
         }
-    }
-    
-    if (i >= MAX_SPRITES) {
+        SpriteCellOf[i] = -1;
+        SpriteSlotCount++;
+    } else {
         return NULL; /* No available slots */
     }
     
+    sprite = SPRITE_SLOT(i);
+    sprite->slot = i;
+    
     /* Initialize sprite */
     sprite->type = type;
     sprite->x = x;
@@ -210,6 +243,9 @@ SimSprite* NewSprite(int type, int x, int y) {
             break;
     }
     
+    SpriteBatch[type][SpriteBatchCount[type]++] = (short)i;
+    GridInsert(sprite);
+    
     SpriteCount++;
     return sprite;
 }
@@ -224,7 +260,7 @@ void DestroySprite(SimSprite *sprite) {
 
 /* Update all sprites */
 void MoveSprites(void) {
-    int i;
+    int type, i;
     SimSprite *sprite;
     
     SpriteCycle++;
@@ -232,61 +268,196 @@ void MoveSprites(void) {
         SpriteCycle = 0;
     }
     
-    for (i = 0; i < MAX_SPRITES; i++) {
-        sprite = &GlobalSprites[i];
-        
-        if (sprite->type == SPRITE_UNDEFINED) {
-            continue;
+    RebuildSpriteGrid();
+    
+    /* Update one type at a time so each behaviour runs as a batch.
+     * Sprites created during the pass are appended and updated too. */
+    for (type = SPRITE_UNDEFINED + 1; type < SPRITE_TYPE_COUNT; type++) {
+        for (i = 0; i < SpriteBatchCount[type]; i++) {
+            sprite = SPRITE_SLOT(SpriteBatch[type][i]);
+            
+            if (sprite->type != type) {
+                continue; /* Destroyed earlier in this pass */
+            }
+            
+            /* Update sprite based on type */
+            switch (type) {
+                case SPRITE_TRAIN:
+                    DoTrainSprite(sprite);
+                    break;
+                    
+                case SPRITE_SHIP:
+                    DoShipSprite(sprite);
+                    break;
+                    
+                case SPRITE_AIRPLANE:
+                    DoAirplaneSprite(sprite);
+                    break;
+                    
+                case SPRITE_HELICOPTER:
+                    DoCopterSprite(sprite);
+                    break;
+                    
+                case SPRITE_BUS:
+                    DoBusSprite(sprite);
+                    break;
+                    
+                case SPRITE_POLICE:
+                    DoPoliceSprite(sprite);
+                    break;
+                    
+                case SPRITE_MONSTER:
+                    DoMonsterSprite(sprite);
+                    break;
+                    
+                case SPRITE_TORNADO:
+                    DoTornadoSprite(sprite);
+                    break;
+                    
+                case SPRITE_EXPLOSION:
+                    DoExplosion(sprite);
+                    break;
+            }
+            
+            if (sprite->type == SPRITE_UNDEFINED) {
+                continue;
+            }
+            
+            /* Check bounds */
+            if (SpriteNotInBounds(sprite)) {
+                if (sprite->type == SPRITE_AIRPLANE || sprite->type == SPRITE_HELICOPTER) {
+                    /* Aircraft can leave bounds temporarily */
+                    continue;
+                }
+                DestroySprite(sprite);
+            }
         }
-        
-        /* Update sprite based on type */
-        switch (sprite->type) {
-            case SPRITE_TRAIN:
-                DoTrainSprite(sprite);
-                break;
-                
-            case SPRITE_SHIP:
-                DoShipSprite(sprite);
-                break;
-                
-            case SPRITE_AIRPLANE:
-                DoAirplaneSprite(sprite);
-                break;
-                
-            case SPRITE_HELICOPTER:
-                DoCopterSprite(sprite);
-                break;
-                
-            case SPRITE_BUS:
-                DoBusSprite(sprite);
-                break;
-                
-            case SPRITE_POLICE:
-                DoPoliceSprite(sprite);
-                break;
-                
-            case SPRITE_MONSTER:
-                DoMonsterSprite(sprite);
-                break;
-                
-            case SPRITE_TORNADO:
-                DoTornadoSprite(sprite);
-                break;
-                
-            case SPRITE_EXPLOSION:
-                DoExplosion(sprite);
-                break;
+    }
+    
+    SweepSprites();
+}
+
+/* Drop destroyed sprites from the batches and return their slots */
+static void SweepSprites(void) {
+    int type, i, n;
+    short slot;
+    SimSprite *sprite;
+    
+    for (type = SPRITE_UNDEFINED + 1; type < SPRITE_TYPE_COUNT; type++) {
+        n = 0;
+        for (i = 0; i < SpriteBatchCount[type]; i++) {
+            slot = SpriteBatch[type][i];
+            sprite = SPRITE_SLOT(slot);
+            if (sprite->type == type) {
+                SpriteBatch[type][n++] = slot;
+            } else if (sprite->type == SPRITE_UNDEFINED) {
+                SpriteFreeNext[slot] = (short)SpriteFreeHead;
+                SpriteFreeHead = slot;
+            }
         }
-        
-        /* Check bounds */
-        if (SpriteNotInBounds(sprite)) {
-            if (sprite->type == SPRITE_AIRPLANE || sprite->type == SPRITE_HELICOPTER) {
-                /* Aircraft can leave bounds temporarily */
-                continue;
+        SpriteBatchCount[type] = n;
+    }
+}
+
+/* Grid cell coordinate for a pixel position, clamped to the grid */
+static int SpriteCell(int v, int cells) {
+    v = (v + SPRITE_GRID_ORIGIN) >> SPRITE_CELL_SHIFT;
+    if (v < 0) {
+        return 0;
+    }
+    if (v >= cells) {
+        return cells - 1;
+    }
+    return v;
+}
+
+/* Unlink a slot from the cell it was last linked into, if any. A reused
+ * slot can still sit in its old cell until the next rebuild. */
+static void GridUnlink(int slot) {
+    short *link;
+    
+    if (SpriteCellOf[slot] < 0) {
+        return;
+    }
+    link = &SpriteCellHead[SpriteCellOf[slot] / SPRITE_GRID_W][SpriteCellOf[slot] % SPRITE_GRID_W];
+    while (*link >= 0) {
+        if (*link == slot) {
+            *link = SpriteCellNext[slot];
+            break;
+        }
+        link = &SpriteCellNext[*link];
+    }
+    SpriteCellOf[slot] = -1;
+}
+
+/* Link a sprite into the spatial hash cell for its position */
+static void GridInsert(SimSprite *sprite) {
+    int cx, cy;
+    
+    GridUnlink(sprite->slot);
+    cx = SpriteCell(sprite->x, SPRITE_GRID_W);
+    cy = SpriteCell(sprite->y, SPRITE_GRID_H);
+    SpriteCellNext[sprite->slot] = SpriteCellHead[cy][cx];
+    SpriteCellHead[cy][cx] = (short)sprite->slot;
+    SpriteCellOf[sprite->slot] = (short)(cy * SPRITE_GRID_W + cx);
+}
+
+/* Rebuild the spatial hash from current sprite positions */
+static void RebuildSpriteGrid(void) {
+    int x, y, i;
+    SimSprite *sprite;
+    
+    for (y = 0; y < SPRITE_GRID_H; y++) {
+        for (x = 0; x < SPRITE_GRID_W; x++) {
+            SpriteCellHead[y][x] = -1;
+        }
+    }
+    for (i = 0; i < SpriteSlotCount; i++) {
+        SpriteCellOf[i] = -1;
+    }
+    
+    for (i = 0; i < SpriteSlotCount; i++) {
+        sprite = SPRITE_SLOT(i);
+        if (sprite->type != SPRITE_UNDEFINED) {
+            GridInsert(sprite);
+        }
+    }
+}
+
+/* Collect live sprites within radius pixels of x,y. Returns the number found. */
+int FindSpritesNear(int x, int y, int radius, SimSprite **result, int maxResults) {
+    int x1, y1, x2, y2, cx, cy;
+    int dx, dy, found;
+    short slot;
+    SimSprite *sprite;
+    
+    x1 = SpriteCell(x - radius - SPRITE_GRID_SLACK, SPRITE_GRID_W);
+    x2 = SpriteCell(x + radius + SPRITE_GRID_SLACK, SPRITE_GRID_W);
+    y1 = SpriteCell(y - radius - SPRITE_GRID_SLACK, SPRITE_GRID_H);
+    y2 = SpriteCell(y + radius + SPRITE_GRID_SLACK, SPRITE_GRID_H);
+    
+    found = 0;
+    for (cy = y1; cy <= y2; cy++) {
+        for (cx = x1; cx <= x2; cx++) {
+            for (slot = SpriteCellHead[cy][cx]; slot >= 0; slot = SpriteCellNext[slot]) {
+                sprite = SPRITE_SLOT(slot);
+                if (sprite->type == SPRITE_UNDEFINED) {
+                    continue;
+                }
+                dx = sprite->x - x;
+                dy = sprite->y - y;
+                if (dx * dx + dy * dy >= radius * radius) {
+                    continue;
+                }
+                if (found < maxResults) {
+                    result[found] = sprite;
+                }
+                found++;
             }
-            DestroySprite(sprite);
         }
     }
+    
+    return (found < maxResults) ? found : maxResults;
 }
 
 /* Train sprite behavior */
@@ -362,8 +533,9 @@ void DoTrainSprite(SimSprite *sprite) {
 
 /* Ship sprite behavior */
 void DoShipSprite(SimSprite *sprite) {
-    short tile, dir;
+    short dir;
     int i, dx, dy;
+    int mapX, mapY, nextX, nextY;
     
     if (sprite->sound_count > 0) {
         sprite->sound_count--;
@@ -380,7 +552,23 @@ void DoShipSprite(SimSprite *sprite) {
             sprite->sound_count = 40;
         }
         
-        if (sprite->dir == 8) { /* Stopped */
+        mapX = (sprite->x + sprite->x_hot) >> 4;
+        mapY = (sprite->y + sprite->y_hot) >> 4;
+        
+        if (WaterStepToward(mapX, mapY, &nextX, &nextY)) {
+            /* Still in port or beached - head down the water field */
+            for (i = 0; i < 8; i++) {
+                if (((BDx[i] > 0) - (BDx[i] < 0)) == nextX - mapX &&
+                    ((BDy[i] > 0) - (BDy[i] < 0)) == nextY - mapY) {
+                    break;
+                }
+            }
+            if (i < 8) {
+                sprite->x += BDx[i];
+                sprite->y += BDy[i];
+                sprite->new_dir = i;
+            }
+        } else if (sprite->dir == 8) { /* Stopped */
             if (SimRandom(SHIP_DIRECTION_CHANGE_CHANCE) == 0) {
                 dir = SimRandom(8);
                 sprite->new_dir = dir;
@@ -390,9 +578,7 @@ void DoShipSprite(SimSprite *sprite) {
             dx = sprite->x + BDx[sprite->dir];
             dy = sprite->y + BDy[sprite->dir];
             
-            tile = GetChar(dx + sprite->x_hot, dy + sprite->y_hot);
-            
-            if (IsWater(tile)) {
+            if (ShipOnWater(dx + sprite->x_hot, dy + sprite->y_hot)) {
                 sprite->x = dx;
                 sprite->y = dy;
             } else {
@@ -401,9 +587,8 @@ void DoShipSprite(SimSprite *sprite) {
                 for (i = 0; i < 8; i++) {
                     dx = sprite->x + BDx[i];
                     dy = sprite->y + BDy[i];
-                    tile = GetChar(dx + sprite->x_hot, dy + sprite->y_hot);
                     
-                    if (IsWater(tile)) {
+                    if (ShipOnWater(dx + sprite->x_hot, dy + sprite->y_hot)) {
                         dir = i;
                         break;
                     }
@@ -646,21 +831,9 @@ void DoExplosion(SimSprite *sprite) {
     }
 }
 
-/* Helper function to determine if tile is water */
-static int IsWater(short tile) {
-    int i;
-    
-    if (tile == RIVER || tile == CHANNEL) {
-        return 1;
-    }
-    
-    for (i = 0; i < 8; i++) {
-        if (tile == BtClrTab[i]) {
-            return 1;
-        }
-    }
-    
-    return 0;
+/* Is the ship hot spot at this pixel position over navigable water */
+static int ShipOnWater(int x, int y) {
+    return IsNavigableWater(x >> 4, y >> 4);
 }
 
 /* Helper function to check if bus can drive on tile */
@@ -803,13 +976,16 @@ static void ExplodeSprite(SimSprite *sprite) {
 
 /* Check collisions between sprites */
 static void CheckCollisions(SimSprite *sprite) {
-    int i;
+    SimSprite *near[16];
     SimSprite *other;
+    int i, count;
+    
+    count = FindSpritesNear(sprite->x, sprite->y, 30, near, 16);
     
-    for (i = 0; i < MAX_SPRITES; i++) {
-        other = &GlobalSprites[i];
+    for (i = 0; i < count; i++) {
+        other = near[i];
         
-        if (other->type == SPRITE_UNDEFINED || other == sprite) {
+        if (other == sprite) {
             continue;
         }
         
@@ -834,13 +1010,12 @@ static void CheckCollisions(SimSprite *sprite) {
 /* Generate trains at rail stations when population threshold is met */
 void GenerateTrains(void) {
     int x, y;
-    short tile;
     
     if (TotalPop < 20) {
         return; /* Not enough population */
     }
     
-    if (SpriteCount >= MAX_SPRITES - 5) {
+    if (SpriteCount >= SpriteLimit - 5) {
         return; /* Too many sprites */
     }
     
@@ -848,28 +1023,20 @@ void GenerateTrains(void) {
         return; /* Random generation */
     }
     
-    /* Find rail stations */
-    for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
-            tile = Map[y][x] & LOMASK;
-            
-            if (tile >= RAILBASE && tile <= LASTRAIL) {
-                if (SimRandom(FIRE_START_CHANCE) == 0) {
-                    /* Generate train here */
-                    NewSprite(SPRITE_TRAIN, x << 4, y << 4);
-                    return;
-                }
-            }
-        }
+    /* Any of the rail tiles - about the same odds as trying each in turn */
+    if (SimRandom(TRAIN_TILE_CHANCE) >= GetSpawnCount(SPAWN_RAIL)) {
+        return;
+    }
+    if (PickSpawnPoint(SPAWN_RAIL, &x, &y)) {
+        NewSprite(SPRITE_TRAIN, x << 4, y << 4);
     }
 }
 
 /* Generate ships at seaports */
 void GenerateShips(void) {
-    int x, y;
-    short tile;
+    int x, y, wx, wy, steps;
     
-    if (SpriteCount >= MAX_SPRITES - 5) {
+    if (SpriteCount >= SpriteLimit - 5) {
         return;
     }
     
@@ -877,28 +1044,33 @@ void GenerateShips(void) {
         return;
     }
     
-    /* Find seaports */
-    for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
-            tile = Map[y][x] & LOMASK;
-            
-            if (tile >= PORTBASE && tile <= LASTPORT) {
-                if (SimRandom(MELTDOWN_CHANCE) == 0) {
-                    /* Generate ship at port */
-                    NewSprite(SPRITE_SHIP, x << 4, y << 4);
-                    return;
-                }
-            }
+    /* Any of the seaport tiles */
+    if (SimRandom(SHIP_TILE_CHANCE) >= GetSpawnCount(SPAWN_PORT)) {
+        return;
+    }
+    if (!PickSpawnPoint(SPAWN_PORT, &x, &y)) {
+        return;
+    }
+
+    /* Launch the ship on the nearest water to the port */
+    if (GetWaterDistance(x, y) > SHIP_MAX_PORT_DISTANCE) {
+        return;
+    }
+    wx = x;
+    wy = y;
+    for (steps = 0; steps < SHIP_MAX_PORT_DISTANCE; steps++) {
+        if (!WaterStepToward(wx, wy, &wx, &wy)) {
+            break;
         }
     }
+    NewSprite(SPRITE_SHIP, wx << 4, wy << 4);
 }
 
 /* Generate aircraft at airports */
 void GenerateAircraft(void) {
     int x, y;
-    short tile;
     
-    if (SpriteCount >= MAX_SPRITES - 5) {
+    if (SpriteCount >= SpriteLimit - 5) {
         return;
     }
     
@@ -906,23 +1078,19 @@ void GenerateAircraft(void) {
         return;
     }
     
-    /* Find airports */
-    for (y = 0; y < WORLD_Y; y++) {
-        for (x = 0; x < WORLD_X; x++) {
-            tile = Map[y][x] & LOMASK;
-            
-            if (tile >= AIRPORTBASE && tile <= AIRPORT) {
-                if (SimRandom(MONSTER_SPAWN_CHANCE) == 0) {
-                    /* Generate aircraft - favor airplanes at airports */
-                    if (SimRandom(TRAIN_STOP_CHANCE) < 3) {
-                        NewSprite(SPRITE_AIRPLANE, x << 4, y << 4);
-                    } else {
-                        NewSprite(SPRITE_HELICOPTER, x << 4, y << 4);
-                    }
-                    return;
-                }
-            }
-        }
+    /* Any of the airport tiles */
+    if (SimRandom(AIRCRAFT_TILE_CHANCE) >= GetSpawnCount(SPAWN_AIRPORT)) {
+        return;
+    }
+    if (!PickSpawnPoint(SPAWN_AIRPORT, &x, &y)) {
+        return;
+    }
+
+    /* Generate aircraft - favor airplanes at airports */
+    if (SimRandom(TRAIN_STOP_CHANCE) < 3) {
+        NewSprite(SPRITE_AIRPLANE, x << 4, y << 4);
+    } else {
+        NewSprite(SPRITE_HELICOPTER, x << 4, y << 4);
     }
 }
 
@@ -931,7 +1099,7 @@ void GenerateHelicopters(void) {
     int x, y;
     SimSprite *copter;
     
-    if (SpriteCount >= MAX_SPRITES - 5) {
+    if (SpriteCount >= SpriteLimit - 5) {
         return;
     }
     
@@ -1002,11 +1170,16 @@ int GetSpriteCount(void) {
     return SpriteCount;
 }
 
+/* Number of sprite slots in use, live or free - upper bound for GetSprite() */
+int GetSpriteSlotCount(void) {
+    return SpriteSlotCount;
+}
+
 /* Get sprite by index for rendering */
 SimSprite* GetSprite(int index) {
-    if (index >= 0 && index < MAX_SPRITES) {
-        if (GlobalSprites[index].type != SPRITE_UNDEFINED) {
-            return &GlobalSprites[index];
+    if (index >= 0 && index < SpriteSlotCount) {
+        if (SPRITE_SLOT(index)->type != SPRITE_UNDEFINED) {
+            return SPRITE_SLOT(index);
         }
     }
     return NULL;
@@ -1023,8 +1196,14 @@ void DoMonsterSprite(SimSprite *sprite) {
     if (sprite->frame == 0) {
         sprite->frame = 1;
         sprite->count = MONSTER_LIFESPAN; /* Lifespan */
-        sprite->dest_x = (WORLD_X / 2) << 4; /* Target city center initially */
-        sprite->dest_y = (WORLD_Y / 2) << 4;
+        /* Head for the worst pollution, or the city center if none yet */
+        if (PolMaxX || PolMaxY) {
+            sprite->dest_x = PolMaxX << 4;
+            sprite->dest_y = PolMaxY << 4;
+        } else {
+            sprite->dest_x = (WORLD_X / 2) << 4;
+            sprite->dest_y = (WORLD_Y / 2) << 4;
+        }
         sprite->dir = 0;
         sprite->flag = 0;
         sprite->step = 0;
@@ -7,8 +7,14 @@
 
 #include <windows.h>
 
-/* Maximum number of sprites that can exist simultaneously */
-#define MAX_SPRITES     48
+/* Sprite slots are handed out from blocks allocated on demand, so the
+ * hard capacity costs nothing until it is used */
+#define SPRITE_BLOCK_SIZE   64
+#define MAX_SPRITE_BLOCKS   64
+#define MAX_SPRITES         (SPRITE_BLOCK_SIZE * MAX_SPRITE_BLOCKS)
+
+/* Default number of sprites automatic generation keeps alive */
+#define DEFAULT_SPRITE_LIMIT 48
 
 /* Sprite types */
 #define SPRITE_UNDEFINED    0
@@ -22,6 +28,7 @@
 #define SPRITE_EXPLOSION    8
 #define SPRITE_FERRY        9
 #define SPRITE_POLICE       10
+#define SPRITE_TYPE_COUNT   11
 
 /* Train and bus groove offsets for lane positioning */
 #define TRA_GROOVE_X    -39
@@ -52,6 +59,7 @@
 
 #define SHIP_TURN_CHANCE                7       /* 1 in 7 chance to turn */
 #define SHIP_DIRECTION_CHANGE_CHANCE    16      /* 1 in 16 chance to change direction */
+#define SHIP_MAX_PORT_DISTANCE          8       /* Furthest water a port launches ships on */
 
 #define HELICOPTER_SOUND_TIMER          100     /* Helicopter sound check interval */
 #define HELICOPTER_TRAFFIC_THRESHOLD    170     /* Traffic level to trigger sound */
@@ -77,6 +85,11 @@
 #define SHIP_SPAWN_FREQUENCY            100     /* 1 in 100 simulation cycles */
 #define AIRCRAFT_SPAWN_FREQUENCY        50      /* 1 in 50 simulation cycles */
 
+/* Chance per spawn tile once a cycle is picked - more tiles, more likely */
+#define TRAIN_TILE_CHANCE               1000    /* 1 in 1000 per rail tile */
+#define SHIP_TILE_CHANCE                500     /* 1 in 500 per seaport tile */
+#define AIRCRAFT_TILE_CHANCE            300     /* 1 in 300 per airport tile */
+
 /* Disaster sprite constants */
 #define FIRE_START_CHANCE               1000    /* 1 in 1000 chance for fire */
 #define MELTDOWN_CHANCE                 500     /* 1 in 500 chance for meltdown */
@@ -111,6 +124,7 @@ typedef struct SimSprite {
     int turn;          /* Turn state */
     int accel;         /* Acceleration value */
     int speed;         /* Movement speed */
+    int slot;          /* Slot index in the sprite pool */
 } SimSprite;
 
 /* Function prototypes */
@@ -140,7 +154,10 @@ void GenerateHelicopters(void);
 
 /* Utility functions */
 int GetSpriteCount(void);
+int GetSpriteSlotCount(void);
 SimSprite* GetSprite(int index);
+void SetSpriteLimit(int limit);
+int FindSpritesNear(int x, int y, int radius, SimSprite **result, int maxResults);
 void MoveSprite(SimSprite *sprite, int movementType);
 
 /* External variables that need to be defined elsewhere */
@@ -150,6 +167,7 @@ extern int TotalPop;                 /* Total city population */
 extern int TrafficAverage;           /* Average traffic level */
 extern int CrimeAverage;             /* Average crime level */
 extern int RoadTotal;                /* Total road count */
+extern int SpriteLimit;              /* Sprites kept alive by generation */
 extern int SimRandom(int range);     /* Random number generator */
 extern void makeFire(int x, int y);  /* Fire creation function */
 
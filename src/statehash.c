@@ -0,0 +1,292 @@
+/* statehash.c - Simulation state hashing for WiNTown
+ * Uses 32-bit xxHash, which runs four independent lanes over 16 byte
+ * stripes and so hashes the 24 KB map in a few microseconds. Scalars
+ * are fed as little-endian 32-bit values so the hash does not depend on
+ * how the compiler lays out the globals.
+ */
+
+#include "sim.h"
+#include "statehash.h"
+#include <stdio.h>
+#include <string.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+#define XXH_PRIME1 2654435761UL
+#define XXH_PRIME2 2246822519UL
+#define XXH_PRIME3 3266489917UL
+#define XXH_PRIME4 668265263UL
+#define XXH_PRIME5 374761393UL
+
+#define XXH_MASK 0xFFFFFFFFUL
+#define XXH_ROTL(x, r) ((((x) << (r)) | ((x) >> (32 - (r)))) & XXH_MASK)
+
+typedef struct {
+    unsigned long v[4];
+    unsigned long length;
+    unsigned char stripe[16];
+    int stripeLen;
+} HashStream;
+
+const char *StateHashPartNames[STATEHASH_PARTS] = {
+    "map", "density", "effects", "census", "valves", "budget", "random", "history"
+};
+
+int stateHashLogging = 0;
+
+static FILE *hashLogFile = NULL;
+static StateHash lastHash;
+static long hashSerial = 0;
+
+static unsigned long ReadLE32(const unsigned char *p) {
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) |
+           ((unsigned long)p[3] << 24);
+}
+
+static unsigned long HashRound(unsigned long acc, unsigned long input) {
+    acc = (acc + input * XXH_PRIME2) & XXH_MASK;
+    acc = XXH_ROTL(acc, 13);
+    return (acc * XXH_PRIME1) & XXH_MASK;
+}
+
+static void HashBegin(HashStream *s) {
+    s->v[0] = (XXH_PRIME1 + XXH_PRIME2) & XXH_MASK;
+    s->v[1] = XXH_PRIME2;
+    s->v[2] = 0;
+    s->v[3] = (0 - XXH_PRIME1) & XXH_MASK;
+    s->length = 0;
+    s->stripeLen = 0;
+}
+
+static void HashStripe(HashStream *s, const unsigned char *p) {
+    s->v[0] = HashRound(s->v[0], ReadLE32(p));
+    s->v[1] = HashRound(s->v[1], ReadLE32(p + 4));
+    s->v[2] = HashRound(s->v[2], ReadLE32(p + 8));
+    s->v[3] = HashRound(s->v[3], ReadLE32(p + 12));
+}
+
+static void HashBytes(HashStream *s, const void *data, long len) {
+    const unsigned char *p = (const unsigned char *)data;
+    int take;
+
+    s->length += (unsigned long)len;
+
+    /* Top up a partial stripe first */
+    if (s->stripeLen > 0) {
+        take = 16 - s->stripeLen;
+        if (take > len) {
+            take = (int)len;
+        }
+        memcpy(s->stripe + s->stripeLen, p, take);
+        s->stripeLen += take;
+        p += take;
+        len -= take;
+        if (s->stripeLen < 16) {
+            return;
+        }
+        HashStripe(s, s->stripe);
+        s->stripeLen = 0;
+    }
+
+    while (len >= 16) {
+        HashStripe(s, p);
+        p += 16;
+        len -= 16;
+    }
+
+    if (len > 0) {
+        memcpy(s->stripe, p, len);
+        s->stripeLen = (int)len;
+    }
+}
+
+static void HashLong(HashStream *s, long value) {
+    unsigned char b[4];
+    unsigned long u = (unsigned long)value;
+
+    b[0] = (unsigned char)(u & 0xFF);
+    b[1] = (unsigned char)((u >> 8) & 0xFF);
+    b[2] = (unsigned char)((u >> 16) & 0xFF);
+    b[3] = (unsigned char)((u >> 24) & 0xFF);
+    HashBytes(s, b, 4);
+}
+
+static unsigned long HashEnd(HashStream *s) {
+    unsigned long h;
+    const unsigned char *p;
+    int left;
+
+    if (s->length >= 16) {
+        h = (XXH_ROTL(s->v[0], 1) + XXH_ROTL(s->v[1], 7) + XXH_ROTL(s->v[2], 12) +
+             XXH_ROTL(s->v[3], 18)) & XXH_MASK;
+    } else {
+        h = s->v[2] + XXH_PRIME5;
+    }
+    h = (h + s->length) & XXH_MASK;
+
+    p = s->stripe;
+    left = s->stripeLen;
+    while (left >= 4) {
+        h = (h + ReadLE32(p) * XXH_PRIME3) & XXH_MASK;
+        h = (XXH_ROTL(h, 17) * XXH_PRIME4) & XXH_MASK;
+        p += 4;
+        left -= 4;
+    }
+    while (left > 0) {
+        h = (h + (unsigned long)*p * XXH_PRIME5) & XXH_MASK;
+        h = (XXH_ROTL(h, 11) * XXH_PRIME1) & XXH_MASK;
+        p++;
+        left--;
+    }
+
+    h ^= h >> 15;
+    h = (h * XXH_PRIME2) & XXH_MASK;
+    h ^= h >> 13;
+    h = (h * XXH_PRIME3) & XXH_MASK;
+    h ^= h >> 16;
+    return h;
+}
+
+void ComputeStateHash(StateHash *hash) {
+    HashStream s;
+    int i;
+
+    HashBegin(&s);
+    HashBytes(&s, Map, sizeof(Map));
+    hash->part[STATEHASH_MAP] = HashEnd(&s);
+
+    HashBegin(&s);
+    HashBytes(&s, PopDensity, sizeof(PopDensity));
+    HashBytes(&s, TrfDensity, sizeof(TrfDensity));
+    HashBytes(&s, PollutionMem, sizeof(PollutionMem));
+    HashBytes(&s, LandValueMem, sizeof(LandValueMem));
+    HashBytes(&s, CrimeMem, sizeof(CrimeMem));
+    hash->part[STATEHASH_DENSITY] = HashEnd(&s);
+
+    HashBegin(&s);
+    HashBytes(&s, TerrainMem, sizeof(TerrainMem));
+    HashBytes(&s, FireStMap, sizeof(FireStMap));
+    HashBytes(&s, FireRate, sizeof(FireRate));
+    HashBytes(&s, PoliceMap, sizeof(PoliceMap));
+    HashBytes(&s, PoliceMapEffect, sizeof(PoliceMapEffect));
+    HashBytes(&s, ComRate, sizeof(ComRate));
+    hash->part[STATEHASH_EFFECTS] = HashEnd(&s);
+
+    HashBegin(&s);
+    HashLong(&s, ResPop);
+    HashLong(&s, ComPop);
+    HashLong(&s, IndPop);
+    HashLong(&s, TotalPop);
+    HashLong(&s, CityPop);
+    HashLong(&s, PwrdZCnt);
+    HashLong(&s, UnpwrdZCnt);
+    HashLong(&s, RoadTotal);
+    HashLong(&s, RailTotal);
+    HashLong(&s, FirePop);
+    HashLong(&s, PolicePop);
+    HashLong(&s, StadiumPop);
+    HashLong(&s, PortPop);
+    HashLong(&s, APortPop);
+    HashLong(&s, NuclearPop);
+    HashLong(&s, CoalPop);
+    HashLong(&s, HospPop);
+    HashLong(&s, ResZPop);
+    HashLong(&s, ComZPop);
+    HashLong(&s, IndZPop);
+    HashLong(&s, TrafficAverage);
+    HashLong(&s, PollutionAverage);
+    HashLong(&s, CrimeAverage);
+    HashLong(&s, LVAverage);
+    hash->part[STATEHASH_CENSUS] = HashEnd(&s);
+
+    HashBegin(&s);
+    HashLong(&s, RValve);
+    HashLong(&s, CValve);
+    HashLong(&s, IValve);
+    HashLong(&s, ResCap);
+    HashLong(&s, ComCap);
+    HashLong(&s, IndCap);
+    hash->part[STATEHASH_VALVES] = HashEnd(&s);
+
+    HashBegin(&s);
+    HashLong(&s, (long)TotalFunds);
+    HashLong(&s, TaxRate);
+    HashLong(&s, RoadEffect);
+    HashLong(&s, PoliceEffect);
+    HashLong(&s, FireEffect);
+    hash->part[STATEHASH_BUDGET] = HashEnd(&s);
+
+    HashBegin(&s);
+    HashLong(&s, (long)GetSimRandomState());
+    hash->part[STATEHASH_RANDOM] = HashEnd(&s);
+
+    HashBegin(&s);
+    HashBytes(&s, ResHis, sizeof(ResHis));
+    HashBytes(&s, ComHis, sizeof(ComHis));
+    HashBytes(&s, IndHis, sizeof(IndHis));
+    HashBytes(&s, CrimeHis, sizeof(CrimeHis));
+    HashBytes(&s, PollutionHis, sizeof(PollutionHis));
+    HashBytes(&s, MoneyHis, sizeof(MoneyHis));
+    hash->part[STATEHASH_HISTORY] = HashEnd(&s);
+
+    HashBegin(&s);
+    for (i = 0; i < STATEHASH_PARTS; i++) {
+        HashLong(&s, (long)hash->part[i]);
+    }
+    hash->total = HashEnd(&s);
+
+    hash->cityTime = CityTime;
+}
+
+const StateHash *GetLastStateHash(void) {
+    return &lastHash;
+}
+
+void StateHashCycle(void) {
+    int i;
+
+    ComputeStateHash(&lastHash);
+    lastHash.serial = ++hashSerial;
+
+    if (hashLogFile) {
+        fprintf(hashLogFile, "%ld %ld %08lx", lastHash.serial, lastHash.cityTime, lastHash.total);
+        for (i = 0; i < STATEHASH_PARTS; i++) {
+            fprintf(hashLogFile, " %08lx", lastHash.part[i]);
+        }
+        fprintf(hashLogFile, "\n");
+    }
+}
+
+int StartStateHashLog(const char *path) {
+    int i;
+
+    StopStateHashLog();
+
+    hashLogFile = fopen(path ? path : STATEHASH_LOG_NAME, "w");
+    if (!hashLogFile) {
+        addDebugLog("State hash: cannot create %s", path ? path : STATEHASH_LOG_NAME);
+        return 0;
+    }
+
+    /* Number passes from the start of the log so two runs line up */
+    hashSerial = 0;
+
+    fprintf(hashLogFile, "%s\n# serial citytime total", STATEHASH_LOG_HEADER);
+    for (i = 0; i < STATEHASH_PARTS; i++) {
+        fprintf(hashLogFile, " %s", StateHashPartNames[i]);
+    }
+    fprintf(hashLogFile, "\n");
+
+    stateHashLogging = 1;
+    return 1;
+}
+
+void StopStateHashLog(void) {
+    if (hashLogFile) {
+        fclose(hashLogFile);
+        hashLogFile = NULL;
+        addDebugLog("State hash log closed after %ld passes", hashSerial);
+    }
+    stateHashLogging = 0;
+}
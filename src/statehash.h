@@ -0,0 +1,49 @@
+/* statehash.h - Simulation state hashing for WiNTown
+ * At the end of every full simulation pass the state is hashed one
+ * subsystem at a time, so two runs of the same city can be compared and
+ * the first cycle and subsystem where they part found.
+ * This header is shared with the hashdiff tool and must not need windows.h.
+ */
+
+#ifndef _STATEHASH_H
+#define _STATEHASH_H
+
+/* Subsystems hashed separately */
+#define STATEHASH_MAP      0 /* Map tiles and flags */
+#define STATEHASH_DENSITY  1 /* Half size density maps */
+#define STATEHASH_EFFECTS  2 /* Quarter size effect maps */
+#define STATEHASH_CENSUS   3 /* Population and zone counts */
+#define STATEHASH_VALVES   4 /* Growth valves */
+#define STATEHASH_BUDGET   5 /* Funds, tax and funding effects */
+#define STATEHASH_RANDOM   6 /* Random generator state */
+#define STATEHASH_HISTORY  7 /* Graph histories */
+#define STATEHASH_PARTS    8
+
+#define STATEHASH_LOG_NAME "statehash.log"
+#define STATEHASH_LOG_HEADER "# WiNTown state hash 1"
+
+typedef struct {
+    long serial;                         /* Passes hashed since startup */
+    long cityTime;                       /* CityTime of the pass */
+    unsigned long part[STATEHASH_PARTS];
+    unsigned long total;                 /* Hash of the part hashes */
+} StateHash;
+
+/* Names used in the log and by hashdiff */
+extern const char *StateHashPartNames[STATEHASH_PARTS];
+
+/* Hash the current state into hash - does not touch the log */
+void ComputeStateHash(StateHash *hash);
+
+/* Latest hash taken at the end of Simulate(15) */
+const StateHash *GetLastStateHash(void);
+
+/* Called from Simulate(15) */
+void StateHashCycle(void);
+
+/* Hash log control */
+extern int stateHashLogging;
+int StartStateHashLog(const char *path);
+void StopStateHashLog(void);
+
+#endif /* _STATEHASH_H */
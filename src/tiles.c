@@ -4,98 +4,50 @@
 
 #include "sim.h"
 #include "tiles.h"
-#include <stdio.h>
-#include <string.h>
+#include "water.h"
+#include "census.h"
+#include "planes.h"
+#include "spawn.h"
+#include "roadnet.h"
+#include "tiletrace.h"
+#include "journal.h"
+#include "lod.h"
+#include "minimap.h"
 
 /* Debug and statistics globals */
 long tileChangeCount = 0;
 long tileErrorCount = 0;
 
-#ifdef TILE_DEBUG
-/* Tile change log file */
-static FILE* tileLogFile = (FILE*)0;
-
-/* Initialize tile logging */
-static int initTileLogging() {
-    if (!tileLogFile) {
-        tileLogFile = fopen("tiles.log", "w");
-        if (tileLogFile) {
-            fprintf(tileLogFile, "=== Tile logging started ===\n");
-            fflush(tileLogFile);
-        } else {
-            /* Could not open log file - silent fail in release */
-            return 0;
-        }
-    }
-    return (tileLogFile != (FILE*)0);
-}
-
-/* Reset tile logging - closes and reopens the log file */
+/* Restart the tile trace with a fresh file - TILE_DEBUG builds always trace */
 void resetTileLogging() {
-    if (tileLogFile) {
-        fclose(tileLogFile);
-        tileLogFile = (FILE*)0;
-    }
     tileChangeCount = 0;
     tileErrorCount = 0;
-    initTileLogging();
-}
-
-/* Convert flags to readable string */
-static void flagsToString(int flags, char* buffer, int bufSize) {
-    int len;
-    
-    buffer[0] = '\0';
-    
-    if (flags & POWERBIT) strcat(buffer, "POWER ");
-    if (flags & CONDBIT) strcat(buffer, "COND ");
-    if (flags & BURNBIT) strcat(buffer, "BURN ");
-    if (flags & BULLBIT) strcat(buffer, "BULL ");
-    if (flags & ANIMBIT) strcat(buffer, "ANIM ");
-    if (flags & ZONEBIT) strcat(buffer, "ZONE ");
-    
-    if (buffer[0] == '\0') {
-        strcpy(buffer, "NONE");
-    } else {
-        /* Remove trailing space */
-        len = strlen(buffer);
-        if (len > 0 && buffer[len-1] == ' ') {
-            buffer[len-1] = '\0';
-        }
+#ifdef TILE_DEBUG
+    StartTileTrace();
+#else
+    if (tileTraceEnabled) {
+        StartTileTrace();
     }
+#endif
 }
 
-/* Log tile change */
-static int logTileChange(int x, int y, int oldTile, int newTile, char* caller) {
-    int oldBase, newBase;
-    int oldFlags, newFlags;
-    char oldFlagStr[64], newFlagStr[64];
-    
-    if (!initTileLogging()) {
-        return 0;
+/* validateTileCoords() and validateTileValue() functions removed - now using inline macros */
+
+/* Keep indexes derived from the map in step with a tile change */
+static void tileChanged(int x, int y, int oldTile, int newTile) {
+    WaterTileChanged(x, y, oldTile, newTile);
+    CensusTileChanged(oldTile, newTile);
+    PlaneTileChanged(x, y, oldTile, newTile);
+    SpawnTileChanged(x, y, oldTile, newTile);
+    RoadMaskTileChanged(x, y, oldTile, newTile);
+    RoadNetTileChanged(x, y, oldTile, newTile);
+    ZoneTileChanged(x, y, oldTile, newTile);
+    LodTileChanged(x, y, oldTile, newTile);
+    MinimapTileChanged(x, y, oldTile, newTile);
+    if (JournalActive) {
+        JournalTileChanged(x, y);
     }
-    
-    oldBase = oldTile & LOMASK;
-    newBase = newTile & LOMASK;
-    oldFlags = oldTile & ~LOMASK;
-    newFlags = newTile & ~LOMASK;
-    
-    flagsToString(oldFlags, oldFlagStr, sizeof(oldFlagStr));
-    flagsToString(newFlags, newFlagStr, sizeof(newFlagStr));
-    
-    fprintf(tileLogFile, "TILE[%d,%d]: 0x%04X->0x%04X base %d->%d flags [%s]->[%s] by %s\n", 
-            x, y, oldTile, newTile, oldBase, newBase, oldFlagStr, newFlagStr, caller ? caller : "unknown");
-    fflush(tileLogFile);
-    return 1;
 }
-#else
-/* Debug functions empty in release builds */
-static int logTileChange(int x, int y, int oldTile, int newTile, char* caller) {
-    return 0;
-}
-#endif
-
-/* validateTileCoords() and validateTileValue() functions removed - now using inline macros */
 
 /* Get tile value at coordinates */
 int getMapTile(int x, int y) {
@@ -119,9 +71,9 @@ int setMapTile(int x, int y, int tile, int flags, int operation, char* caller) {
     
     /* Validate coordinates */
     if (!BOUNDS_CHECK(x, y)) {
-#ifdef TILE_DEBUG
-        logTileChange(x, y, -1, -1, caller);
-#endif
+        if (tileTraceEnabled) {
+            TraceTileChange(x, y, -1, -1, TRACE_REJECTED, caller);
+        }
         tileErrorCount++;
         return 0;
     }
@@ -164,45 +116,37 @@ int setMapTile(int x, int y, int tile, int flags, int operation, char* caller) {
     
     /* Validate new tile value */
     if ((newTile & LOMASK) >= 1024) {
-#ifdef TILE_DEBUG
-        fprintf(tileLogFile, "ERROR: Invalid tile base %d (full value %d) at [%d,%d] by %s\n",
-                newTile & LOMASK, newTile, x, y, caller ? caller : "unknown");
-        fflush(tileLogFile);
-#endif
+        if (tileTraceEnabled) {
+            TraceTileChange(x, y, oldTile, newTile, TRACE_REJECTED, caller);
+        }
         tileErrorCount++;
         return 0;
     }
     
-    /* Log the change if debugging enabled */
-#ifdef TILE_DEBUG
-    if (oldTile != newTile) {
-        logTileChange(x, y, oldTile, newTile, caller);
+    /* Record the change if tracing */
+    if (tileTraceEnabled && oldTile != newTile) {
+        TraceTileChange(x, y, oldTile, newTile, 0, caller);
     }
-#endif
     
     /* Make the change */
     Map[y][x] = newTile;
     tileChangeCount++;
+
+    if (oldTile != newTile) {
+        tileChanged(x, y, oldTile, newTile);
+    }
     
     return 1;
 }
 
-#ifdef TILE_DEBUG
-/* Enable/disable debug logging */
+/* Enable/disable the tile trace */
 int enableTileDebug(int enable) {
-    if (!enable && tileLogFile) {
-        fprintf(tileLogFile, "=== Tile logging stopped ===\n");
-        fclose(tileLogFile);
-        tileLogFile = (FILE*)0;
+    if (enable) {
+        return StartTileTrace();
     }
+    StopTileTrace();
     return 1;
 }
-#else
-/* Enable/disable debug logging */
-int enableTileDebug(int enable) {
-    return 0;
-}
-#endif
 
 /* Reset statistics */
 int resetTileStats() {
@@ -217,11 +161,9 @@ int printTileStats() {
     addDebugLog("Tile Statistics:\n");
     addDebugLog("  Changes: %ld\n", tileChangeCount);
     addDebugLog("  Errors: %ld\n", tileErrorCount);
-#ifdef TILE_DEBUG
-    if (tileLogFile) {
-        addDebugLog("  Debug log: tiles.log\n");
+    if (tileTraceEnabled) {
+        addDebugLog("  Trace file: %s\n", TRACE_FILE_NAME);
     }
-#endif
 #endif
     return 1;
 }
\ No newline at end of file
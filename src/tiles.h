@@ -17,11 +17,9 @@ int setMapTile(int x, int y, int tile, int flags, int operation, char* caller);
 int getMapTile(int x, int y);
 int getMapFlags(int x, int y);
 
-/* Debug logging control */
+/* Tile trace control - see tiletrace.h */
 int enableTileDebug(int enable);
-#ifdef TILE_DEBUG
 void resetTileLogging();
-#endif
 
 /* Tile change statistics */
 extern long tileChangeCount;
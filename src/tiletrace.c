@@ -0,0 +1,272 @@
+/* tiletrace.c - Binary tile change trace for WiNTown
+ * Each thread that changes tiles gets its own ring of fixed size records,
+ * so recording is a handful of stores with no lock and no formatting.
+ * A full ring is written to the trace file as one block. Caller strings
+ * are interned to small ids the first time a call site is seen, keyed by
+ * the address of its string literal.
+ */
+
+#include "sim.h"
+#include "tiletrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Threads that can record at once */
+#define TRACE_MAX_THREADS 4
+
+/* Caller hash table - twice the caller limit keeps probes short */
+#define TRACE_HASH_SIZE (TRACE_MAX_CALLERS * 2)
+
+typedef struct {
+    TileTraceRecord records[TRACE_RING_SIZE];
+    int used;
+    int slot;
+} TraceRing;
+
+int tileTraceEnabled = 0;
+
+static FILE *traceFile = NULL;
+static CRITICAL_SECTION traceLock;
+static int traceReady = 0;
+static DWORD traceTlsIndex = 0;
+
+static TraceRing *traceRings[TRACE_MAX_THREADS];
+static volatile LONG traceRingCount = 0;
+
+/* Interned callers - id 0 is kept for unknown and overflow */
+static char *volatile callerKeys[TRACE_HASH_SIZE];
+static unsigned short callerIds[TRACE_HASH_SIZE];
+static char *callerNames[TRACE_MAX_CALLERS];
+static int callerCount = 1;
+static int callerNamesWritten = 0;
+
+static long traceRecordsWritten = 0;
+static long traceRecordsLost = 0;
+
+/* One-time setup of the lock and the thread slot */
+static int InitTileTrace(void) {
+    if (!traceReady) {
+        traceTlsIndex = TlsAlloc();
+        if (traceTlsIndex == (DWORD)0xFFFFFFFF) {
+            return 0;
+        }
+        InitializeCriticalSection(&traceLock);
+        callerNames[0] = "unknown";
+        traceReady = 1;
+    }
+    return 1;
+}
+
+/* Give the calling thread its ring */
+static TraceRing *AttachTraceRing(void) {
+    TraceRing *ring;
+    LONG slot;
+
+    slot = InterlockedIncrement((LONG *)&traceRingCount) - 1;
+    if (slot >= TRACE_MAX_THREADS) {
+        InterlockedDecrement((LONG *)&traceRingCount);
+        return NULL;
+    }
+
+    ring = (TraceRing *)malloc(sizeof(TraceRing));
+    if (!ring) {
+        InterlockedDecrement((LONG *)&traceRingCount);
+        return NULL;
+    }
+    ring->used = 0;
+    ring->slot = (int)slot;
+    traceRings[slot] = ring;
+    TlsSetValue(traceTlsIndex, ring);
+    return ring;
+}
+
+/* Map a caller string to its id, adding it on first sight */
+static unsigned short InternCaller(char *caller) {
+    unsigned int h;
+    unsigned short id;
+
+    if (!caller) {
+        return 0;
+    }
+
+    h = ((unsigned int)(size_t)caller >> 2) & (TRACE_HASH_SIZE - 1);
+    while (callerKeys[h]) {
+        if (callerKeys[h] == caller) {
+            return callerIds[h];
+        }
+        h = (h + 1) & (TRACE_HASH_SIZE - 1);
+    }
+
+    /* Miss - insert under the lock, then publish the key last */
+    EnterCriticalSection(&traceLock);
+    while (callerKeys[h] && callerKeys[h] != caller) {
+        h = (h + 1) & (TRACE_HASH_SIZE - 1);
+    }
+    if (callerKeys[h]) {
+        id = callerIds[h];
+    } else if (callerCount < TRACE_MAX_CALLERS) {
+        id = (unsigned short)callerCount++;
+        callerNames[id] = caller;
+        callerIds[h] = id;
+        callerKeys[h] = caller;
+    } else {
+        id = 0;
+    }
+    LeaveCriticalSection(&traceLock);
+    return id;
+}
+
+/* Write callers interned since the last block - lock held */
+static void WriteTraceNames(int slot) {
+    TileTraceBlock block;
+    unsigned short id, len;
+
+    if (callerNamesWritten >= callerCount) {
+        return;
+    }
+
+    block.kind = TRACE_BLOCK_NAMES;
+    block.thread = slot;
+    block.count = callerCount - callerNamesWritten;
+    fwrite(&block, sizeof(block), 1, traceFile);
+
+    for (id = (unsigned short)callerNamesWritten; id < callerCount; id++) {
+        len = (unsigned short)strlen(callerNames[id]);
+        fwrite(&id, sizeof(id), 1, traceFile);
+        fwrite(&len, sizeof(len), 1, traceFile);
+        fwrite(callerNames[id], 1, len, traceFile);
+    }
+    callerNamesWritten = callerCount;
+}
+
+/* Move a ring's records to the trace file */
+static void WriteTraceRing(TraceRing *ring) {
+    TileTraceBlock block;
+
+    if (ring->used == 0) {
+        return;
+    }
+
+    EnterCriticalSection(&traceLock);
+    if (traceFile) {
+        WriteTraceNames(ring->slot);
+
+        block.kind = TRACE_BLOCK_RECORDS;
+        block.thread = ring->slot;
+        block.count = ring->used;
+        fwrite(&block, sizeof(block), 1, traceFile);
+        fwrite(ring->records, sizeof(TileTraceRecord), ring->used, traceFile);
+        traceRecordsWritten += ring->used;
+    } else {
+        traceRecordsLost += ring->used;
+    }
+    LeaveCriticalSection(&traceLock);
+
+    ring->used = 0;
+}
+
+/* Record one tile change for the calling thread */
+void TraceTileChange(int x, int y, int oldTile, int newTile, int flags, char *caller) {
+    TraceRing *ring;
+    TileTraceRecord *rec;
+
+    ring = (TraceRing *)TlsGetValue(traceTlsIndex);
+    if (!ring) {
+        ring = AttachTraceRing();
+        if (!ring) {
+            traceRecordsLost++;
+            return;
+        }
+    }
+
+    rec = &ring->records[ring->used];
+    rec->cycle = ((long)CityTime << 4) | (Fcycle & 15);
+    rec->x = (short)x;
+    rec->y = (short)y;
+    rec->oldTile = (unsigned short)oldTile;
+    rec->newTile = (unsigned short)newTile;
+    rec->caller = InternCaller(caller);
+    rec->flags = (unsigned short)flags;
+
+    if (++ring->used == TRACE_RING_SIZE) {
+        WriteTraceRing(ring);
+    }
+}
+
+/* Write out everything buffered so far */
+void FlushTileTrace(void) {
+    LONG i, count;
+
+    if (!traceReady) {
+        return;
+    }
+
+    count = traceRingCount;
+    for (i = 0; i < count; i++) {
+        if (traceRings[i]) {
+            WriteTraceRing(traceRings[i]);
+        }
+    }
+
+    EnterCriticalSection(&traceLock);
+    if (traceFile) {
+        fflush(traceFile);
+    }
+    LeaveCriticalSection(&traceLock);
+}
+
+/* Start a new trace file, closing any current one.
+ * Call from the simulation thread while no other thread records. */
+int StartTileTrace(void) {
+    TileTraceHeader header;
+
+    if (!InitTileTrace()) {
+        return 0;
+    }
+
+    StopTileTrace();
+
+    traceFile = fopen(TRACE_FILE_NAME, "wb");
+    if (!traceFile) {
+        addDebugLog("Tile trace: cannot create %s", TRACE_FILE_NAME);
+        return 0;
+    }
+
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TileTraceRecord);
+    fwrite(&header, sizeof(header), 1, traceFile);
+
+    /* Interned ids stay valid, but the new file needs their names */
+    callerNamesWritten = 0;
+    traceRecordsWritten = 0;
+    traceRecordsLost = 0;
+    tileTraceEnabled = 1;
+
+    addDebugLog("Tile trace started: %s", TRACE_FILE_NAME);
+    return 1;
+}
+
+/* Stop recording and close the trace file */
+void StopTileTrace(void) {
+    if (!traceReady || !traceFile) {
+        tileTraceEnabled = 0;
+        return;
+    }
+
+    tileTraceEnabled = 0;
+    FlushTileTrace();
+
+    EnterCriticalSection(&traceLock);
+    fclose(traceFile);
+    traceFile = NULL;
+    LeaveCriticalSection(&traceLock);
+
+    addDebugLog("Tile trace stopped: %ld records, %ld lost, %d callers", traceRecordsWritten,
+                traceRecordsLost, callerCount - 1);
+}
@@ -0,0 +1,59 @@
+/* tiletrace.h - Binary tile change trace for WiNTown
+ * setMapTile() records every change into a per-thread ring buffer that is
+ * written to tiles.trc in blocks. trcdump decodes the file offline.
+ * This header is shared with the decoder and must not need windows.h.
+ */
+
+#ifndef _TILETRACE_H
+#define _TILETRACE_H
+
+/* Trace file name and identification */
+#define TRACE_FILE_NAME   "tiles.trc"
+#define TRACE_MAGIC       0x52545457L /* "WTTR" */
+#define TRACE_VERSION     1
+
+/* Records buffered per thread before a block is written */
+#define TRACE_RING_SIZE   16384
+
+/* Distinct callers that can be interned */
+#define TRACE_MAX_CALLERS 512
+
+/* Block kinds */
+#define TRACE_BLOCK_NAMES   1 /* count x {id, len, name bytes} */
+#define TRACE_BLOCK_RECORDS 2 /* count x TileTraceRecord */
+
+/* Record flags */
+#define TRACE_REJECTED 0x0001 /* setMapTile refused the change */
+
+/* File header */
+typedef struct {
+    long magic;
+    long version;
+    long recordSize;
+} TileTraceHeader;
+
+/* Block header - followed by its payload */
+typedef struct {
+    long kind;
+    long thread;  /* Writer thread slot, 0 for the simulation */
+    long count;
+} TileTraceBlock;
+
+/* One tile change - 16 bytes */
+typedef struct {
+    long cycle;              /* CityTime * 16 + simulation phase */
+    short x, y;
+    unsigned short oldTile;
+    unsigned short newTile;
+    unsigned short caller;   /* Interned caller id */
+    unsigned short flags;
+} TileTraceRecord;
+
+/* Recorder - implemented in tiletrace.c */
+extern int tileTraceEnabled;
+int StartTileTrace(void);
+void StopTileTrace(void);
+void FlushTileTrace(void);
+void TraceTileChange(int x, int y, int oldTile, int newTile, int flags, char *caller);
+
+#endif /* _TILETRACE_H */
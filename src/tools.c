@@ -175,7 +175,7 @@ int ConnectTile(int x, int y, short *tilePtr, int command) {
             tile &= LOMASK;
             if (tile >= RUBBLE && tile <= LASTRUBBLE) {
                 Spend(1);
-                *tilePtr = DIRT;
+                setMapTile(x, y, DIRT, 0, TILE_SET_REPLACE, "ConnectTile-dirt");
             }
         }
     }
@@ -694,7 +694,7 @@ int LayDoze(int x, int y, short *tilePtr) {
         default:
             /* Unknown zone type - convert to rubble instead of just clearing */
             Spend(1);
-            *tilePtr = RUBBLE | BULLBIT;
+            setMapTile(x, y, RUBBLE, BULLBIT, TILE_SET_REPLACE, "LayDoze-rubble");
             return 1;
         }
     }
@@ -738,13 +738,13 @@ int LayDoze(int x, int y, short *tilePtr) {
     if (tile == HANDBALL || tile == LHBALL || tile == HBRIDGE || tile == VBRIDGE || tile == BRWH ||
         tile == BRWV) {
         Spend(5);
-        *tilePtr = RIVER;
+        setMapTile(x, y, RIVER, 0, TILE_SET_REPLACE, "LayDoze-river");
         return 1;
     }
 
     /* General bulldozing of other tiles */
     Spend(1);
-    *tilePtr = DIRT;
+    setMapTile(x, y, DIRT, 0, TILE_SET_REPLACE, "LayDoze-dirt");
     return 1;
 }
 
@@ -764,9 +764,9 @@ int LayRoad(int x, int y, short *tilePtr) {
         Spend(cost);
         if (((y > 0) && (Map[y - 1][x] & LOMASK) == VRAIL) ||
             ((y < WORLD_Y - 1) && (Map[y + 1][x] & LOMASK) == VRAIL)) {
-            *tilePtr = VRAILROAD | BULLBIT;
+            setMapTile(x, y, VRAILROAD, BULLBIT, TILE_SET_REPLACE, "LayRoad-vrailroad");
         } else {
-            *tilePtr = HBRIDGE | BULLBIT;
+            setMapTile(x, y, HBRIDGE, BULLBIT, TILE_SET_REPLACE, "LayRoad-hbridge");
         }
         return 1;
     }
@@ -783,10 +783,10 @@ int LayRoad(int x, int y, short *tilePtr) {
             (Map[y-1][x] & LOMASK) >= POWERBASE && (Map[y-1][x] & LOMASK) <= LASTPOWER &&
             (Map[y+1][x] & LOMASK) >= POWERBASE && (Map[y+1][x] & LOMASK) <= LASTPOWER) {
             /* Vertical power line needs horizontal road crossing */
-            *tilePtr = HROADPOWER | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, HROADPOWER, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayRoad-hroadpower");
         } else {
             /* Horizontal power line needs vertical road crossing */
-            *tilePtr = VROADPOWER | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, VROADPOWER, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayRoad-vroadpower");
         }
         return 1;
     }
@@ -800,7 +800,7 @@ int LayRoad(int x, int y, short *tilePtr) {
         }
 
         Spend(cost);
-        *tilePtr = ROADS | BULLBIT | BURNBIT;
+        setMapTile(x, y, ROADS, BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayRoad-roads");
         return 1;
     }
 
@@ -822,7 +822,7 @@ int LayRail(int x, int y, short *tilePtr) {
         }
 
         Spend(cost);
-        *tilePtr = HRAIL | BULLBIT;
+        setMapTile(x, y, HRAIL, BULLBIT, TILE_SET_REPLACE, "LayRail-hrail");
         return 1;
     }
     
@@ -838,10 +838,10 @@ int LayRail(int x, int y, short *tilePtr) {
             (Map[y-1][x] & LOMASK) >= POWERBASE && (Map[y-1][x] & LOMASK) <= LASTPOWER &&
             (Map[y+1][x] & LOMASK) >= POWERBASE && (Map[y+1][x] & LOMASK) <= LASTPOWER) {
             /* Vertical power line needs horizontal rail crossing */
-            *tilePtr = RAILHPOWERV | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, RAILHPOWERV, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayRail-railhpowerv");
         } else {
             /* Horizontal power line needs vertical rail crossing */
-            *tilePtr = RAILVPOWERH | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, RAILVPOWERH, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayRail-railvpowerh");
         }
         return 1;
     }
@@ -855,7 +855,7 @@ int LayRail(int x, int y, short *tilePtr) {
         }
 
         Spend(cost);
-        *tilePtr = RAILBASE | BULLBIT | BURNBIT;
+        setMapTile(x, y, RAILBASE, BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayRail-railbase");
         return 1;
     }
 
@@ -909,14 +909,14 @@ int LayWire(int x, int y, short *tilePtr) {
 
         if (connectMask != 0) {
             /* Use the proper tile from the wire table */
-            *tilePtr = WireTable[connectMask & 15] | CONDBIT | BULLBIT;
+            setMapTile(x, y, WireTable[connectMask & 15], CONDBIT | BULLBIT, TILE_SET_REPLACE, "LayWire-wiretable");
         } else if ((x > 0 && x < WORLD_X - 1) && 
                   (Map[y][x-1] & CONDBIT) && (Map[y][x+1] & CONDBIT)) {
             /* Horizontal connection needed */
-            *tilePtr = HPOWER | CONDBIT | BULLBIT;
+            setMapTile(x, y, HPOWER, CONDBIT | BULLBIT, TILE_SET_REPLACE, "LayWire-hpower");
         } else {
             /* Default to vertical power line for underwater */
-            *tilePtr = VPOWER | CONDBIT | BULLBIT; 
+            setMapTile(x, y, VPOWER, CONDBIT | BULLBIT, TILE_SET_REPLACE, "LayWire-vpower");
         }
         return 1;
     }
@@ -933,10 +933,10 @@ int LayWire(int x, int y, short *tilePtr) {
             (Map[y][x-1] & LOMASK) >= ROADBASE && (Map[y][x-1] & LOMASK) <= LASTROAD &&
             (Map[y][x+1] & LOMASK) >= ROADBASE && (Map[y][x+1] & LOMASK) <= LASTROAD) {
             /* Horizontal road needs vertical power line crossing */
-            *tilePtr = VROADPOWER | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, VROADPOWER, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-vroadpower");
         } else {
             /* Vertical road needs horizontal power line crossing */
-            *tilePtr = HROADPOWER | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, HROADPOWER, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-hroadpower");
         }
         return 1;
     }
@@ -953,10 +953,10 @@ int LayWire(int x, int y, short *tilePtr) {
             (Map[y][x-1] & LOMASK) >= RAILBASE && (Map[y][x-1] & LOMASK) <= LASTRAIL &&
             (Map[y][x+1] & LOMASK) >= RAILBASE && (Map[y][x+1] & LOMASK) <= LASTRAIL) {
             /* Horizontal rail needs vertical power line crossing */
-            *tilePtr = RAILVPOWERH | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, RAILVPOWERH, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-railvpowerh");
         } else {
             /* Vertical rail needs horizontal power line crossing */
-            *tilePtr = RAILHPOWERV | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, RAILHPOWERV, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-railhpowerv");
         }
         return 1;
     }
@@ -1003,17 +1003,17 @@ int LayWire(int x, int y, short *tilePtr) {
         /* If we have connections, choose the appropriate power line tile */
         if (connectMask != 0) {
             /* Use the proper tile from the wire table */
-            *tilePtr = WireTable[connectMask & 15] | CONDBIT | BULLBIT | BURNBIT;
+            setMapTile(x, y, WireTable[connectMask & 15], CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-wiretable");
         } else {
             /* Special case for vertical alignment - if this is a second vertical tile, 
                use VPOWER instead of LHPOWER to avoid the upside-down L issue */
             if (y > 0 && (Map[y-1][x] & LOMASK) == VPOWER) {
-                *tilePtr = VPOWER | CONDBIT | BULLBIT | BURNBIT;
+                setMapTile(x, y, VPOWER, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-vpower");
             } else if (y < WORLD_Y - 1 && (Map[y+1][x] & LOMASK) == VPOWER) {
-                *tilePtr = VPOWER | CONDBIT | BULLBIT | BURNBIT;
+                setMapTile(x, y, VPOWER, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-vpower");
             } else {
                 /* Default to LHPOWER (horizontal power line) */
-                *tilePtr = LHPOWER | CONDBIT | BULLBIT | BURNBIT;
+                setMapTile(x, y, LHPOWER, CONDBIT | BULLBIT | BURNBIT, TILE_SET_REPLACE, "LayWire-lhpower");
             }
         }
         return 1;
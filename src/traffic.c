@@ -5,6 +5,9 @@
 #include "sim.h"
 #include "tiles.h"
 #include "sprite.h"
+#include "roadnet.h"
+#include "trafflow.h"
+#include "minimap.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -28,10 +31,16 @@ static short Zsource;  /* Source zone type */
 static short TrafMaxX; /* Traffic density peak X */
 static short TrafMaxY; /* Traffic density peak Y */
 
+static int TrafficEngine = TRAFFIC_ENGINE_WALK;
+
 /* Direction offsets for perimeter search */
 static short PerimX[12] = {-1, 0, 1, 2, 2, 2, 1, 0, -1, -2, -2, -2};
 static short PerimY[12] = {-2, -2, -2, -1, 0, 1, 2, 2, 2, 1, 0, -1};
 
+/* Road/rail tiles on the perimeter of every tile - bit z is set when
+ * (x + PerimX[z], y + PerimY[z]) passes RoadTest. Kept by setMapTile(). */
+static unsigned short PerimRoadMask[WORLD_Y][WORLD_X];
+
 /* Function prototypes */
 int FindPRoad(void);
 static int TryDrive(void);
@@ -45,14 +54,7 @@ static void SetTrafMem(void);
 
 /* Road test - check if a tile is part of the road/rail network */
 static int RoadTest(int x) {
-    x = x & LOMASK;
-
-    /* Not a road or rail if it's outside the valid ranges */
-    if (x < ROADBASE || x > LASTRAIL || (x >= POWERBASE && x < RAILBASE)) {
-        return 0;
-    }
-
-    return 1;
+    return IsRoadNetTile(x);
 }
 
 /* Get the type of a tile in a given direction */
@@ -103,28 +105,53 @@ static void PullPos(void) {
 
 /* Look for a road on the perimeter of a zone */
 int FindPRoad(void) {
-    int tx, ty, z;
+    int mask, z;
+
+    if (!TestBounds(SMapX, SMapY)) {
+        return 0;
+    }
+
+    mask = PerimRoadMask[SMapY][SMapX];
+    if (!mask) {
+        return 0;
+    }
+
+    /* Lowest bit is the first road in perimeter order */
+    z = 0;
+    while (!(mask & (1 << z))) {
+        z++;
+    }
+    SMapX += PerimX[z];
+    SMapY += PerimY[z];
+    return 1;
+}
+
+/* Called by setMapTile() for every tile change */
+void RoadMaskTileChanged(int x, int y, int oldTile, int newTile) {
+    int z, cx, cy, road;
+
+    road = RoadTest(newTile);
+    if (RoadTest(oldTile) == road) {
+        return;
+    }
 
+    /* Every tile that has this one on its perimeter */
     for (z = 0; z < 12; z++) {
-        tx = SMapX + PerimX[z];
-        ty = SMapY + PerimY[z];
-        if (TestBounds(tx, ty)) {
-            if (RoadTest(Map[ty][tx])) {
-                SMapX = tx;
-                SMapY = ty;
-                return 1;
+        cx = x - PerimX[z];
+        cy = y - PerimY[z];
+        if (TestBounds(cx, cy)) {
+            if (road) {
+                PerimRoadMask[cy][cx] |= (unsigned short)(1 << z);
+            } else {
+                PerimRoadMask[cy][cx] &= (unsigned short)~(1 << z);
             }
         }
     }
-    return 0;
 }
 
 /* Check if we've reached the destination */
 static int DriveDone(void) {
-    /* Match original WiNTown traffic destinations from s_traf.c */
-    static short TARGL[3] = {COMBASE, LHTHR, LHTHR};     /* R>C C>I I>R */
-    static short TARGH[3] = {NUCLEAR, PORT, COMBASE};    /* for destinations */
-    int z, l, h;
+    /* Destinations match original WiNTown s_traf.c - see IsTripDestination */
     
     /* Bounds check for Zsource to prevent array overflow */
     if (Zsource < 0 || Zsource >= 3) {
@@ -132,39 +159,24 @@ static int DriveDone(void) {
         return 0;
     }
 
-    l = TARGL[Zsource];
-    h = TARGH[Zsource];
-
     /* Check north */
-    if (SMapY > 0) {
-        z = Map[SMapY - 1][SMapX] & LOMASK;
-        if ((z >= l) && (z <= h)) {
-            return 1;
-        }
+    if (SMapY > 0 && IsTripDestination(Zsource, Map[SMapY - 1][SMapX])) {
+        return 1;
     }
 
     /* Check east */
-    if (SMapX < (WORLD_X - 1)) {
-        z = Map[SMapY][SMapX + 1] & LOMASK;
-        if ((z >= l) && (z <= h)) {
-            return 1;
-        }
+    if (SMapX < (WORLD_X - 1) && IsTripDestination(Zsource, Map[SMapY][SMapX + 1])) {
+        return 1;
     }
 
     /* Check south */
-    if (SMapY < (WORLD_Y - 1)) {
-        z = Map[SMapY + 1][SMapX] & LOMASK;
-        if ((z >= l) && (z <= h)) {
-            return 1;
-        }
+    if (SMapY < (WORLD_Y - 1) && IsTripDestination(Zsource, Map[SMapY + 1][SMapX])) {
+        return 1;
     }
 
     /* Check west */
-    if (SMapX > 0) {
-        z = Map[SMapY][SMapX - 1] & LOMASK;
-        if ((z >= l) && (z <= h)) {
-            return 1;
-        }
+    if (SMapX > 0 && IsTripDestination(Zsource, Map[SMapY][SMapX - 1])) {
+        return 1;
     }
 
     return 0;
@@ -296,6 +308,7 @@ static void SetTrafMem(void) {
 /* Make a trip from a specific zone type */
 int MakeTraffic(int zoneType) {
     short xtem, ytem;
+    int passed;
 
     /* Check for valid zone type (0=res, 1=com, 2=ind) */
     if (zoneType < 0 || zoneType > 2) {
@@ -315,6 +328,21 @@ int MakeTraffic(int zoneType) {
 
     /* Look for a road on the zone perimeter */
     if (FindPRoad()) {
+        /* Nowhere on this network to drive to - no walk can succeed */
+        if (!RoadNetHasTripDestination(SMapX, SMapY, zoneType)) {
+            SMapX = xtem;
+            SMapY = ytem;
+            return 0; /* Traffic failed */
+        }
+
+        /* Leave the trip to the next batch assignment */
+        if (TrafficEngine == TRAFFIC_ENGINE_FLOW) {
+            passed = FlowTrip(SMapX, SMapY, zoneType);
+            SMapX = xtem;
+            SMapY = ytem;
+            return passed;
+        }
+
         /* Attempt to drive somewhere */
         if (TryDrive()) {
             /* If successful, increase traffic density */
@@ -331,117 +359,162 @@ int MakeTraffic(int zoneType) {
     }
 }
 
-/* Decrease traffic values over time */
-void DecTrafficMap(void) {
-    int x, y;
-    int fullX, fullY; /* Full-sized map coordinates */
-    int dx, dy;       /* Offsets within density cell */
-    int mapX, mapY;   /* Actual map coordinates */
-    int tile;         /* Tile value */
+void SetTrafficEngine(int engine) {
+    if (engine != TRAFFIC_ENGINE_WALK && engine != TRAFFIC_ENGINE_FLOW) {
+        return;
+    }
+    if (TrafficEngine == TRAFFIC_ENGINE_FLOW && engine != TRAFFIC_ENGINE_FLOW) {
+        StopTrafficFlow();
+    }
+    TrafficEngine = engine;
+    addDebugLog("Traffic engine set to %d", engine);
+}
+
+int GetTrafficEngine(void) {
+    return TrafficEngine;
+}
+
+/* Road tile after a traffic pass over its cell. A cell that has just
+ * emptied downgrades heavy traffic and stops animating; on average passes
+ * a busy cell animates its roads by how busy it is. */
+static int TrafficTile(int tile, int density, int emptied, int average) {
+    int lo;
+
+    lo = tile & LOMASK;
+    if (lo < ROADBASE || lo > LASTROAD) {
+        return tile;
+    }
+
+    if (emptied) {
+        if (lo >= HTRFBASE) {
+            return (tile & ~LOMASK) | (lo - HTRFBASE + ROADBASE);
+        }
+        return tile & ~ANIMBIT;
+    }
 
+    if (!average || density == 0) {
+        return tile;
+    }
+    if (density > 40) {
+        /* Heavy traffic */
+        if (lo < HTRFBASE) {
+            tile = (tile & ~LOMASK) | (lo - ROADBASE + HTRFBASE);
+        }
+        return tile | ANIMBIT;
+    }
+    if (density > 10 && (Fcycle & 3) == 0) {
+        /* Light traffic - some passes animate */
+        return tile | ANIMBIT;
+    }
+    return tile & ~ANIMBIT;
+}
+
+/* Road tiles whose traffic state changes, applied after the sweep */
+static short ChangeX[WORLD_X * WORLD_Y];
+static short ChangeY[WORLD_X * WORLD_Y];
+static short ChangeTile[WORLD_X * WORLD_Y];
+
+/* One sweep over TrfDensity that decays it, sums the averages and works
+ * out the road tiles of each cell together. Only tiles that actually
+ * change go through setMapTile(). */
+static void SweepTraffic(int decay, int average) {
+    int x, y, dx, dy, mapX, mapY;
+    int density, emptied, tile, newTile, changes, i;
+    long total = 0;
+    int count = 0;
+    long devTotal = 0;
+    int devCount = 0;
+
+    changes = 0;
     for (y = 0; y < WORLD_Y / 2; y++) {
         for (x = 0; x < WORLD_X / 2; x++) {
-            if (TrfDensity[y][x] > 0) {
-                /* Gradually decrease traffic */
-                TrfDensity[y][x] = (Byte)(TrfDensity[y][x] - (TrfDensity[y][x] / 8 + 1));
-
-                /* If traffic decreases to zero, make sure to remove animation bits */
-                if (TrfDensity[y][x] == 0) {
-                    /* Clear animation bits in corresponding full-size map tiles */
-                    fullX = x * 2;
-                    fullY = y * 2;
-
-                    for (dy = 0; dy < 2; dy++) {
-                        for (dx = 0; dx < 2; dx++) {
-                            mapX = fullX + dx;
-                            mapY = fullY + dy;
-
-                            if (mapX < WORLD_X && mapY < WORLD_Y) {
-                                tile = Map[mapY][mapX] & LOMASK;
-
-                                /* Only update road tiles */
-                                if (tile >= ROADBASE && tile <= LASTROAD) {
-                                    /* If this is a heavy traffic tile, convert back to normal road
-                                     */
-                                    if (tile >= HTRFBASE) {
-                                        setMapTile(mapX, mapY, tile - HTRFBASE + ROADBASE, 0, TILE_SET_PRESERVE, "DecTrafficMap-downgrade");
-                                    } else {
-                                        /* Otherwise just clear animation bit */
-                                        setMapTile(mapX, mapY, 0, ANIMBIT, TILE_CLEAR_FLAGS, "DecTrafficMap-clear");
-                                    }
-                                }
-                            }
-                        }
+            density = TrfDensity[y][x];
+            emptied = 0;
+            if (decay && density > 0) {
+                density -= density / 8 + 1;
+                TrfDensity[y][x] = (Byte)density;
+                emptied = (density == 0);
+            }
+
+            if (average) {
+                /* Developed land total for the city evaluation */
+                if (LandValueMem[y][x]) {
+                    devTotal += density;
+                    devCount++;
+                }
+                if (density > 0) {
+                    total += density;
+                    count++;
+                }
+            }
+
+            if (!emptied && !(average && density > 0)) {
+                continue;
+            }
+            for (dy = 0; dy < 2; dy++) {
+                mapY = y * 2 + dy;
+                for (dx = 0; dx < 2; dx++) {
+                    mapX = x * 2 + dx;
+                    tile = Map[mapY][mapX];
+                    newTile = TrafficTile(tile, density, emptied, average);
+                    if (newTile != tile) {
+                        ChangeX[changes] = (short)mapX;
+                        ChangeY[changes] = (short)mapY;
+                        ChangeTile[changes] = (short)newTile;
+                        changes++;
                     }
                 }
             }
         }
     }
+
+    for (i = 0; i < changes; i++) {
+        setMapTile(ChangeX[i], ChangeY[i], ChangeTile[i], 0, TILE_SET_REPLACE, "SweepTraffic");
+    }
+    MinimapOverlayChanged(MINIMAP_MODE_TRAFFIC);
+
+    if (average) {
+        TrafficAverage = count > 0 ? (int)(total / count) : 0;
+        DevTrfTotal = devTotal;
+        DevTrfCount = devCount;
+    }
+}
+
+/* Decay the traffic map and, when asked, refresh the averages and the
+   road animation in the same pass */
+void UpdateTrafficMap(int average) {
+    SweepTraffic(1, average);
 }
 
-/* Calculate traffic density average */
+/* Decrease traffic values over time */
+void DecTrafficMap(void) {
+    SweepTraffic(1, 0);
+}
+
+/* Calculate traffic density average - the map is left alone, the road
+   animation follows the density on the next UpdateTrafficMap() */
 void CalcTrafficAverage(void) {
-    int x, y;
+    int x, y, density;
     long total = 0;
     int count = 0;
-    int fullX, fullY; /* Full-sized map coordinates */
-    int dx, dy;       /* Offsets within density cell */
-    int mapX, mapY;   /* Actual map coordinates */
-    int tile;         /* Tile value */
+    long devTotal = 0;
+    int devCount = 0;
 
     for (y = 0; y < WORLD_Y / 2; y++) {
         for (x = 0; x < WORLD_X / 2; x++) {
-            if (TrfDensity[y][x] > 0) {
-                total += TrfDensity[y][x];
+            density = TrfDensity[y][x];
+            if (LandValueMem[y][x]) {
+                devTotal += density;
+                devCount++;
+            }
+            if (density > 0) {
+                total += density;
                 count++;
-
-                /* Apply animation bit to corresponding map tiles with traffic */
-                fullX = x * 2;
-                fullY = y * 2;
-
-                /* Check all four tiles in the full-size map that this density tile covers */
-                for (dy = 0; dy < 2; dy++) {
-                    for (dx = 0; dx < 2; dx++) {
-                        mapX = fullX + dx;
-                        mapY = fullY + dy;
-
-                        if (mapX < WORLD_X && mapY < WORLD_Y) {
-                            tile = Map[mapY][mapX] & LOMASK;
-
-                            /* Only set ANIMBIT on road tiles */
-                            if (tile >= ROADBASE && tile <= LASTROAD) {
-                                /* Heavy traffic */
-                                if (TrfDensity[y][x] > 40) {
-                                    /* Only convert to heavy traffic if not already heavy traffic */
-                                    if (tile < HTRFBASE) {
-                                        /* Set animation bit and add HTRFBASE offset */
-                                        setMapTile(mapX, mapY, tile - ROADBASE + HTRFBASE, ANIMBIT, TILE_SET_PRESERVE, "CalcTrafficAverage-heavy");
-                                    } else {
-                                        /* Already heavy traffic, just set animation bit */
-                                        setMapTile(mapX, mapY, 0, ANIMBIT, TILE_SET_FLAGS, "CalcTrafficAverage-heavy-existing");
-                                    }
-                                }
-                                /* Light traffic - randomly animate some tiles */
-                                else if (TrfDensity[y][x] > 10 && ((Fcycle & 3) == 0)) {
-                                    /* Set animation bit but keep at ROADBASE */
-                                    setMapTile(mapX, mapY, 0, ANIMBIT, TILE_SET_FLAGS, "CalcTrafficAverage-light");
-                                }
-                                /* No traffic or very light - clear animation */
-                                else {
-                                    /* Clear animation bit */
-                                    setMapTile(mapX, mapY, 0, ANIMBIT, TILE_CLEAR_FLAGS, "CalcTrafficAverage-clear");
-                                }
-                            }
-                        }
-                    }
-                }
             }
         }
     }
 
-    if (count > 0) {
-        TrafficAverage = (int)(total / count);
-    } else {
-        TrafficAverage = 0;
-    }
-}
\ No newline at end of file
+    TrafficAverage = count > 0 ? (int)(total / count) : 0;
+    DevTrfTotal = devTotal;
+    DevTrfCount = devCount;
+}
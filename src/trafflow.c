@@ -0,0 +1,623 @@
+/* trafflow.c - Link-based traffic assignment for WiNTown
+ * Each zone type sends its trips to the nearest destination of its kind
+ * (R>C, C>I, I>R as in the walk). One search per type runs outward from
+ * every destination at once, so each node learns its time to the nearest
+ * one and the link to take. Trips are then loaded down that tree in a
+ * single sweep. Link times follow the BPR curve, t0 * (1 + 0.15 (v/c)^4),
+ * and the loads are averaged over a few iterations (method of successive
+ * averages) so busy links shed trips onto quieter ones.
+ *
+ * The three types are independent within an iteration and run on worker
+ * threads. Workers only read the graph and the link times and write their
+ * own arrays; the main thread waits for all three before touching the
+ * map, so results do not depend on scheduling.
+ */
+
+#include "sim.h"
+#include "sprite.h"
+#include "roadnet.h"
+#include "trafflow.h"
+#include <string.h>
+#include <windows.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+#define FLOW_TYPES       3
+#define FLOW_ITERATIONS  4
+#define FLOW_MAX_TRIPS   4096
+#define FLOW_FAR         0x7FFFFFFF
+#define FLOW_NO_LINK     0xFFFF
+
+/* Free flow time per tile, and trips per batch a link carries before it
+   slows noticeably. Rail is faster and carries more. */
+#define FLOW_ROAD_TIME     16
+#define FLOW_RAIL_TIME     8
+#define FLOW_ROAD_CAPACITY 6.0f
+#define FLOW_RAIL_CAPACITY 16.0f
+
+/* Longest trip that still counts - MAXDIS tiles of free road */
+#define FLOW_MAX_TRIP_TIME (30 * FLOW_ROAD_TIME)
+
+/* Density each trip leaves in a cell it passes, as SetTrafMem() adds */
+#define FLOW_TRIP_DENSITY 50
+
+/* Destinations of one type beside a node, or along a link between the
+   lo and hi tiles counted from the link's first node */
+typedef struct {
+    unsigned short node;
+    unsigned short link; /* FLOW_NO_LINK for a node */
+    unsigned short lo;
+    unsigned short hi;
+} FlowSeed;
+
+/* Per type search state, one per worker */
+typedef struct {
+    int zoneType;
+    int dist[ROADNET_MAX_NODES];
+    unsigned short exitLink[ROADNET_MAX_NODES]; /* First link towards the destination */
+    unsigned short next[ROADNET_MAX_NODES];     /* Node after it, itself if the trip ends on it */
+    unsigned short order[ROADNET_MAX_NODES];    /* Nodes in the order they settled */
+    unsigned short heapNode[ROADNET_MAX_NODES];
+    unsigned short heapPos[ROADNET_MAX_NODES];  /* Heap index plus one, 0 if not queued */
+    int heapSize;
+    int settled;
+    float flow[ROADNET_MAX_NODES];  /* Trips passing through each node */
+    float load[ROADNET_MAX_EDGES];  /* All-or-nothing load per link this iteration */
+    HANDLE thread;
+    HANDLE start;
+    HANDLE done;
+} FlowWorker;
+
+static FlowWorker Workers[FLOW_TYPES];
+static volatile LONG WorkersQuit = 0;
+static int WorkersStarted = 0;
+
+/* Graph being assigned - read by the workers */
+static const RoadNetGraph *FlowGraph = NULL;
+
+/* Trips queued since the last assignment, and where they join the graph */
+static short TripX[FLOW_MAX_TRIPS];
+static short TripY[FLOW_MAX_TRIPS];
+static unsigned char TripType[FLOW_MAX_TRIPS];
+static int TripEnds[FLOW_MAX_TRIPS];
+static int TripNode[FLOW_MAX_TRIPS][2];
+static int TripDist[FLOW_MAX_TRIPS][2];
+static int TripLink[FLOW_MAX_TRIPS];
+static int TripCount = 0;
+
+static FlowSeed Seeds[FLOW_TYPES][ROADNET_MAX_NODES];
+static int SeedCount[FLOW_TYPES];
+static int LinkCount = 0;
+
+/* Per link, indexed by the link's edge */
+static float LinkVolume[ROADNET_MAX_EDGES];
+static float LinkCapacity[ROADNET_MAX_EDGES];
+static int LinkFreeTime[ROADNET_MAX_EDGES];
+static int LinkTime[ROADNET_MAX_EDGES];
+
+/* Results of the last assignment, for judging new trips */
+static unsigned long AssignedVersion = 0;
+static int Assigned = 0;
+static int TripTime[FLOW_TYPES][ROADNET_MAX_NODES];
+
+static short LinkX[WORLD_X * WORLD_Y];
+static short LinkY[WORLD_X * WORLD_Y];
+static float CellTrips[WORLD_Y / 2][WORLD_X / 2];
+
+static int IsRailTile(int tile) {
+    tile &= LOMASK;
+    return tile >= RAILBASE && tile <= LASTRAIL;
+}
+
+/* Time to drive part of a link */
+static int PartTime(int link, int tiles) {
+    return (int)(((long)LinkTime[link] * tiles) / FlowGraph->edgeLen[link]);
+}
+
+int FlowTrip(int x, int y, int zoneType) {
+    const RoadNetGraph *g;
+    int node[2], dist[2], link, ends, i, best, t;
+
+    if (zoneType < 0 || zoneType >= FLOW_TYPES) {
+        return 0;
+    }
+    if (TripCount < FLOW_MAX_TRIPS) {
+        TripX[TripCount] = (short)x;
+        TripY[TripCount] = (short)y;
+        TripType[TripCount] = (unsigned char)zoneType;
+        TripCount++;
+    }
+
+    g = GetRoadNetGraph();
+    if (!Assigned || g->version != AssignedVersion) {
+        return 1;
+    }
+
+    FlowGraph = g;
+    ends = RoadNetTileEnds(x, y, node, dist, &link);
+    best = FLOW_FAR;
+    for (i = 0; i < ends; i++) {
+        if (TripTime[zoneType][node[i]] == FLOW_FAR) {
+            continue;
+        }
+        t = TripTime[zoneType][node[i]];
+        if (link >= 0) {
+            t += PartTime(link, dist[i]);
+        }
+        if (t < best) {
+            best = t;
+        }
+    }
+    return best <= FLOW_MAX_TRIP_TIME;
+}
+
+/* Lower a node's time, queueing it if needed */
+static void HeapUpdate(FlowWorker *w, int node, int dist, int link, int next) {
+    int i, parent;
+
+    if (w->dist[node] <= dist) {
+        return;
+    }
+    w->dist[node] = dist;
+    w->exitLink[node] = (unsigned short)link;
+    w->next[node] = (unsigned short)next;
+
+    i = w->heapPos[node] ? w->heapPos[node] - 1 : w->heapSize++;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (w->dist[w->heapNode[parent]] <= dist) {
+            break;
+        }
+        w->heapNode[i] = w->heapNode[parent];
+        w->heapPos[w->heapNode[i]] = (unsigned short)(i + 1);
+        i = parent;
+    }
+    w->heapNode[i] = (unsigned short)node;
+    w->heapPos[node] = (unsigned short)(i + 1);
+}
+
+static int HeapPop(FlowWorker *w) {
+    int top, last, i, child, dist;
+
+    top = w->heapNode[0];
+    w->heapPos[top] = 0;
+    last = w->heapNode[--w->heapSize];
+    if (w->heapSize == 0) {
+        return top;
+    }
+
+    dist = w->dist[last];
+    i = 0;
+    for (;;) {
+        child = i * 2 + 1;
+        if (child >= w->heapSize) {
+            break;
+        }
+        if (child + 1 < w->heapSize && w->dist[w->heapNode[child + 1]] < w->dist[w->heapNode[child]]) {
+            child++;
+        }
+        if (dist <= w->dist[w->heapNode[child]]) {
+            break;
+        }
+        w->heapNode[i] = w->heapNode[child];
+        w->heapPos[w->heapNode[i]] = (unsigned short)(i + 1);
+        i = child;
+    }
+    w->heapNode[i] = (unsigned short)last;
+    w->heapPos[last] = (unsigned short)(i + 1);
+    return top;
+}
+
+/* Times from every node to the nearest destination of the worker's type */
+static void SearchFromDestinations(FlowWorker *w) {
+    const RoadNetGraph *g;
+    const FlowSeed *s;
+    int n, i, u, e, du, len;
+
+    g = FlowGraph;
+    for (n = 0; n < g->nodeCount; n++) {
+        w->dist[n] = FLOW_FAR;
+        w->heapPos[n] = 0;
+    }
+    w->heapSize = 0;
+    w->settled = 0;
+
+    for (i = 0; i < SeedCount[w->zoneType]; i++) {
+        s = &Seeds[w->zoneType][i];
+        if (s->link == FLOW_NO_LINK) {
+            HeapUpdate(w, s->node, 0, FLOW_NO_LINK, s->node);
+            continue;
+        }
+        len = g->edgeLen[s->link];
+        HeapUpdate(w, g->edgeFrom[s->link], PartTime(s->link, s->lo), s->link, g->edgeFrom[s->link]);
+        HeapUpdate(w, g->edgeTo[s->link], PartTime(s->link, len - s->hi), s->link, g->edgeTo[s->link]);
+    }
+
+    while (w->heapSize > 0) {
+        u = HeapPop(w);
+        w->order[w->settled++] = (unsigned short)u;
+        du = w->dist[u];
+        for (e = g->edgeStart[u]; e < g->edgeStart[u + 1]; e++) {
+            HeapUpdate(w, g->edgeTo[e], du + LinkTime[g->edgeLink[e]], g->edgeLink[e], u);
+        }
+    }
+}
+
+/* Send the worker's trips down the search tree, loading each link once */
+static void LoadTrips(FlowWorker *w) {
+    const RoadNetGraph *g;
+    int i, n, best, end, t, k;
+    float f;
+
+    g = FlowGraph;
+    for (n = 0; n < g->nodeCount; n++) {
+        w->flow[n] = 0.0f;
+    }
+    for (i = 0; i < g->edgeCount; i++) {
+        w->load[i] = 0.0f;
+    }
+
+    /* Each trip joins at whichever end of its run is quicker */
+    for (i = 0; i < TripCount; i++) {
+        if (TripType[i] != w->zoneType) {
+            continue;
+        }
+        best = FLOW_FAR;
+        end = -1;
+        for (k = 0; k < TripEnds[i]; k++) {
+            if (w->dist[TripNode[i][k]] == FLOW_FAR) {
+                continue;
+            }
+            t = w->dist[TripNode[i][k]];
+            if (TripLink[i] >= 0) {
+                t += PartTime(TripLink[i], TripDist[i][k]);
+            }
+            if (t < best) {
+                best = t;
+                end = k;
+            }
+        }
+        if (end < 0) {
+            continue;
+        }
+        w->flow[TripNode[i][end]] += 1.0f;
+        if (TripLink[i] >= 0) {
+            w->load[TripLink[i]] += 1.0f;
+        }
+    }
+
+    /* Farthest first, so a node's flow is complete before it moves on */
+    for (i = w->settled - 1; i >= 0; i--) {
+        n = w->order[i];
+        f = w->flow[n];
+        if (f == 0.0f) {
+            continue;
+        }
+        if (w->exitLink[n] != FLOW_NO_LINK) {
+            w->load[w->exitLink[n]] += f;
+        }
+        if (w->next[n] != n) {
+            w->flow[w->next[n]] += f;
+        }
+    }
+}
+
+static void RunWorker(FlowWorker *w) {
+    SearchFromDestinations(w);
+    LoadTrips(w);
+}
+
+static DWORD WINAPI FlowWorkerMain(LPVOID param) {
+    FlowWorker *w;
+
+    w = (FlowWorker *)param;
+    for (;;) {
+        WaitForSingleObject(w->start, INFINITE);
+        if (WorkersQuit) {
+            break;
+        }
+        RunWorker(w);
+        SetEvent(w->done);
+    }
+    return 0;
+}
+
+static void CloseWorkers(void) {
+    int k;
+
+    InterlockedExchange((LONG *)&WorkersQuit, 1);
+    for (k = 0; k < FLOW_TYPES; k++) {
+        if (Workers[k].thread) {
+            SetEvent(Workers[k].start);
+            WaitForSingleObject(Workers[k].thread, INFINITE);
+            CloseHandle(Workers[k].thread);
+            Workers[k].thread = NULL;
+        }
+        if (Workers[k].start) {
+            CloseHandle(Workers[k].start);
+            Workers[k].start = NULL;
+        }
+        if (Workers[k].done) {
+            CloseHandle(Workers[k].done);
+            Workers[k].done = NULL;
+        }
+    }
+}
+
+/* Fall back to running the types one after another if any thread won't start */
+static void StartWorkers(void) {
+    DWORD threadId;
+    int k;
+
+    WorkersStarted = 1;
+    WorkersQuit = 0;
+    for (k = 0; k < FLOW_TYPES; k++) {
+        Workers[k].zoneType = k;
+        Workers[k].start = CreateEvent(NULL, FALSE, FALSE, NULL);
+        Workers[k].done = CreateEvent(NULL, FALSE, FALSE, NULL);
+        Workers[k].thread = NULL;
+        if (Workers[k].start && Workers[k].done) {
+            Workers[k].thread = CreateThread(NULL, 0, FlowWorkerMain, &Workers[k], 0, &threadId);
+        }
+        if (!Workers[k].thread) {
+            addDebugLog("Traffic flow: worker threads unavailable, assigning serially");
+            CloseWorkers();
+            return;
+        }
+    }
+}
+
+static void RunWorkers(void) {
+    HANDLE done[FLOW_TYPES];
+    int k;
+
+    if (!Workers[0].thread) {
+        for (k = 0; k < FLOW_TYPES; k++) {
+            Workers[k].zoneType = k;
+            RunWorker(&Workers[k]);
+        }
+        return;
+    }
+    for (k = 0; k < FLOW_TYPES; k++) {
+        done[k] = Workers[k].done;
+        SetEvent(Workers[k].start);
+    }
+    WaitForMultipleObjects(FLOW_TYPES, done, TRUE, INFINITE);
+}
+
+void StopTrafficFlow(void) {
+    CloseWorkers();
+    WorkersStarted = 0;
+    TripCount = 0;
+    Assigned = 0;
+}
+
+/* Free times and capacities, and where the destinations are */
+static void PrepareLinks(void) {
+    const RoadNetGraph *g;
+    int e, i, count, rail, k, d, x, y, tx, ty, n;
+    int lo[FLOW_TYPES], hi[FLOW_TYPES];
+    int dest[FLOW_TYPES];
+    FlowSeed *s;
+
+    g = FlowGraph;
+    for (k = 0; k < FLOW_TYPES; k++) {
+        SeedCount[k] = 0;
+    }
+    LinkCount = 0;
+
+    for (e = 0; e < g->edgeCount; e++) {
+        if (g->edgeLink[e] != e) {
+            continue;
+        }
+        count = RoadNetLinkTiles(e, LinkX, LinkY);
+        LinkCount++;
+
+        rail = 0;
+        for (k = 0; k < FLOW_TYPES; k++) {
+            lo[k] = 0;
+            hi[k] = 0;
+        }
+        for (i = 0; i < count; i++) {
+            if (IsRailTile(Map[LinkY[i]][LinkX[i]])) {
+                rail++;
+            }
+            for (d = 0; d < 4; d++) {
+                tx = LinkX[i] + (d == 1) - (d == 3);
+                ty = LinkY[i] + (d == 2) - (d == 0);
+                if (!BOUNDS_CHECK(tx, ty)) {
+                    continue;
+                }
+                for (k = 0; k < FLOW_TYPES; k++) {
+                    if (IsTripDestination(k, Map[ty][tx])) {
+                        if (!lo[k]) {
+                            lo[k] = i + 1;
+                        }
+                        hi[k] = i + 1;
+                    }
+                }
+            }
+        }
+
+        /* Mostly rail runs as rail */
+        if (rail * 2 > count) {
+            LinkFreeTime[e] = g->edgeLen[e] * FLOW_RAIL_TIME;
+            LinkCapacity[e] = FLOW_RAIL_CAPACITY;
+        } else {
+            LinkFreeTime[e] = g->edgeLen[e] * FLOW_ROAD_TIME;
+            LinkCapacity[e] = FLOW_ROAD_CAPACITY;
+        }
+        LinkVolume[e] = 0.0f;
+
+        for (k = 0; k < FLOW_TYPES; k++) {
+            if (lo[k]) {
+                s = &Seeds[k][SeedCount[k]++];
+                s->node = g->edgeFrom[e];
+                s->link = (unsigned short)e;
+                s->lo = (unsigned short)lo[k];
+                s->hi = (unsigned short)hi[k];
+            }
+        }
+    }
+
+    /* Destinations beside the nodes themselves */
+    for (n = 0; n < g->nodeCount; n++) {
+        x = g->nodeTile[n] % WORLD_X;
+        y = g->nodeTile[n] / WORLD_X;
+        for (k = 0; k < FLOW_TYPES; k++) {
+            dest[k] = 0;
+        }
+        for (d = 0; d < 4; d++) {
+            tx = x + (d == 1) - (d == 3);
+            ty = y + (d == 2) - (d == 0);
+            if (!BOUNDS_CHECK(tx, ty)) {
+                continue;
+            }
+            for (k = 0; k < FLOW_TYPES; k++) {
+                dest[k] |= IsTripDestination(k, Map[ty][tx]);
+            }
+        }
+        for (k = 0; k < FLOW_TYPES; k++) {
+            if (dest[k]) {
+                s = &Seeds[k][SeedCount[k]++];
+                s->node = (unsigned short)n;
+                s->link = FLOW_NO_LINK;
+                s->lo = 0;
+                s->hi = 0;
+            }
+        }
+    }
+
+    /* Where each queued trip joins the graph */
+    for (i = 0; i < TripCount; i++) {
+        TripEnds[i] = RoadNetTileEnds(TripX[i], TripY[i], TripNode[i], TripDist[i], &TripLink[i]);
+    }
+}
+
+/* BPR travel time for each link at its current volume */
+static void UpdateLinkTimes(void) {
+    const RoadNetGraph *g;
+    int e;
+    float r;
+
+    g = FlowGraph;
+    for (e = 0; e < g->edgeCount; e++) {
+        if (g->edgeLink[e] != e) {
+            continue;
+        }
+        r = LinkVolume[e] / LinkCapacity[e];
+        r = r * r;
+        LinkTime[e] = (int)(LinkFreeTime[e] * (1.0f + 0.15f * r * r));
+        if (LinkTime[e] < 1) {
+            LinkTime[e] = 1;
+        }
+    }
+}
+
+/* Heaviest load in each density cell, links and nodes alike */
+static void GatherCellTrips(void) {
+    const RoadNetGraph *g;
+    int e, i, n, k, count, x, y, tile;
+    float v;
+
+    g = FlowGraph;
+    memset(CellTrips, 0, sizeof(CellTrips));
+
+    for (e = 0; e < g->edgeCount; e++) {
+        if (g->edgeLink[e] != e || LinkVolume[e] <= 0.0f) {
+            continue;
+        }
+        count = RoadNetLinkTiles(e, LinkX, LinkY);
+        for (i = 0; i < count; i++) {
+            x = LinkX[i];
+            y = LinkY[i];
+            tile = Map[y][x] & LOMASK;
+            /* Roads and crossings, as SetTrafMem() counts */
+            if (tile >= ROADBASE && tile < POWERBASE && LinkVolume[e] > CellTrips[y >> 1][x >> 1]) {
+                CellTrips[y >> 1][x >> 1] = LinkVolume[e];
+            }
+        }
+    }
+
+    for (n = 0; n < g->nodeCount; n++) {
+        v = 0.0f;
+        for (k = 0; k < FLOW_TYPES; k++) {
+            v += Workers[k].flow[n];
+        }
+        x = g->nodeTile[n] % WORLD_X;
+        y = g->nodeTile[n] / WORLD_X;
+        tile = Map[y][x] & LOMASK;
+        if (tile >= ROADBASE && tile < POWERBASE && v > CellTrips[y >> 1][x >> 1]) {
+            CellTrips[y >> 1][x >> 1] = v;
+        }
+    }
+}
+
+static void WriteDensity(void) {
+    int x, y, z;
+
+    for (y = 0; y < WORLD_Y / 2; y++) {
+        for (x = 0; x < WORLD_X / 2; x++) {
+            if (CellTrips[y][x] <= 0.0f) {
+                continue;
+            }
+            z = TrfDensity[y][x] + (int)(CellTrips[y][x] * FLOW_TRIP_DENSITY + 0.5f);
+            if (z > 240) {
+                z = 240;
+                /* Police car at the jam, as for walked trips */
+                if (SimRandom(8) == 0) {
+                    NewSprite(SPRITE_POLICE, (x * 2) << 4, (y * 2) << 4);
+                }
+            }
+            TrfDensity[y][x] = (Byte)z;
+        }
+    }
+}
+
+void AssignTrafficFlow(void) {
+    const RoadNetGraph *g;
+    int it, e, k, n;
+    float total;
+
+    if (!WorkersStarted) {
+        StartWorkers();
+    }
+
+    g = GetRoadNetGraph();
+    FlowGraph = g;
+    PrepareLinks();
+
+    for (it = 1; it <= FLOW_ITERATIONS; it++) {
+        UpdateLinkTimes();
+        RunWorkers();
+
+        /* Successive averages - each iteration's loads weigh 1/it */
+        for (e = 0; e < g->edgeCount; e++) {
+            if (g->edgeLink[e] != e) {
+                continue;
+            }
+            total = 0.0f;
+            for (k = 0; k < FLOW_TYPES; k++) {
+                total += Workers[k].load[e];
+            }
+            LinkVolume[e] += (total - LinkVolume[e]) / it;
+        }
+    }
+
+    /* Times seen by the last search judge the trips until the next batch */
+    for (k = 0; k < FLOW_TYPES; k++) {
+        for (n = 0; n < g->nodeCount; n++) {
+            TripTime[k][n] = Workers[k].dist[n];
+        }
+    }
+    AssignedVersion = g->version;
+    Assigned = 1;
+
+    GatherCellTrips();
+    WriteDensity();
+
+    addDebugLog("Traffic flow: %d trips over %d links, %d iterations", TripCount, LinkCount,
+                FLOW_ITERATIONS);
+    TripCount = 0;
+}
@@ -0,0 +1,23 @@
+/* trafflow.h - Link-based traffic assignment for WiNTown
+ * The alternative to random-walk trips. Zones queue their trips during the
+ * map scan; once per traffic pass the whole batch is assigned over the
+ * road graph, with travel times that rise as links fill up, and the
+ * resulting loads are written into TrfDensity like walked trips.
+ */
+
+#ifndef _TRAFFLOW_H
+#define _TRAFFLOW_H
+
+/* Queue a trip from a zone's road tile for the next assignment. Returns 1
+   if the last assignment could reach a destination from there within a
+   trip's time, 0 if not. Until the first assignment after a network
+   change the trip is judged by connectivity alone and passes. */
+int FlowTrip(int x, int y, int zoneType);
+
+/* Assign the queued trips and add their loads to TrfDensity */
+void AssignTrafficFlow(void);
+
+/* Stop the worker threads, dropping any queued trips */
+void StopTrafficFlow(void);
+
+#endif /* _TRAFFLOW_H */
@@ -0,0 +1,326 @@
+/* trcdump.c - Decoder for WiNTown tile trace files
+ * Console tool: prints or summarises the tiles.trc written by tiletrace.c.
+ *
+ * Usage: trcdump [-s] [-c caller] [-r x0,y0,x1,y1] [-t from,to] [file]
+ *   -s  summary by caller and hottest tiles instead of one line per change
+ *   -c  only changes made by this caller
+ *   -r  only changes inside this map rectangle
+ *   -t  only changes from CityTime 'from' to 'to'
+ */
+
+#include "tiletrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Map size, as in sim.h */
+#define TRC_WORLD_X 120
+#define TRC_WORLD_Y 100
+
+/* Tile flag bits, as in sim.h */
+#define TRC_LOMASK   0x03ff
+#define TRC_ZONEBIT  0x0400
+#define TRC_ANIMBIT  0x0800
+#define TRC_BULLBIT  0x1000
+#define TRC_BURNBIT  0x2000
+#define TRC_CONDBIT  0x4000
+#define TRC_POWERBIT 0x8000
+
+#define TRC_HOT_TILES 10
+
+static char *callerNames[TRACE_MAX_CALLERS];
+static long callerCounts[TRACE_MAX_CALLERS];
+static long tileCounts[TRC_WORLD_Y][TRC_WORLD_X];
+
+/* Filters */
+static char *filterCaller = NULL;
+static int filterRect = 0;
+static int rectX0, rectY0, rectX1, rectY1;
+static int filterTime = 0;
+static long timeFrom, timeTo;
+static int summaryMode = 0;
+
+/* Totals */
+static long totalRecords = 0;
+static long shownRecords = 0;
+static long rejectedRecords = 0;
+static long firstCycle = -1;
+static long lastCycle = -1;
+
+static const char *CallerName(unsigned short id) {
+    if (id < TRACE_MAX_CALLERS && callerNames[id]) {
+        return callerNames[id];
+    }
+    return "unknown";
+}
+
+static void FlagsToString(int tile, char *buffer) {
+    buffer[0] = '\0';
+    if (tile & TRC_POWERBIT) strcat(buffer, "P");
+    if (tile & TRC_CONDBIT) strcat(buffer, "C");
+    if (tile & TRC_BURNBIT) strcat(buffer, "B");
+    if (tile & TRC_BULLBIT) strcat(buffer, "D");
+    if (tile & TRC_ANIMBIT) strcat(buffer, "A");
+    if (tile & TRC_ZONEBIT) strcat(buffer, "Z");
+    if (buffer[0] == '\0') {
+        strcpy(buffer, "-");
+    }
+}
+
+static int PassesFilters(const TileTraceRecord *rec) {
+    if (filterCaller && strcmp(CallerName(rec->caller), filterCaller) != 0) {
+        return 0;
+    }
+    if (filterRect && (rec->x < rectX0 || rec->x > rectX1 || rec->y < rectY0 || rec->y > rectY1)) {
+        return 0;
+    }
+    if (filterTime && ((rec->cycle >> 4) < timeFrom || (rec->cycle >> 4) > timeTo)) {
+        return 0;
+    }
+    return 1;
+}
+
+static void ProcessRecord(const TileTraceRecord *rec) {
+    char oldFlags[8], newFlags[8];
+
+    totalRecords++;
+    if (!PassesFilters(rec)) {
+        return;
+    }
+
+    shownRecords++;
+    if (firstCycle < 0) {
+        firstCycle = rec->cycle;
+    }
+    lastCycle = rec->cycle;
+    if (rec->flags & TRACE_REJECTED) {
+        rejectedRecords++;
+    }
+
+    if (summaryMode) {
+        if (rec->caller < TRACE_MAX_CALLERS) {
+            callerCounts[rec->caller]++;
+        }
+        if (rec->x >= 0 && rec->x < TRC_WORLD_X && rec->y >= 0 && rec->y < TRC_WORLD_Y) {
+            tileCounts[rec->y][rec->x]++;
+        }
+        return;
+    }
+
+    if (rec->oldTile == 0xFFFF && rec->newTile == 0xFFFF) {
+        printf("%6ld.%-2ld [%3d,%3d] outside map %s REJECTED\n", rec->cycle >> 4, rec->cycle & 15,
+               rec->x, rec->y, CallerName(rec->caller));
+        return;
+    }
+
+    FlagsToString(rec->oldTile, oldFlags);
+    FlagsToString(rec->newTile, newFlags);
+    printf("%6ld.%-2ld [%3d,%3d] %4d %-6s -> %4d %-6s %s%s\n", rec->cycle >> 4, rec->cycle & 15,
+           rec->x, rec->y, rec->oldTile & TRC_LOMASK, oldFlags, rec->newTile & TRC_LOMASK, newFlags,
+           CallerName(rec->caller), (rec->flags & TRACE_REJECTED) ? " REJECTED" : "");
+}
+
+static void PrintSummary(void) {
+    long merged[TRACE_MAX_CALLERS];
+    int order[TRACE_MAX_CALLERS];
+    int i, j, n, t;
+    int hotX[TRC_HOT_TILES], hotY[TRC_HOT_TILES];
+    int x, y, k;
+
+    printf("%ld changes shown of %ld recorded, %ld rejected\n", shownRecords, totalRecords,
+           rejectedRecords);
+    if (shownRecords == 0) {
+        return;
+    }
+    printf("CityTime %ld.%ld to %ld.%ld\n\n", firstCycle >> 4, firstCycle & 15, lastCycle >> 4,
+           lastCycle & 15);
+
+    /* The same caller string may be interned once per source file */
+    n = 0;
+    for (i = 0; i < TRACE_MAX_CALLERS; i++) {
+        if (!callerCounts[i]) {
+            continue;
+        }
+        for (j = 0; j < n; j++) {
+            if (strcmp(CallerName((unsigned short)order[j]), CallerName((unsigned short)i)) == 0) {
+                break;
+            }
+        }
+        if (j == n) {
+            order[n] = i;
+            merged[n] = 0;
+            n++;
+        }
+        merged[j] += callerCounts[i];
+    }
+
+    /* Busiest callers first */
+    for (i = 1; i < n; i++) {
+        for (j = i; j > 0 && merged[j] > merged[j - 1]; j--) {
+            long c = merged[j];
+            merged[j] = merged[j - 1];
+            merged[j - 1] = c;
+            t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    }
+
+    printf("%10s %6s  %s\n", "changes", "share", "caller");
+    for (i = 0; i < n; i++) {
+        printf("%10ld %5.1f%%  %s\n", merged[i], merged[i] * 100.0 / shownRecords,
+               CallerName((unsigned short)order[i]));
+    }
+
+    /* Hottest tiles */
+    for (k = 0; k < TRC_HOT_TILES; k++) {
+        hotX[k] = -1;
+        hotY[k] = -1;
+    }
+    for (y = 0; y < TRC_WORLD_Y; y++) {
+        for (x = 0; x < TRC_WORLD_X; x++) {
+            if (!tileCounts[y][x]) {
+                continue;
+            }
+            for (k = TRC_HOT_TILES; k > 0; k--) {
+                if (hotX[k - 1] >= 0 && tileCounts[hotY[k - 1]][hotX[k - 1]] >= tileCounts[y][x]) {
+                    break;
+                }
+                if (k < TRC_HOT_TILES) {
+                    hotX[k] = hotX[k - 1];
+                    hotY[k] = hotY[k - 1];
+                }
+            }
+            if (k < TRC_HOT_TILES) {
+                hotX[k] = x;
+                hotY[k] = y;
+            }
+        }
+    }
+
+    printf("\n%10s  %s\n", "changes", "tile");
+    for (k = 0; k < TRC_HOT_TILES && hotX[k] >= 0; k++) {
+        printf("%10ld  [%d,%d]\n", tileCounts[hotY[k]][hotX[k]], hotX[k], hotY[k]);
+    }
+}
+
+/* Read one names block */
+static int ReadNames(FILE *f, long count) {
+    unsigned short id, len;
+    char *name;
+
+    while (count-- > 0) {
+        if (fread(&id, sizeof(id), 1, f) != 1 || fread(&len, sizeof(len), 1, f) != 1) {
+            return 0;
+        }
+        name = (char *)malloc(len + 1);
+        if (!name || fread(name, 1, len, f) != len) {
+            free(name);
+            return 0;
+        }
+        name[len] = '\0';
+        if (id < TRACE_MAX_CALLERS) {
+            free(callerNames[id]);
+            callerNames[id] = name;
+        } else {
+            free(name);
+        }
+    }
+    return 1;
+}
+
+/* Read one records block */
+static int ReadRecords(FILE *f, long count) {
+    TileTraceRecord recs[256];
+    size_t want, got, i;
+
+    while (count > 0) {
+        want = count > 256 ? 256 : (size_t)count;
+        got = fread(recs, sizeof(TileTraceRecord), want, f);
+        for (i = 0; i < got; i++) {
+            ProcessRecord(&recs[i]);
+        }
+        if (got != want) {
+            return 0;
+        }
+        count -= (long)got;
+    }
+    return 1;
+}
+
+static void Usage(void) {
+    fprintf(stderr, "usage: trcdump [-s] [-c caller] [-r x0,y0,x1,y1] [-t from,to] [file]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    TileTraceHeader header;
+    TileTraceBlock block;
+    const char *path;
+    FILE *f;
+    int i, ok;
+
+    path = TRACE_FILE_NAME;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0) {
+            summaryMode = 1;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            filterCaller = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d,%d,%d", &rectX0, &rectY0, &rectX1, &rectY1) != 4) {
+                Usage();
+            }
+            filterRect = 1;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ld,%ld", &timeFrom, &timeTo) != 2) {
+                Usage();
+            }
+            filterTime = 1;
+        } else if (argv[i][0] == '-') {
+            Usage();
+        } else {
+            path = argv[i];
+        }
+    }
+
+    f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "trcdump: cannot open %s\n", path);
+        return 1;
+    }
+
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != TRACE_MAGIC) {
+        fprintf(stderr, "trcdump: %s is not a tile trace\n", path);
+        fclose(f);
+        return 1;
+    }
+    if (header.version != TRACE_VERSION || header.recordSize != (long)sizeof(TileTraceRecord)) {
+        fprintf(stderr, "trcdump: unsupported trace version %ld\n", header.version);
+        fclose(f);
+        return 1;
+    }
+
+    ok = 1;
+    while (ok && fread(&block, sizeof(block), 1, f) == 1) {
+        switch (block.kind) {
+        case TRACE_BLOCK_NAMES:
+            ok = ReadNames(f, block.count);
+            break;
+        case TRACE_BLOCK_RECORDS:
+            ok = ReadRecords(f, block.count);
+            break;
+        default:
+            ok = 0;
+            break;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "trcdump: %s is truncated or damaged\n", path);
+    }
+    fclose(f);
+
+    if (summaryMode) {
+        PrintSummary();
+    }
+    return ok ? 0 : 1;
+}
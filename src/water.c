@@ -0,0 +1,222 @@
+/* water.c - Water distance field and shoreline index for WiNTown
+ * The field holds the 8-way step distance from every tile to the nearest
+ * navigable water tile. It is rebuilt in one pass when terrain is generated
+ * and patched from setMapTile() as water appears; removing water marks it
+ * stale and the next query rebuilds it.
+ */
+
+#include "sim.h"
+#include "water.h"
+#include <string.h>
+
+/* External log functions */
+extern void addDebugLog(const char *format, ...);
+
+/* Tiles counted as water for the shoreline (river, channel and river edges) */
+#define IS_WATER_TILE(t) (((t) & LOMASK) >= RIVER && ((t) & LOMASK) <= LASTRIVEDGE)
+
+static Byte WaterDist[WORLD_Y][WORLD_X];
+static int WaterFieldStale = 1;
+
+/* BFS queue of packed y * WORLD_X + x indices */
+static unsigned short WaterQueue[WORLD_X * WORLD_Y];
+
+/* Shoreline list with a per-tile slot for O(1) removal */
+static unsigned short ShoreList[WORLD_X * WORLD_Y];
+static short ShoreSlot[WORLD_Y][WORLD_X];
+static int ShoreCount = 0;
+
+/* 8-way neighbour offsets */
+static const short WaterDx[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const short WaterDy[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+/* Water ships can sail on - same set the ship sprite treats as clear */
+static int IsNavigableTile(int tile) {
+    tile &= LOMASK;
+    return tile == RIVER || tile == CHANNEL ||
+           tile == POWERBASE || tile == POWERBASE + 1 ||
+           tile == RAILBASE || tile == RAILBASE + 1 ||
+           tile == BRWH || tile == BRWV;
+}
+
+/* Land tile with water on one of its four sides */
+static int IsShoreTile(int x, int y) {
+    int dir, tx, ty;
+
+    if (IS_WATER_TILE(Map[y][x])) {
+        return 0;
+    }
+    for (dir = 0; dir < 8; dir += 2) {
+        tx = x + WaterDx[dir];
+        ty = y + WaterDy[dir];
+        if (BOUNDS_CHECK(tx, ty) && IS_WATER_TILE(Map[ty][tx])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Add or drop a tile from the shoreline list to match the map */
+static void UpdateShoreTile(int x, int y) {
+    int shore, slot;
+    unsigned short last;
+
+    shore = IsShoreTile(x, y);
+    slot = ShoreSlot[y][x];
+
+    if (shore && slot < 0) {
+        ShoreSlot[y][x] = (short)ShoreCount;
+        ShoreList[ShoreCount++] = (unsigned short)(y * WORLD_X + x);
+    } else if (!shore && slot >= 0) {
+        last = ShoreList[--ShoreCount];
+        ShoreList[slot] = last;
+        ShoreSlot[last / WORLD_X][last % WORLD_X] = (short)slot;
+        ShoreSlot[y][x] = -1;
+    }
+}
+
+/* Spread distances outward from the queued tiles */
+static void PropagateWater(int head, int tail) {
+    int dir, x, y, tx, ty, d;
+    unsigned short index;
+
+    while (head < tail) {
+        index = WaterQueue[head++];
+        x = index % WORLD_X;
+        y = index / WORLD_X;
+        d = WaterDist[y][x] + 1;
+        if (d >= WATER_FAR) {
+            continue;
+        }
+        for (dir = 0; dir < 8; dir++) {
+            tx = x + WaterDx[dir];
+            ty = y + WaterDy[dir];
+            if (BOUNDS_CHECK(tx, ty) && WaterDist[ty][tx] > d) {
+                WaterDist[ty][tx] = (Byte)d;
+                WaterQueue[tail++] = (unsigned short)(ty * WORLD_X + tx);
+            }
+        }
+    }
+}
+
+/* Recompute the distance field and shoreline from the whole map */
+void RebuildWaterField(void) {
+    int x, y, tail;
+
+    memset(WaterDist, WATER_FAR, sizeof(WaterDist));
+    tail = 0;
+    ShoreCount = 0;
+
+    for (y = 0; y < WORLD_Y; y++) {
+        for (x = 0; x < WORLD_X; x++) {
+            if (IsNavigableTile(Map[y][x])) {
+                WaterDist[y][x] = 0;
+                WaterQueue[tail++] = (unsigned short)(y * WORLD_X + x);
+            }
+            ShoreSlot[y][x] = -1;
+            if (IsShoreTile(x, y)) {
+                ShoreSlot[y][x] = (short)ShoreCount;
+                ShoreList[ShoreCount++] = (unsigned short)(y * WORLD_X + x);
+            }
+        }
+    }
+
+    PropagateWater(0, tail);
+    WaterFieldStale = 0;
+
+    addDebugLog("Water field rebuilt: %d navigable tiles, %d shoreline tiles", tail, ShoreCount);
+}
+
+/* Called by setMapTile() for every tile change */
+void WaterTileChanged(int x, int y, int oldTile, int newTile) {
+    int dir, tx, ty;
+
+    if (WaterFieldStale) {
+        return;
+    }
+
+    if (IsNavigableTile(oldTile) != IsNavigableTile(newTile)) {
+        if (IsNavigableTile(newTile)) {
+            /* New water only brings tiles closer */
+            WaterDist[y][x] = 0;
+            WaterQueue[0] = (unsigned short)(y * WORLD_X + x);
+            PropagateWater(0, 1);
+        } else {
+            /* Lost water can push tiles further away - rebuild on next use */
+            WaterFieldStale = 1;
+            return;
+        }
+    }
+
+    if (IS_WATER_TILE(oldTile) != IS_WATER_TILE(newTile)) {
+        UpdateShoreTile(x, y);
+        for (dir = 0; dir < 8; dir += 2) {
+            tx = x + WaterDx[dir];
+            ty = y + WaterDy[dir];
+            if (BOUNDS_CHECK(tx, ty)) {
+                UpdateShoreTile(tx, ty);
+            }
+        }
+    }
+}
+
+/* Is the tile water a ship can sail on */
+int IsNavigableWater(int x, int y) {
+    if (!BOUNDS_CHECK(x, y)) {
+        return 0;
+    }
+    return IsNavigableTile(Map[y][x]);
+}
+
+/* Steps from a tile to the nearest navigable water, WATER_FAR if none */
+int GetWaterDistance(int x, int y) {
+    if (!BOUNDS_CHECK(x, y)) {
+        return WATER_FAR;
+    }
+    if (WaterFieldStale) {
+        RebuildWaterField();
+    }
+    return WaterDist[y][x];
+}
+
+/* Neighbour one step closer to water. Returns 0 if already on water or none. */
+int WaterStepToward(int x, int y, int *nextX, int *nextY) {
+    int dir, tx, ty, best;
+
+    best = GetWaterDistance(x, y);
+    if (best == 0 || best == WATER_FAR) {
+        return 0;
+    }
+
+    for (dir = 0; dir < 8; dir++) {
+        tx = x + WaterDx[dir];
+        ty = y + WaterDy[dir];
+        if (BOUNDS_CHECK(tx, ty) && WaterDist[ty][tx] < best) {
+            *nextX = tx;
+            *nextY = ty;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Number of shoreline tiles */
+int GetShoreCount(void) {
+    if (WaterFieldStale) {
+        RebuildWaterField();
+    }
+    return ShoreCount;
+}
+
+/* Shoreline tile by index */
+int GetShoreTile(int index, int *x, int *y) {
+    if (WaterFieldStale) {
+        RebuildWaterField();
+    }
+    if (index < 0 || index >= ShoreCount) {
+        return 0;
+    }
+    *x = ShoreList[index] % WORLD_X;
+    *y = ShoreList[index] / WORLD_X;
+    return 1;
+}
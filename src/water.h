@@ -0,0 +1,24 @@
+/* water.h - Water distance field and shoreline index for WiNTown
+ * Lets ships, floods and monsters find water with table lookups
+ */
+
+#ifndef _WATER_H
+#define _WATER_H
+
+/* Distance reported for tiles further than the field tracks */
+#define WATER_FAR 255
+
+/* Field maintenance */
+void RebuildWaterField(void);
+void WaterTileChanged(int x, int y, int oldTile, int newTile);
+
+/* Navigable water (river, channel and the crossings ships pass under) */
+int IsNavigableWater(int x, int y);
+int GetWaterDistance(int x, int y);
+int WaterStepToward(int x, int y, int *nextX, int *nextY);
+
+/* Shoreline - land tiles with a water tile beside them */
+int GetShoreCount(void);
+int GetShoreTile(int index, int *x, int *y);
+
+#endif /* _WATER_H */
@@ -4,6 +4,7 @@
 
 #include "sim.h"
 #include "tiles.h"
+#include "coverage.h"
 #include <stdlib.h>
 #include <string.h>
 #include <windows.h>
@@ -33,6 +34,41 @@ static int CZPop; /* Commercial zone population */
 static int IZPop; /* Industrial zone population */
 /* ComRate is declared in simulation.h as quarter size */
 
+/* Zone wheel - each zone center is dealt one of ZONE_WHEEL_SLOTS ticks,
+ * the least used, when it appears. Work done every 4, 8 or 16 ticks runs
+ * on the zone's own tick, so it is spread evenly over CityTime instead of
+ * every zone doing it on the same one. */
+#define ZONE_WHEEL_SLOTS 16
+static unsigned char ZoneSlot[WORLD_Y][WORLD_X];
+static int WheelLoad[ZONE_WHEEL_SLOTS];
+
+/* Passes the zones now being scanned stand in for - more than one when
+ * the LOD scan visits a coarse block, so a zone whose tick fell on any
+ * of the passes it skipped is still due */
+static int ZoneDuePasses = 1;
+
+/* Zone sleep - a zone whose growth evaluation changed nothing and drew
+ * no random numbers sleeps through its next due ticks while its inputs
+ * stay the same: its tile and power, land value, pollution, density and
+ * commercial rate, the population it was offered, and the epochs of the
+ * blocks around it. An epoch moves on whenever a tile in its block
+ * really changes. A sleeping zone keeps its last trip result and wakes
+ * for a full evaluation at least every ZONE_MAX_SLEEP due ticks. */
+#define ZONE_MAX_SLEEP  4
+#define ZONE_BLOCK_SHIFT 3
+static int ZoneSleepEnabled = 0;
+static unsigned short BlockEpoch[(WORLD_Y >> ZONE_BLOCK_SHIFT) + 1][(WORLD_X >> ZONE_BLOCK_SHIFT) + 1];
+static unsigned long ZoneSig[WORLD_Y][WORLD_X];
+static unsigned char ZoneSleep[WORLD_Y][WORLD_X]; /* Due ticks slept plus one, 0 if awake */
+static unsigned char ZonePassed[WORLD_Y][WORLD_X]; /* Last trip result */
+
+/* The evaluation in progress, settled by ZoneSettle() */
+static int EvalPending = 0;
+static int EvalX, EvalY;
+static short EvalTile;
+static unsigned long EvalSig;
+static unsigned long EvalDraws;
+
 /* Population calculation cache - simple optimization */
 #define POP_CACHE_SIZE 512
 static short resPopCache[POP_CACHE_SIZE];
@@ -199,9 +235,148 @@ static int DoFreePop(int x, int y);
 static void SetZPower(int x, int y);
 /* Using global calcResPop, calcComPop, calcIndPop from simulation.h */
 
+/* Deal a slot to a zone center as it appears, take it back as it goes */
+static void ZoneWheelChange(int x, int y, int oldTile, int newTile) {
+    int slot, s;
+
+    if (!((oldTile ^ newTile) & ZONEBIT)) {
+        return;
+    }
+
+    if (newTile & ZONEBIT) {
+        slot = 0;
+        for (s = 1; s < ZONE_WHEEL_SLOTS; s++) {
+            if (WheelLoad[s] < WheelLoad[slot]) {
+                slot = s;
+            }
+        }
+        ZoneSlot[y][x] = (unsigned char)slot;
+        WheelLoad[slot]++;
+    } else {
+        WheelLoad[ZoneSlot[y][x]]--;
+    }
+}
+
+/* Called by setMapTile() for every tile change */
+void ZoneTileChanged(int x, int y, int oldTile, int newTile) {
+    int oldLo, newLo;
+
+    ZoneWheelChange(x, y, oldTile, newTile);
+
+    /* Animation frames and traffic coming and going on roads are not
+       changes to the neighbourhood */
+    oldLo = oldTile & LOMASK;
+    newLo = newTile & LOMASK;
+    if (oldLo == newLo || (oldTile & newTile & ANIMBIT)) {
+        return;
+    }
+    if (oldLo >= ROADBASE && oldLo <= LASTROAD && newLo >= ROADBASE && newLo <= LASTROAD) {
+        return;
+    }
+    BlockEpoch[y >> ZONE_BLOCK_SHIFT][x >> ZONE_BLOCK_SHIFT]++;
+}
+
+void SetZoneSleep(int enabled) {
+    ZoneSleepEnabled = enabled ? 1 : 0;
+    memset(ZoneSleep, 0, sizeof(ZoneSleep));
+    EvalPending = 0;
+    addDebugLog("Zone sleep %s", ZoneSleepEnabled ? "enabled" : "disabled");
+}
+
+int GetZoneSleep(void) {
+    return ZoneSleepEnabled;
+}
+
+/* Everything a zone's growth evaluation reads, hashed */
+static unsigned long ZoneInputs(int x, int y, int tpop) {
+    unsigned long h;
+    int bx0, by0, bx1, by1;
+
+    h = (unsigned short)Map[y][x];
+    h = h * 31 + LandValueMem[y >> 1][x >> 1];
+    h = h * 31 + PollutionMem[y >> 1][x >> 1];
+    h = h * 31 + PopDensity[y >> 1][x >> 1];
+    h = h * 31 + (unsigned short)ComRate[y >> 3][x >> 3];
+    h = h * 31 + (tpop < 40 ? tpop : 40);
+
+    /* Blocks under the zone and its perimeter road */
+    bx0 = (x > 2 ? x - 2 : 0) >> ZONE_BLOCK_SHIFT;
+    by0 = (y > 2 ? y - 2 : 0) >> ZONE_BLOCK_SHIFT;
+    bx1 = (x < WORLD_X - 3 ? x + 2 : WORLD_X - 1) >> ZONE_BLOCK_SHIFT;
+    by1 = (y < WORLD_Y - 3 ? y + 2 : WORLD_Y - 1) >> ZONE_BLOCK_SHIFT;
+    h = h * 31 + BlockEpoch[by0][bx0];
+    h = h * 31 + BlockEpoch[by0][bx1];
+    h = h * 31 + BlockEpoch[by1][bx0];
+    h = h * 31 + BlockEpoch[by1][bx1];
+    return h;
+}
+
+/* Should the zone sleep through this due tick. If not, its evaluation
+   starts now and ZoneSettle() decides whether it sleeps afterwards. */
+static int ZoneAsleep(int x, int y, int tpop) {
+    unsigned long sig;
+
+    if (!ZoneSleepEnabled) {
+        return 0;
+    }
+
+    sig = ZoneInputs(x, y, tpop);
+    if (ZoneSleep[y][x] && ZoneSleep[y][x] <= ZONE_MAX_SLEEP && sig == ZoneSig[y][x]) {
+        ZoneSleep[y][x]++;
+        return 1;
+    }
+
+    ZoneSleep[y][x] = 0;
+    EvalPending = 1;
+    EvalX = x;
+    EvalY = y;
+    EvalSig = sig;
+    return 0;
+}
+
+/* Mark the start of the growth evaluation, after the zone's trip */
+static void ZoneEvalStart(void) {
+    if (EvalPending) {
+        EvalTile = Map[EvalY][EvalX];
+        EvalDraws = SimRandomDraws;
+    }
+}
+
+/* Put the zone to sleep if its evaluation changed nothing */
+static void ZoneSettle(void) {
+    if (!EvalPending) {
+        return;
+    }
+    EvalPending = 0;
+    if (Map[EvalY][EvalX] == EvalTile && SimRandomDraws == EvalDraws) {
+        ZoneSig[EvalY][EvalX] = EvalSig;
+        ZoneSleep[EvalY][EvalX] = 1;
+    }
+}
+
+/* A zone's trip, or the last one's result while it sleeps */
+static int ZoneTrip(int x, int y, int zoneType, int asleep) {
+    if (!asleep) {
+        SMapX = x;
+        SMapY = y;
+        ZonePassed[y][x] = (unsigned char)(MakeTraffic(zoneType) > 0);
+    }
+    return ZonePassed[y][x];
+}
+
+/* Is this the zone's tick for work done every period (4, 8 or 16) ticks,
+   or was it one of the passes this scan stands in for */
+static int ZoneDue(int x, int y, int period) {
+    return ((CityTime - ZoneSlot[y][x]) & (period - 1)) < ZoneDuePasses;
+}
+
+void SetZoneDuePasses(int passes) {
+    ZoneDuePasses = passes > 0 ? passes : 1;
+}
+
 /* Random between 0 and range-1 */
 static int ZoneRandom(int range) {
-    return rand() % range;
+    return SimRandom(range);
 }
 
 /* Main zone processing function - based on original WiNTown code */
@@ -226,6 +401,7 @@ void DoZone(int Xloc, int Yloc, int pos) {
             /* Residential zone */
             SetZPower(Xloc, Yloc);
             DoResidential(Xloc, Yloc);
+            ZoneSettle();
             return;
         }
 
@@ -233,6 +409,7 @@ void DoZone(int Xloc, int Yloc, int pos) {
             /* Commercial zone */
             SetZPower(Xloc, Yloc);
             DoCommercial(Xloc, Yloc);
+            ZoneSettle();
             return;
         }
 
@@ -240,6 +417,7 @@ void DoZone(int Xloc, int Yloc, int pos) {
             /* Industrial zone */
             SetZPower(Xloc, Yloc);
             DoIndustrial(Xloc, Yloc);
+            ZoneSettle();
             return;
         }
     }
@@ -285,7 +463,7 @@ static void DoHospChur(int x, int y) {
     /* Check if zone has power */
     zonePowered = (Map[y][x] & POWERBIT) != 0;
 
-    if (CityTime & 3) {
+    if (!ZoneDue(x, y, 4)) {
         return;
     }
 
@@ -331,8 +509,8 @@ static void DoSPZ(int x, int y) {
 
     SetZPower(x, y);
 
-    /* Only process every 16th time */
-    if (CityTime & 15) {
+    /* Only process on the zone's tick, every 16th time */
+    if (!ZoneDue(x, y, 16)) {
         return;
     }
 
@@ -364,8 +542,8 @@ static void DoSPZ(int x, int y) {
 
     /* Handle special case of nuclear power */
     if (z == NUCLEAR) {
-        NuclearPop++;
-        
+        /* Plant count is kept by census.c */
+
         /* Check for nuclear meltdown based on difficulty level */
         if (DisastersEnabled && ZoneRandom(DifficultyMeltdownRisk[GameLevel]) == 0) {
             /* Trigger nuclear meltdown disaster */
@@ -381,8 +559,7 @@ static void DoSPZ(int x, int y) {
         
         /* Police count managed by census - no need to duplicate here */
         
-        /* Police effectiveness calculated by scanner.c using smoothing algorithm */
-        /* Mark station location for scanner.c to process */
+        /* Register the station strength - coverage.c spreads it over the map */
         if (Map[y][x] & POWERBIT) {
             effect = PoliceEffect;
         } else {
@@ -394,20 +571,8 @@ static void DoSPZ(int x, int y) {
             effect = effect >> 1;  /* Half effect without road access */
         }
         
-        /* Set base effect at station location - scanner.c will smooth this */
-        PoliceMap[y >> 2][x >> 2] = effect;
-        
-        /* Debug logging */
-        addDebugLog("POLICE: Added %d to map at (%d,%d) -> quarter (%d,%d), value now %d", 
-                   effect, x, y, x >> 2, y >> 2, PoliceMap[y >> 2][x >> 2]);
-        
-        /* Cap the value to prevent overflow */
-        if (PoliceMap[y >> 2][x >> 2] > 250) {
-            PoliceMap[y >> 2][x >> 2] = 250;
-        }
-        
-        
-        
+        SetCoverageSource(COVERAGE_POLICE, x, y, effect);
+        addDebugLog("POLICE: Station at (%d,%d) effect %d", x, y, effect);
         return;
     }
     
@@ -417,8 +582,7 @@ static void DoSPZ(int x, int y) {
         
         /* Fire station count managed by census - no need to duplicate here */
         
-        /* Fire station effectiveness calculated by scanner.c using smoothing algorithm */
-        /* Mark station location for scanner.c to process */
+        /* Register the station strength - coverage.c spreads it over the map */
         if (Map[y][x] & POWERBIT) {
             effect = FireEffect;
         } else {
@@ -430,15 +594,7 @@ static void DoSPZ(int x, int y) {
             effect = effect >> 1;  /* Half effect without road access */
         }
         
-        /* Set base effect at station location - scanner.c will smooth this */
-        FireStMap[y >> 2][x >> 2] = effect;
-        
-        /* Cap the value to prevent overflow */
-        if (FireStMap[y >> 2][x >> 2] > 250) {
-            FireStMap[y >> 2][x >> 2] = 250;
-        }
-        
-        
+        SetCoverageSource(COVERAGE_FIRE, x, y, effect);
         return;
     }
 }
@@ -455,11 +611,14 @@ static void DoIndustrial(int x, int y) {
     short tpop;
     int pop;
     int zonePowered;
+    int due;
+    int asleep;
 
     zone = Map[y][x];
     if (!(zone & ZONEBIT)) {
         return;
     }
+    due = ZoneDue(x, y, 8);
 
     SetZPower(x, y);
     
@@ -470,6 +629,7 @@ static void DoIndustrial(int x, int y) {
     SetSmoke(x, y);
 
     tpop = IZPop;
+    asleep = due && ZoneAsleep(x, y, tpop);
 
     /* Get actual zone population - pass only the tile ID without flags */
     pop = calcIndPop(zone & LOMASK);
@@ -491,21 +651,20 @@ static void DoIndustrial(int x, int y) {
     IndPop += pop;
 
     /* Generate traffic from industrial zones at a certain rate */
-    if (pop > 0 && (CityTime & 7) == 0) {
+    if (pop > 0 && due) {
         /* Industrial zones (2) try to generate traffic to residential zones */
-        SMapX = x;
-        SMapY = y;
-
         /* If traffic generation successful, update population count */
-        if (MakeTraffic(2) > 0) {
+        if (ZoneTrip(x, y, 2, asleep)) {
             IZPop += pop;
         }
     }
 
-    /* Process industrial zone less often (every 8th cycle) */
-    if ((CityTime & 7) == 0) {
+    /* Process industrial zone less often (on its tick, every 8th cycle) */
+    if (due && !asleep) {
         int value;
 
+        ZoneEvalStart();
+
         value = GetCRVal(x, y);
 
         if (value < 0) {
@@ -522,7 +681,7 @@ static void DoIndustrial(int x, int y) {
         }
     }
 
-    if ((CityTime & 7) == 0) {
+    if (due) {
         IZPop = 0;
     }
 }
@@ -533,11 +692,14 @@ static void DoCommercial(int x, int y) {
     short tpop;
     int pop;
     int zonePowered;
+    int due;
+    int asleep;
 
     zone = Map[y][x];
     if (!(zone & ZONEBIT)) {
         return;
     }
+    due = ZoneDue(x, y, 8);
 
     SetZPower(x, y);
     
@@ -545,6 +707,7 @@ static void DoCommercial(int x, int y) {
     zonePowered = (Map[y][x] & POWERBIT) != 0;
 
     tpop = CZPop;
+    asleep = due && ZoneAsleep(x, y, tpop);
 
     /* Get actual zone population - pass only the tile ID without flags */
     pop = calcComPop(zone & LOMASK);
@@ -558,21 +721,20 @@ static void DoCommercial(int x, int y) {
     ComPop += pop;
 
     /* Generate traffic from commercial zones at a certain rate */
-    if (pop > 0 && (CityTime & 7) == 0) {
+    if (pop > 0 && due) {
         /* Commercial zones (1) try to generate traffic to industrial zones */
-        SMapX = x;
-        SMapY = y;
-
         /* If traffic generation successful, update population count */
-        if (MakeTraffic(1) > 0) {
+        if (ZoneTrip(x, y, 1, asleep)) {
             CZPop += pop;
         }
     }
 
-    /* Process commercial zone less often (every 8th cycle) */
-    if ((CityTime & 7) == 0) {
+    /* Process commercial zone less often (on its tick, every 8th cycle) */
+    if (due && !asleep) {
         int value;
 
+        ZoneEvalStart();
+
         value = GetCRVal(x, y);
 
         if (value < 0) {
@@ -589,7 +751,7 @@ static void DoCommercial(int x, int y) {
         }
     }
 
-    if ((CityTime & 7) == 0) {
+    if (due) {
         CZPop = 0;
     }
 }
@@ -600,17 +762,21 @@ static void DoResidential(int x, int y) {
     short tpop;
     int pop;
     int zonePowered;
+    int due;
+    int asleep;
     short tileId;
 
     zone = Map[y][x];
     if (!(zone & ZONEBIT)) {
         return;
     }
+    due = ZoneDue(x, y, 8);
 
     /* Check if zone has power */
     zonePowered = (Map[y][x] & POWERBIT) != 0;
 
     tpop = RZPop;
+    asleep = due && ZoneAsleep(x, y, tpop);
 
     /* Get actual zone population - pass only the tile ID without flags */
     tileId = zone & LOMASK;
@@ -625,23 +791,22 @@ static void DoResidential(int x, int y) {
     ResPop += pop;
 
     /* Generate traffic from residential zones at a certain rate */
-    if (pop > 0 && (CityTime & 7) == 0) {
+    if (pop > 0 && due) {
         /* Residential zones (0) try to generate traffic to commercial or industrial zones */
-        SMapX = x;
-        SMapY = y;
-
         /* If traffic generation successful, update population count */
-        if (MakeTraffic(0) > 0) {
+        if (ZoneTrip(x, y, 0, asleep)) {
             RZPop += pop;
         }
     }
 
     /* Process growth or decline based on power status */
-    if ((CityTime & 7) == 0) {
+    if (due && !asleep) {
         int value;
         short oldTile;
         short newTile;
 
+        ZoneEvalStart();
+
         /* Save old tile for debugging */
         oldTile = Map[y][x] & LOMASK;
 
@@ -691,7 +856,7 @@ static void DoResidential(int x, int y) {
     }
 
     /* Reset population counter periodically */
-    if ((CityTime & 7) == 0) {
+    if (due) {
         RZPop = 0;
     }
 }